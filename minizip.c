@@ -36,6 +36,8 @@ typedef struct minizip_opt_s {
     int32_t     encoding;
     uint8_t     verbose;
     uint8_t     aes;
+    int32_t     thread_count;
+    int64_t     job_size;
     const char *cert_path;
     const char *cert_pwd;
 } minizip_opt;
@@ -68,7 +70,7 @@ int32_t minizip_banner(void) {
 }
 
 int32_t minizip_help(void) {
-    printf("Usage: minizip [-x][-d dir|-l|-e][-o][-f][-y][-c cp][-a][-0 to -9][-b|-m|-t][-k 512][-p pwd][-s] file.zip [files]\n\n" \
+    printf("Usage: minizip [-x][-d dir|-l|-e][-o][-f][-y][-c cp][-a][-0 to -9][-b|-m|-t][-k 512][-p pwd][-s][-j 4][-g 4096] file.zip [files]\n\n" \
            "  -x  Extract files\n" \
            "  -l  List files\n" \
            "  -d  Destination directory\n" \
@@ -87,6 +89,8 @@ int32_t minizip_help(void) {
            "  -z  Zip central directory\n" \
            "  -p  Encryption password\n" \
            "  -s  AES encryption\n" \
+           "  -j  Number of threads\n" \
+           "  -g  Job size in KB for each compress thread\n" \
            "  -h  PKCS12 certificate path\n" \
            "  -w  PKCS12 certificate password\n" \
            "  -b  BZIP2 compression\n" \
@@ -258,6 +262,8 @@ int32_t minizip_add(const char *path, const char *password, minizip_opt *options
     mz_zip_writer_set_progress_cb(writer, options, minizip_add_progress_cb);
     mz_zip_writer_set_entry_cb(writer, options, minizip_add_entry_cb);
     mz_zip_writer_set_zip_cd(writer, options->zip_cd);
+    mz_zip_writer_set_thread_count(writer, options->thread_count);
+    mz_zip_writer_set_compress_job_size(writer, options->job_size);
     if (options->cert_path != NULL)
         mz_zip_writer_set_certificate(writer, options->cert_path, options->cert_pwd);
 
@@ -361,6 +367,7 @@ int32_t minizip_extract(const char *path, const char *pattern, const char *desti
     mz_zip_reader_set_pattern(reader, pattern, 1);
     mz_zip_reader_set_password(reader, password);
     mz_zip_reader_set_encoding(reader, options->encoding);
+    mz_zip_reader_set_thread_count(reader, options->thread_count);
     mz_zip_reader_set_entry_cb(reader, options, minizip_extract_entry_cb);
     mz_zip_reader_set_progress_cb(reader, options, minizip_extract_progress_cb);
     mz_zip_reader_set_overwrite_cb(reader, options, minizip_extract_overwrite_cb);
@@ -615,6 +622,14 @@ int main(int argc, const char *argv[]) {
             } else if (((c == 'c') || (c == 'C')) && (i + 1 < argc)) {
                 options.encoding = (int32_t)atoi(argv[i + 1]);
                 i += 1;
+            } else if (((c == 'j') || (c == 'J')) && (i + 1 < argc)) {
+                options.thread_count = (int32_t)atoi(argv[i + 1]);
+                printf("%s ", argv[i + 1]);
+                i += 1;
+            } else if (((c == 'g') || (c == 'G')) && (i + 1 < argc)) {
+                options.job_size = (int64_t)atoi(argv[i + 1]) * 1024;
+                printf("%s ", argv[i + 1]);
+                i += 1;
             } else if (((c == 'k') || (c == 'K')) && (i + 1 < argc)) {
                 options.disk_size = (int64_t)atoi(argv[i + 1]) * 1024;
                 printf("%s ", argv[i + 1]);
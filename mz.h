@@ -73,6 +73,10 @@
 #define MZ_COMPRESS_LEVEL_NORMAL        (6)
 #define MZ_COMPRESS_LEVEL_BEST          (9)
 
+#define MZ_COMPRESS_FLAG_ONE_SHOT       (1 << 0)
+#define MZ_COMPRESS_FLAG_THREADS        (1 << 1)
+#define MZ_COMPRESS_FLAG_SEEKABLE       (1 << 2)
+
 /* MZ_ZIP_FLAG */
 #define MZ_ZIP_FLAG_ENCRYPTED           (1 << 0)
 #define MZ_ZIP_FLAG_LZMA_EOS_MARKER     (1 << 1)
@@ -1093,6 +1093,12 @@ int unzLocateFile(unzFile file, const char *filename, unzFileNameComparer filena
 
     preserve_index = compat->entry_index;
 
+    /* Use the zip name index unless a custom comparer or wildcard is used */
+    if (((intptr_t)filename_compare_func <= 2) && (strchr(filename, '*') == NULL)) {
+        int32_t case_sensitive = (int32_t)(intptr_t)filename_compare_func;
+        return mz_zip_locate_entry(compat->handle, filename, !case_sensitive);
+    }
+
     err = mz_zip_goto_first_entry(compat->handle);
     while (err == MZ_OK) {
         err = mz_zip_entry_get_info(compat->handle, &file_info);
@@ -18,6 +18,7 @@ extern "C" {
 /***************************************************************************/
 
 uint32_t mz_crypt_crc32_update(uint32_t value, const uint8_t *buf, int32_t size);
+uint32_t mz_crypt_crc32_combine(uint32_t crc1, uint32_t crc2, int64_t size2);
 
 int32_t  mz_crypt_pbkdf2(uint8_t *password, int32_t password_length, uint8_t *salt,
             int32_t salt_length, int32_t iteration_count, uint8_t *key, int32_t key_length);
@@ -37,6 +38,7 @@ void     mz_crypt_sha_delete(void **handle);
 void     mz_crypt_aes_reset(void *handle);
 int32_t  mz_crypt_aes_encrypt(void *handle, uint8_t *buf, int32_t size);
 int32_t  mz_crypt_aes_decrypt(void *handle, uint8_t *buf, int32_t size);
+int32_t  mz_crypt_aes_encrypt_ctr(void *handle, uint8_t *counter, uint8_t *buf, int32_t size);
 int32_t  mz_crypt_aes_set_encrypt_key(void *handle, const void *key, int32_t key_length);
 int32_t  mz_crypt_aes_set_decrypt_key(void *handle, const void *key, int32_t key_length);
 void     mz_crypt_aes_set_mode(void *handle, int32_t mode);
@@ -208,7 +208,7 @@ int32_t mz_crypt_aes_encrypt(void *handle, uint8_t *buf, int32_t size) {
 
     if (aes == NULL || buf == NULL)
         return MZ_PARAM_ERROR;
-    if (size != MZ_AES_BLOCK_SIZE)
+    if (size <= 0 || (size % MZ_AES_BLOCK_SIZE) != 0)
         return MZ_PARAM_ERROR;
 
     aes->error = CCCryptorUpdate(aes->crypt, buf, size, buf, size, &data_moved);
@@ -225,7 +225,7 @@ int32_t mz_crypt_aes_decrypt(void *handle, uint8_t *buf, int32_t size) {
 
     if (aes == NULL || buf == NULL)
         return MZ_PARAM_ERROR;
-    if (size != MZ_AES_BLOCK_SIZE)
+    if (size <= 0 || (size % MZ_AES_BLOCK_SIZE) != 0)
         return MZ_PARAM_ERROR;
 
     aes->error = CCCryptorUpdate(aes->crypt, buf, size, buf, size, &data_moved);
@@ -228,11 +228,11 @@ void mz_crypt_sha_delete(void **handle) {
 /***************************************************************************/
 
 typedef struct mz_crypt_aes_s {
-    AES_KEY    key;
-    int32_t    mode;
-    int32_t    error;
-    uint8_t    *key_copy;
-    int32_t    key_length;
+    EVP_CIPHER_CTX *ctx;
+    int32_t        mode;
+    int32_t        error;
+    uint8_t        *key_copy;
+    int32_t        key_length;
 } mz_crypt_aes;
 
 /***************************************************************************/
@@ -243,35 +243,40 @@ void mz_crypt_aes_reset(void *handle) {
     mz_crypt_init();
 }
 
-int32_t mz_crypt_aes_encrypt(void *handle, uint8_t *buf, int32_t size) {
+static int32_t mz_crypt_aes_update(void *handle, uint8_t *buf, int32_t size) {
     mz_crypt_aes *aes = (mz_crypt_aes *)handle;
+    int result = 0;
+    int out_size = 0;
 
     if (aes == NULL || buf == NULL)
         return MZ_PARAM_ERROR;
-    if (size != MZ_AES_BLOCK_SIZE)
+    if (size <= 0 || (size % MZ_AES_BLOCK_SIZE) != 0)
         return MZ_PARAM_ERROR;
+    if (aes->ctx == NULL)
+        return MZ_PARAM_ERROR;
+
+    /* Blocks are processed in ECB mode so that many blocks are handled in one call */
+    result = EVP_CipherUpdate(aes->ctx, buf, &out_size, buf, size);
+    if (!result || out_size != size) {
+        aes->error = ERR_get_error();
+        return MZ_CRYPT_ERROR;
+    }
 
-    AES_encrypt(buf, buf, &aes->key);
-    /* Equivalent to AES_ecb_encrypt with AES_ENCRYPT */
     return size;
 }
 
-int32_t mz_crypt_aes_decrypt(void *handle, uint8_t *buf, int32_t size) {
-    mz_crypt_aes *aes = (mz_crypt_aes *)handle;
-    if (aes == NULL || buf == NULL)
-        return MZ_PARAM_ERROR;
-    if (size != MZ_AES_BLOCK_SIZE)
-        return MZ_PARAM_ERROR;
+int32_t mz_crypt_aes_encrypt(void *handle, uint8_t *buf, int32_t size) {
+    return mz_crypt_aes_update(handle, buf, size);
+}
 
-    AES_decrypt(buf, buf, &aes->key);
-    /* Equivalent to AES_ecb_encrypt with AES_DECRYPT */
-    return size;
+int32_t mz_crypt_aes_decrypt(void *handle, uint8_t *buf, int32_t size) {
+    return mz_crypt_aes_update(handle, buf, size);
 }
 
-int32_t mz_crypt_aes_set_encrypt_key(void *handle, const void *key, int32_t key_length) {
+static int32_t mz_crypt_aes_set_key(void *handle, const void *key, int32_t key_length, int enc) {
     mz_crypt_aes *aes = (mz_crypt_aes *)handle;
-    int32_t result = 0;
-    int32_t key_bits = 0;
+    const EVP_CIPHER *cipher = NULL;
+    int result = 0;
 
 
     if (aes == NULL || key == NULL)
@@ -279,30 +284,24 @@ int32_t mz_crypt_aes_set_encrypt_key(void *handle, const void *key, int32_t key_
 
     mz_crypt_aes_reset(handle);
 
-    key_bits = key_length * 8;
-    result = AES_set_encrypt_key(key, key_bits, &aes->key);
-    if (result) {
-        aes->error = ERR_get_error();
-        return MZ_HASH_ERROR;
-    }
-
-    return MZ_OK;
-}
-
-int32_t mz_crypt_aes_set_decrypt_key(void *handle, const void *key, int32_t key_length) {
-    mz_crypt_aes *aes = (mz_crypt_aes *)handle;
-    int32_t result = 0;
-    int32_t key_bits = 0;
-
-
-    if (aes == NULL || key == NULL)
+    if (key_length == 16)
+        cipher = EVP_aes_128_ecb();
+    else if (key_length == 24)
+        cipher = EVP_aes_192_ecb();
+    else if (key_length == 32)
+        cipher = EVP_aes_256_ecb();
+    else
         return MZ_PARAM_ERROR;
 
-    mz_crypt_aes_reset(handle);
+    if (aes->ctx == NULL)
+        aes->ctx = EVP_CIPHER_CTX_new();
+    if (aes->ctx == NULL)
+        return MZ_MEM_ERROR;
 
-    key_bits = key_length * 8;
-    result = AES_set_decrypt_key(key, key_bits, &aes->key);
-    if (result) {
+    result = EVP_CipherInit_ex(aes->ctx, cipher, NULL, (const uint8_t *)key, NULL, enc);
+    if (result)
+        result = EVP_CIPHER_CTX_set_padding(aes->ctx, 0);
+    if (!result) {
         aes->error = ERR_get_error();
         return MZ_HASH_ERROR;
     }
@@ -310,6 +309,14 @@ int32_t mz_crypt_aes_set_decrypt_key(void *handle, const void *key, int32_t key_
     return MZ_OK;
 }
 
+int32_t mz_crypt_aes_set_encrypt_key(void *handle, const void *key, int32_t key_length) {
+    return mz_crypt_aes_set_key(handle, key, key_length, 1);
+}
+
+int32_t mz_crypt_aes_set_decrypt_key(void *handle, const void *key, int32_t key_length) {
+    return mz_crypt_aes_set_key(handle, key, key_length, 0);
+}
+
 void mz_crypt_aes_set_mode(void *handle, int32_t mode) {
     mz_crypt_aes *aes = (mz_crypt_aes *)handle;
     aes->mode = mode;
@@ -332,8 +339,11 @@ void mz_crypt_aes_delete(void **handle) {
     if (handle == NULL)
         return;
     aes = (mz_crypt_aes *)*handle;
-    if (aes != NULL)
+    if (aes != NULL) {
+        if (aes->ctx != NULL)
+            EVP_CIPHER_CTX_free(aes->ctx);
         MZ_FREE(aes);
+    }
     *handle = NULL;
 }
 
@@ -374,7 +374,7 @@ int32_t mz_crypt_aes_encrypt(void *handle, uint8_t *buf, int32_t size) {
 
     if (aes == NULL || buf == NULL)
         return MZ_PARAM_ERROR;
-    if (size != MZ_AES_BLOCK_SIZE)
+    if (size <= 0 || (size % MZ_AES_BLOCK_SIZE) != 0)
         return MZ_PARAM_ERROR;
     result = CryptEncrypt(aes->key, 0, 0, 0, buf, (DWORD *)&size, size);
     if (!result) {
@@ -389,7 +389,7 @@ int32_t mz_crypt_aes_decrypt(void *handle, uint8_t *buf, int32_t size) {
     int32_t result = 0;
     if (aes == NULL || buf == NULL)
         return MZ_PARAM_ERROR;
-    if (size != MZ_AES_BLOCK_SIZE)
+    if (size <= 0 || (size % MZ_AES_BLOCK_SIZE) != 0)
         return MZ_PARAM_ERROR;
     result = CryptDecrypt(aes->key, 0, 0, 0, buf, (DWORD *)&size);
     if (!result) {
@@ -166,6 +166,44 @@ int32_t  mz_os_read_symlink(const char *path, char *target_path, int32_t max_tar
 uint64_t mz_os_ms_time(void);
 /* Gets the time in milliseconds */
 
+/***************************************************************************/
+/* Threading functions */
+
+typedef void (*mz_os_thread_cb)(void *userdata);
+
+int32_t  mz_os_thread_create(void **thread, mz_os_thread_cb cb, void *userdata);
+/* Starts a thread that calls the callback, returns MZ_SUPPORT_ERROR if threads aren't supported */
+
+int32_t  mz_os_thread_join(void **thread);
+/* Waits for a thread to finish and deletes it */
+
+int32_t  mz_os_mutex_create(void **mutex);
+/* Creates a mutex, returns MZ_SUPPORT_ERROR if threads aren't supported */
+
+void     mz_os_mutex_delete(void **mutex);
+/* Deletes a mutex */
+
+void     mz_os_mutex_lock(void *mutex);
+/* Locks a mutex */
+
+void     mz_os_mutex_unlock(void *mutex);
+/* Unlocks a mutex */
+
+int32_t  mz_os_cond_create(void **cond);
+/* Creates a condition variable, returns MZ_SUPPORT_ERROR if threads aren't supported */
+
+void     mz_os_cond_delete(void **cond);
+/* Deletes a condition variable */
+
+void     mz_os_cond_wait(void *cond, void *mutex);
+/* Unlocks the mutex and waits until the condition variable is signaled */
+
+void     mz_os_cond_signal(void *cond);
+/* Wakes up one thread waiting on the condition variable */
+
+void     mz_os_cond_broadcast(void *cond);
+/* Wakes up all threads waiting on the condition variable */
+
 /***************************************************************************/
 
 #ifdef __cplusplus
@@ -40,6 +40,9 @@
 #  endif
 #  include <bsd/stdlib.h> /* arc4random_buf */
 #endif
+#if defined(HAVE_PTHREAD)
+#  include <pthread.h>
+#endif
 
 /***************************************************************************/
 
@@ -366,3 +369,187 @@ uint64_t mz_os_ms_time(void) {
 
     return ((uint64_t)ts.tv_sec * 1000) + ((uint64_t)ts.tv_nsec / 1000000);
 }
+
+/***************************************************************************/
+
+#if defined(HAVE_PTHREAD)
+typedef struct mz_os_thread_s {
+    pthread_t       handle;
+    mz_os_thread_cb cb;
+    void            *userdata;
+} mz_os_thread;
+
+static void *mz_os_thread_start(void *arg) {
+    mz_os_thread *thread = (mz_os_thread *)arg;
+    thread->cb(thread->userdata);
+    return NULL;
+}
+
+int32_t mz_os_thread_create(void **thread, mz_os_thread_cb cb, void *userdata) {
+    mz_os_thread *new_thread = NULL;
+
+    if (thread == NULL || cb == NULL)
+        return MZ_PARAM_ERROR;
+
+    new_thread = (mz_os_thread *)MZ_ALLOC(sizeof(mz_os_thread));
+    if (new_thread == NULL)
+        return MZ_MEM_ERROR;
+
+    new_thread->cb = cb;
+    new_thread->userdata = userdata;
+
+    if (pthread_create(&new_thread->handle, NULL, mz_os_thread_start, new_thread) != 0) {
+        MZ_FREE(new_thread);
+        return MZ_INTERNAL_ERROR;
+    }
+
+    *thread = new_thread;
+    return MZ_OK;
+}
+
+int32_t mz_os_thread_join(void **thread) {
+    mz_os_thread *old_thread = NULL;
+    int32_t err = MZ_OK;
+
+    if (thread == NULL || *thread == NULL)
+        return MZ_PARAM_ERROR;
+
+    old_thread = (mz_os_thread *)*thread;
+    if (pthread_join(old_thread->handle, NULL) != 0)
+        err = MZ_INTERNAL_ERROR;
+
+    MZ_FREE(old_thread);
+    *thread = NULL;
+    return err;
+}
+
+int32_t mz_os_mutex_create(void **mutex) {
+    pthread_mutex_t *new_mutex = NULL;
+
+    if (mutex == NULL)
+        return MZ_PARAM_ERROR;
+
+    new_mutex = (pthread_mutex_t *)MZ_ALLOC(sizeof(pthread_mutex_t));
+    if (new_mutex == NULL)
+        return MZ_MEM_ERROR;
+
+    if (pthread_mutex_init(new_mutex, NULL) != 0) {
+        MZ_FREE(new_mutex);
+        return MZ_INTERNAL_ERROR;
+    }
+
+    *mutex = new_mutex;
+    return MZ_OK;
+}
+
+void mz_os_mutex_delete(void **mutex) {
+    if (mutex == NULL || *mutex == NULL)
+        return;
+    pthread_mutex_destroy((pthread_mutex_t *)*mutex);
+    MZ_FREE(*mutex);
+    *mutex = NULL;
+}
+
+void mz_os_mutex_lock(void *mutex) {
+    if (mutex != NULL)
+        pthread_mutex_lock((pthread_mutex_t *)mutex);
+}
+
+void mz_os_mutex_unlock(void *mutex) {
+    if (mutex != NULL)
+        pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+int32_t mz_os_cond_create(void **cond) {
+    pthread_cond_t *new_cond = NULL;
+
+    if (cond == NULL)
+        return MZ_PARAM_ERROR;
+
+    new_cond = (pthread_cond_t *)MZ_ALLOC(sizeof(pthread_cond_t));
+    if (new_cond == NULL)
+        return MZ_MEM_ERROR;
+
+    if (pthread_cond_init(new_cond, NULL) != 0) {
+        MZ_FREE(new_cond);
+        return MZ_INTERNAL_ERROR;
+    }
+
+    *cond = new_cond;
+    return MZ_OK;
+}
+
+void mz_os_cond_delete(void **cond) {
+    if (cond == NULL || *cond == NULL)
+        return;
+    pthread_cond_destroy((pthread_cond_t *)*cond);
+    MZ_FREE(*cond);
+    *cond = NULL;
+}
+
+void mz_os_cond_wait(void *cond, void *mutex) {
+    if (cond != NULL && mutex != NULL)
+        pthread_cond_wait((pthread_cond_t *)cond, (pthread_mutex_t *)mutex);
+}
+
+void mz_os_cond_signal(void *cond) {
+    if (cond != NULL)
+        pthread_cond_signal((pthread_cond_t *)cond);
+}
+
+void mz_os_cond_broadcast(void *cond) {
+    if (cond != NULL)
+        pthread_cond_broadcast((pthread_cond_t *)cond);
+}
+#else
+int32_t mz_os_thread_create(void **thread, mz_os_thread_cb cb, void *userdata) {
+    MZ_UNUSED(thread);
+    MZ_UNUSED(cb);
+    MZ_UNUSED(userdata);
+    return MZ_SUPPORT_ERROR;
+}
+
+int32_t mz_os_thread_join(void **thread) {
+    MZ_UNUSED(thread);
+    return MZ_SUPPORT_ERROR;
+}
+
+int32_t mz_os_mutex_create(void **mutex) {
+    MZ_UNUSED(mutex);
+    return MZ_SUPPORT_ERROR;
+}
+
+void mz_os_mutex_delete(void **mutex) {
+    MZ_UNUSED(mutex);
+}
+
+void mz_os_mutex_lock(void *mutex) {
+    MZ_UNUSED(mutex);
+}
+
+void mz_os_mutex_unlock(void *mutex) {
+    MZ_UNUSED(mutex);
+}
+
+int32_t mz_os_cond_create(void **cond) {
+    MZ_UNUSED(cond);
+    return MZ_SUPPORT_ERROR;
+}
+
+void mz_os_cond_delete(void **cond) {
+    MZ_UNUSED(cond);
+}
+
+void mz_os_cond_wait(void *cond, void *mutex) {
+    MZ_UNUSED(cond);
+    MZ_UNUSED(mutex);
+}
+
+void mz_os_cond_signal(void *cond) {
+    MZ_UNUSED(cond);
+}
+
+void mz_os_cond_broadcast(void *cond) {
+    MZ_UNUSED(cond);
+}
+#endif
@@ -656,3 +656,126 @@ uint64_t mz_os_ms_time(void) {
 
     return quad_file_time / 10000 - 11644473600000LL;
 }
+
+/***************************************************************************/
+
+typedef struct mz_os_thread_s {
+    HANDLE          handle;
+    mz_os_thread_cb cb;
+    void            *userdata;
+} mz_os_thread;
+
+static DWORD WINAPI mz_os_thread_start(LPVOID arg) {
+    mz_os_thread *thread = (mz_os_thread *)arg;
+    thread->cb(thread->userdata);
+    return 0;
+}
+
+int32_t mz_os_thread_create(void **thread, mz_os_thread_cb cb, void *userdata) {
+    mz_os_thread *new_thread = NULL;
+
+    if (thread == NULL || cb == NULL)
+        return MZ_PARAM_ERROR;
+
+    new_thread = (mz_os_thread *)MZ_ALLOC(sizeof(mz_os_thread));
+    if (new_thread == NULL)
+        return MZ_MEM_ERROR;
+
+    new_thread->cb = cb;
+    new_thread->userdata = userdata;
+    new_thread->handle = CreateThread(NULL, 0, mz_os_thread_start, new_thread, 0, NULL);
+
+    if (new_thread->handle == NULL) {
+        MZ_FREE(new_thread);
+        return MZ_INTERNAL_ERROR;
+    }
+
+    *thread = new_thread;
+    return MZ_OK;
+}
+
+int32_t mz_os_thread_join(void **thread) {
+    mz_os_thread *old_thread = NULL;
+    int32_t err = MZ_OK;
+
+    if (thread == NULL || *thread == NULL)
+        return MZ_PARAM_ERROR;
+
+    old_thread = (mz_os_thread *)*thread;
+    if (WaitForSingleObjectEx(old_thread->handle, INFINITE, FALSE) != WAIT_OBJECT_0)
+        err = MZ_INTERNAL_ERROR;
+
+    CloseHandle(old_thread->handle);
+    MZ_FREE(old_thread);
+    *thread = NULL;
+    return err;
+}
+
+int32_t mz_os_mutex_create(void **mutex) {
+    SRWLOCK *new_mutex = NULL;
+
+    if (mutex == NULL)
+        return MZ_PARAM_ERROR;
+
+    new_mutex = (SRWLOCK *)MZ_ALLOC(sizeof(SRWLOCK));
+    if (new_mutex == NULL)
+        return MZ_MEM_ERROR;
+
+    InitializeSRWLock(new_mutex);
+    *mutex = new_mutex;
+    return MZ_OK;
+}
+
+void mz_os_mutex_delete(void **mutex) {
+    if (mutex == NULL || *mutex == NULL)
+        return;
+    MZ_FREE(*mutex);
+    *mutex = NULL;
+}
+
+void mz_os_mutex_lock(void *mutex) {
+    if (mutex != NULL)
+        AcquireSRWLockExclusive((SRWLOCK *)mutex);
+}
+
+void mz_os_mutex_unlock(void *mutex) {
+    if (mutex != NULL)
+        ReleaseSRWLockExclusive((SRWLOCK *)mutex);
+}
+
+int32_t mz_os_cond_create(void **cond) {
+    CONDITION_VARIABLE *new_cond = NULL;
+
+    if (cond == NULL)
+        return MZ_PARAM_ERROR;
+
+    new_cond = (CONDITION_VARIABLE *)MZ_ALLOC(sizeof(CONDITION_VARIABLE));
+    if (new_cond == NULL)
+        return MZ_MEM_ERROR;
+
+    InitializeConditionVariable(new_cond);
+    *cond = new_cond;
+    return MZ_OK;
+}
+
+void mz_os_cond_delete(void **cond) {
+    if (cond == NULL || *cond == NULL)
+        return;
+    MZ_FREE(*cond);
+    *cond = NULL;
+}
+
+void mz_os_cond_wait(void *cond, void *mutex) {
+    if (cond != NULL && mutex != NULL)
+        SleepConditionVariableSRW((CONDITION_VARIABLE *)cond, (SRWLOCK *)mutex, INFINITE, 0);
+}
+
+void mz_os_cond_signal(void *cond) {
+    if (cond != NULL)
+        WakeConditionVariable((CONDITION_VARIABLE *)cond);
+}
+
+void mz_os_cond_broadcast(void *cond) {
+    if (cond != NULL)
+        WakeAllConditionVariable((CONDITION_VARIABLE *)cond);
+}
@@ -28,6 +28,12 @@ extern "C" {
 #define MZ_STREAM_PROP_COMPRESS_LEVEL       (9)
 #define MZ_STREAM_PROP_COMPRESS_METHOD      (10)
 #define MZ_STREAM_PROP_COMPRESS_WINDOW      (11)
+#define MZ_STREAM_PROP_COMPRESS_THREADS     (12)
+#define MZ_STREAM_PROP_COMPRESS_JOB_SIZE    (13)
+#define MZ_STREAM_PROP_MEMORY_LIMIT         (14)
+#define MZ_STREAM_PROP_BUFFER_SIZE          (15)
+#define MZ_STREAM_PROP_HMAC_THREAD          (16)
+#define MZ_STREAM_PROP_READ_ALL             (17)
 
 /***************************************************************************/
 
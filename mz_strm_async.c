@@ -0,0 +1,553 @@
+/* mz_strm_async.c -- Stream for reading ahead and writing behind on a thread
+   part of the minizip-ng project
+
+   Copyright (C) 2010-2021 Nathan Moinvaziri
+     https://github.com/zlib-ng/minizip-ng
+
+   This program is distributed under the terms of the same license as zlib.
+   See the accompanying LICENSE file for the full text of the license.
+*/
+
+#include "mz.h"
+#include "mz_os.h"
+#include "mz_strm.h"
+#include "mz_strm_async.h"
+
+/***************************************************************************/
+
+#define MZ_STREAM_ASYNC_BLOCK_COUNT     (3)
+#define MZ_STREAM_ASYNC_BLOCK_SIZE      (256 * 1024)
+
+#define MZ_STREAM_ASYNC_IDLE            (0)
+#define MZ_STREAM_ASYNC_READ            (1)
+#define MZ_STREAM_ASYNC_WRITE           (2)
+
+/***************************************************************************/
+
+static mz_stream_vtbl mz_stream_async_vtbl = {
+    mz_stream_async_open,
+    mz_stream_async_is_open,
+    mz_stream_async_read,
+    mz_stream_async_write,
+    mz_stream_async_tell,
+    mz_stream_async_seek,
+    mz_stream_async_close,
+    mz_stream_async_error,
+    mz_stream_async_create,
+    mz_stream_async_delete,
+    mz_stream_async_get_prop_int64,
+    mz_stream_async_set_prop_int64
+};
+
+/***************************************************************************/
+
+typedef struct mz_stream_async_block_s {
+    uint8_t     *data;
+    int32_t     len;
+    int32_t     pos;
+} mz_stream_async_block;
+
+typedef struct mz_stream_async_s {
+    mz_stream   stream;
+    int32_t     error;
+    int32_t     block_size;
+    mz_stream_async_block
+                blocks[MZ_STREAM_ASYNC_BLOCK_COUNT];
+    int32_t     head;       /* Oldest block read ahead or waiting to be written */
+    int32_t     count;      /* Number of blocks read ahead or waiting to be written */
+    int32_t     direction;
+    uint8_t     busy;       /* Thread is using the base stream */
+    uint8_t     eof;
+    uint8_t     stop;
+    int64_t     position;
+    void        *thread;
+    void        *mutex;
+    void        *work_cond;
+    void        *done_cond;
+} mz_stream_async;
+
+/***************************************************************************/
+
+static int32_t mz_stream_async_has_work(mz_stream_async *async) {
+    if (async->direction == MZ_STREAM_ASYNC_READ)
+        return (async->error == MZ_OK && !async->eof && async->count < MZ_STREAM_ASYNC_BLOCK_COUNT);
+    if (async->direction == MZ_STREAM_ASYNC_WRITE)
+        return (async->count > 0);
+    return 0;
+}
+
+static int32_t mz_stream_async_write_block(mz_stream_async *async, mz_stream_async_block *block) {
+    int32_t written = 0;
+    int32_t total = 0;
+
+    while (total < block->len) {
+        written = mz_stream_write(async->stream.base, block->data + total, block->len - total);
+        if (written < 0)
+            return written;
+        if (written == 0)
+            return MZ_WRITE_ERROR;
+        total += written;
+    }
+    return MZ_OK;
+}
+
+static void mz_stream_async_thread(void *userdata) {
+    mz_stream_async *async = (mz_stream_async *)userdata;
+    mz_stream_async_block *block = NULL;
+    int32_t bytes = 0;
+    int32_t err = MZ_OK;
+
+    mz_os_mutex_lock(async->mutex);
+
+    for (;;) {
+        while (!async->stop && !mz_stream_async_has_work(async))
+            mz_os_cond_wait(async->work_cond, async->mutex);
+        if (async->stop)
+            break;
+
+        async->busy = 1;
+
+        if (async->direction == MZ_STREAM_ASYNC_READ) {
+            /* Fill the block after the ones already read ahead */
+            block = &async->blocks[(async->head + async->count) % MZ_STREAM_ASYNC_BLOCK_COUNT];
+            mz_os_mutex_unlock(async->mutex);
+
+            bytes = mz_stream_read(async->stream.base, block->data, async->block_size);
+
+            mz_os_mutex_lock(async->mutex);
+            if (bytes < 0) {
+                async->error = bytes;
+            } else if (bytes == 0) {
+                async->eof = 1;
+            } else {
+                block->len = bytes;
+                block->pos = 0;
+                async->count += 1;
+            }
+        } else {
+            /* Write the oldest block, or discard it if a previous write failed */
+            block = &async->blocks[async->head];
+            err = async->error;
+            mz_os_mutex_unlock(async->mutex);
+
+            if (err == MZ_OK)
+                err = mz_stream_async_write_block(async, block);
+
+            mz_os_mutex_lock(async->mutex);
+            if (err != MZ_OK)
+                async->error = err;
+            block->len = 0;
+            block->pos = 0;
+            async->head = (async->head + 1) % MZ_STREAM_ASYNC_BLOCK_COUNT;
+            async->count -= 1;
+        }
+
+        async->busy = 0;
+        mz_os_cond_signal(async->done_cond);
+    }
+
+    mz_os_mutex_unlock(async->mutex);
+}
+
+static int32_t mz_stream_async_stop(void *stream) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    mz_stream_async_block *block = NULL;
+    int32_t direction = MZ_STREAM_ASYNC_IDLE;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+
+    if (async->thread == NULL)
+        return MZ_OK;
+
+    mz_os_mutex_lock(async->mutex);
+
+    direction = async->direction;
+    if (direction == MZ_STREAM_ASYNC_WRITE) {
+        /* Queue the partially filled block and wait for all blocks to be written */
+        if (async->count < MZ_STREAM_ASYNC_BLOCK_COUNT) {
+            block = &async->blocks[(async->head + async->count) % MZ_STREAM_ASYNC_BLOCK_COUNT];
+            if (block->len > 0) {
+                async->count += 1;
+                mz_os_cond_signal(async->work_cond);
+            }
+        }
+        while (async->count > 0)
+            mz_os_cond_wait(async->done_cond, async->mutex);
+    } else if (direction == MZ_STREAM_ASYNC_READ) {
+        /* Wait for the current read to finish and discard everything read ahead */
+        async->direction = MZ_STREAM_ASYNC_IDLE;
+        while (async->busy)
+            mz_os_cond_wait(async->done_cond, async->mutex);
+        for (i = 0; i < MZ_STREAM_ASYNC_BLOCK_COUNT; i += 1) {
+            async->blocks[i].len = 0;
+            async->blocks[i].pos = 0;
+        }
+        async->head = 0;
+        async->count = 0;
+        async->eof = 0;
+        async->error = MZ_OK;
+    }
+
+    async->direction = MZ_STREAM_ASYNC_IDLE;
+    err = async->error;
+
+    mz_os_mutex_unlock(async->mutex);
+    return err;
+}
+
+static int32_t mz_stream_async_start(void *stream, int32_t direction) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    int32_t was_reading = 0;
+    int32_t err = MZ_OK;
+
+    if (async->direction == direction)
+        return MZ_OK;
+
+    was_reading = (async->direction == MZ_STREAM_ASYNC_READ);
+
+    err = mz_stream_async_stop(stream);
+    /* Base stream is ahead of the data that was read so far */
+    if (err == MZ_OK && was_reading)
+        err = mz_stream_seek(async->stream.base, async->position, MZ_SEEK_SET);
+    if (err != MZ_OK)
+        return err;
+
+    mz_os_mutex_lock(async->mutex);
+    async->direction = direction;
+    mz_os_cond_signal(async->work_cond);
+    mz_os_mutex_unlock(async->mutex);
+    return MZ_OK;
+}
+
+static void mz_stream_async_end_thread(void *stream) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+
+    if (async->thread != NULL) {
+        mz_os_mutex_lock(async->mutex);
+        async->stop = 1;
+        mz_os_cond_signal(async->work_cond);
+        mz_os_mutex_unlock(async->mutex);
+
+        mz_os_thread_join(&async->thread);
+    }
+
+    if (async->done_cond != NULL)
+        mz_os_cond_delete(&async->done_cond);
+    if (async->work_cond != NULL)
+        mz_os_cond_delete(&async->work_cond);
+    if (async->mutex != NULL)
+        mz_os_mutex_delete(&async->mutex);
+
+    async->thread = NULL;
+    async->stop = 0;
+    async->busy = 0;
+    async->eof = 0;
+    async->head = 0;
+    async->count = 0;
+    async->direction = MZ_STREAM_ASYNC_IDLE;
+}
+
+/***************************************************************************/
+
+int32_t mz_stream_async_open(void *stream, const char *path, int32_t mode) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+
+    err = mz_stream_open(async->stream.base, path, mode);
+    if (err != MZ_OK)
+        return err;
+
+    async->error = MZ_OK;
+    async->position = mz_stream_tell(async->stream.base);
+    if (async->position < 0)
+        async->position = 0;
+
+    for (i = 0; i < MZ_STREAM_ASYNC_BLOCK_COUNT; i += 1) {
+        if (async->blocks[i].data == NULL)
+            async->blocks[i].data = (uint8_t *)MZ_ALLOC(async->block_size);
+        if (async->blocks[i].data == NULL)
+            err = MZ_MEM_ERROR;
+        async->blocks[i].len = 0;
+        async->blocks[i].pos = 0;
+    }
+
+    if (err == MZ_OK)
+        err = mz_os_mutex_create(&async->mutex);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&async->work_cond);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&async->done_cond);
+    if (err == MZ_OK)
+        err = mz_os_thread_create(&async->thread, mz_stream_async_thread, async);
+
+    /* Without a thread all reads and writes go directly to the base stream */
+    if (err != MZ_OK)
+        mz_stream_async_end_thread(stream);
+
+    return MZ_OK;
+}
+
+int32_t mz_stream_async_is_open(void *stream) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    /* Base stream may be in use by the thread, which only runs while open */
+    if (async->thread != NULL)
+        return MZ_OK;
+    return mz_stream_is_open(async->stream.base);
+}
+
+int32_t mz_stream_async_read(void *stream, void *buf, int32_t size) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    mz_stream_async_block *block = NULL;
+    int32_t bytes_to_copy = 0;
+    int32_t total = 0;
+    int32_t err = MZ_OK;
+
+    if (async->thread == NULL) {
+        total = mz_stream_read(async->stream.base, buf, size);
+        if (total > 0)
+            async->position += total;
+        return total;
+    }
+
+    err = mz_stream_async_start(stream, MZ_STREAM_ASYNC_READ);
+    if (err != MZ_OK)
+        return err;
+
+    while (total < size) {
+        mz_os_mutex_lock(async->mutex);
+        while (async->count == 0 && async->error == MZ_OK && !async->eof)
+            mz_os_cond_wait(async->done_cond, async->mutex);
+        err = async->error;
+        block = NULL;
+        if (async->count > 0)
+            block = &async->blocks[async->head];
+        mz_os_mutex_unlock(async->mutex);
+
+        if (block == NULL)
+            break;
+
+        /* Thread doesn't touch blocks that were read ahead until they are released */
+        bytes_to_copy = block->len - block->pos;
+        if (bytes_to_copy > size - total)
+            bytes_to_copy = size - total;
+
+        memcpy((uint8_t *)buf + total, block->data + block->pos, bytes_to_copy);
+
+        block->pos += bytes_to_copy;
+        total += bytes_to_copy;
+        async->position += bytes_to_copy;
+
+        if (block->pos == block->len) {
+            mz_os_mutex_lock(async->mutex);
+            async->head = (async->head + 1) % MZ_STREAM_ASYNC_BLOCK_COUNT;
+            async->count -= 1;
+            mz_os_cond_signal(async->work_cond);
+            mz_os_mutex_unlock(async->mutex);
+        }
+    }
+
+    if (total == 0 && err != MZ_OK)
+        return err;
+    return total;
+}
+
+int32_t mz_stream_async_write(void *stream, const void *buf, int32_t size) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    mz_stream_async_block *block = NULL;
+    int32_t bytes_to_copy = 0;
+    int32_t total = 0;
+    int32_t err = MZ_OK;
+
+    if (async->thread == NULL) {
+        total = mz_stream_write(async->stream.base, buf, size);
+        if (total > 0)
+            async->position += total;
+        return total;
+    }
+
+    err = mz_stream_async_start(stream, MZ_STREAM_ASYNC_WRITE);
+    if (err != MZ_OK)
+        return err;
+
+    while (total < size) {
+        mz_os_mutex_lock(async->mutex);
+        while (async->count == MZ_STREAM_ASYNC_BLOCK_COUNT && async->error == MZ_OK)
+            mz_os_cond_wait(async->done_cond, async->mutex);
+        err = async->error;
+        block = &async->blocks[(async->head + async->count) % MZ_STREAM_ASYNC_BLOCK_COUNT];
+        mz_os_mutex_unlock(async->mutex);
+
+        if (err != MZ_OK)
+            return err;
+
+        /* Thread doesn't touch the block being filled until it is queued */
+        bytes_to_copy = async->block_size - block->len;
+        if (bytes_to_copy > size - total)
+            bytes_to_copy = size - total;
+
+        memcpy(block->data + block->len, (const uint8_t *)buf + total, bytes_to_copy);
+
+        block->len += bytes_to_copy;
+        total += bytes_to_copy;
+        async->position += bytes_to_copy;
+
+        if (block->len == async->block_size) {
+            mz_os_mutex_lock(async->mutex);
+            async->count += 1;
+            mz_os_cond_signal(async->work_cond);
+            mz_os_mutex_unlock(async->mutex);
+        }
+    }
+
+    return total;
+}
+
+int64_t mz_stream_async_tell(void *stream) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    if (async->thread == NULL)
+        return mz_stream_tell(async->stream.base);
+    return async->position;
+}
+
+int32_t mz_stream_async_seek(void *stream, int64_t offset, int32_t origin) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    mz_stream_async_block *block = NULL;
+    int64_t block_start = 0;
+    int32_t err = MZ_OK;
+
+    if (async->thread == NULL)
+        return mz_stream_seek(async->stream.base, offset, origin);
+
+    if (origin == MZ_SEEK_CUR) {
+        offset += async->position;
+        origin = MZ_SEEK_SET;
+    }
+
+    /* Seeks within the block being read don't discard what was read ahead */
+    if (async->direction == MZ_STREAM_ASYNC_READ && origin == MZ_SEEK_SET) {
+        mz_os_mutex_lock(async->mutex);
+        if (async->count > 0)
+            block = &async->blocks[async->head];
+        mz_os_mutex_unlock(async->mutex);
+
+        if (block != NULL) {
+            block_start = async->position - block->pos;
+            if (offset >= block_start && offset < block_start + block->len) {
+                block->pos = (int32_t)(offset - block_start);
+                async->position = offset;
+                return MZ_OK;
+            }
+        }
+    }
+
+    err = mz_stream_async_stop(stream);
+    if (err != MZ_OK)
+        return err;
+
+    err = mz_stream_seek(async->stream.base, offset, origin);
+    if (err != MZ_OK)
+        return err;
+
+    if (origin == MZ_SEEK_SET)
+        async->position = offset;
+    else
+        async->position = mz_stream_tell(async->stream.base);
+    return MZ_OK;
+}
+
+int32_t mz_stream_async_close(void *stream) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    int32_t err = MZ_OK;
+    int32_t close_err = MZ_OK;
+
+    err = mz_stream_async_stop(stream);
+    mz_stream_async_end_thread(stream);
+
+    close_err = mz_stream_close(async->stream.base);
+    if (err == MZ_OK)
+        err = close_err;
+    return err;
+}
+
+int32_t mz_stream_async_error(void *stream) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    int32_t err = MZ_OK;
+
+    if (async->thread == NULL)
+        return mz_stream_error(async->stream.base);
+
+    mz_os_mutex_lock(async->mutex);
+    err = async->error;
+    mz_os_mutex_unlock(async->mutex);
+    return err;
+}
+
+int32_t mz_stream_async_get_prop_int64(void *stream, int32_t prop, int64_t *value) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    switch (prop) {
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = async->block_size;
+        return MZ_OK;
+    }
+    return MZ_EXIST_ERROR;
+}
+
+int32_t mz_stream_async_set_prop_int64(void *stream, int32_t prop, int64_t value) {
+    mz_stream_async *async = (mz_stream_async *)stream;
+    int32_t i = 0;
+
+    switch (prop) {
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        /* Size of each block read ahead or written behind, can't change while the thread is using them */
+        if (value <= 0 || value > INT32_MAX || async->thread != NULL)
+            return MZ_PARAM_ERROR;
+        if (async->block_size != (int32_t)value) {
+            for (i = 0; i < MZ_STREAM_ASYNC_BLOCK_COUNT; i += 1) {
+                if (async->blocks[i].data != NULL)
+                    MZ_FREE(async->blocks[i].data);
+                async->blocks[i].data = NULL;
+            }
+        }
+        async->block_size = (int32_t)value;
+        return MZ_OK;
+    }
+    return MZ_EXIST_ERROR;
+}
+
+void *mz_stream_async_create(void **stream) {
+    mz_stream_async *async = NULL;
+
+    async = (mz_stream_async *)MZ_ALLOC(sizeof(mz_stream_async));
+    if (async != NULL) {
+        memset(async, 0, sizeof(mz_stream_async));
+        async->stream.vtbl = &mz_stream_async_vtbl;
+        async->block_size = MZ_STREAM_ASYNC_BLOCK_SIZE;
+    }
+    if (stream != NULL)
+        *stream = async;
+
+    return async;
+}
+
+void mz_stream_async_delete(void **stream) {
+    mz_stream_async *async = NULL;
+    int32_t i = 0;
+
+    if (stream == NULL)
+        return;
+    async = (mz_stream_async *)*stream;
+    if (async != NULL) {
+        mz_stream_async_end_thread(async);
+        for (i = 0; i < MZ_STREAM_ASYNC_BLOCK_COUNT; i += 1) {
+            if (async->blocks[i].data != NULL)
+                MZ_FREE(async->blocks[i].data);
+        }
+        MZ_FREE(async);
+    }
+    *stream = NULL;
+}
+
+void *mz_stream_async_get_interface(void) {
+    return (void *)&mz_stream_async_vtbl;
+}
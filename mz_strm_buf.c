@@ -27,8 +27,8 @@ static mz_stream_vtbl mz_stream_buffered_vtbl = {
     mz_stream_buffered_error,
     mz_stream_buffered_create,
     mz_stream_buffered_delete,
-    NULL,
-    NULL
+    mz_stream_buffered_get_prop_int64,
+    mz_stream_buffered_set_prop_int64
 };
 
 /***************************************************************************/
@@ -36,19 +36,24 @@ static mz_stream_vtbl mz_stream_buffered_vtbl = {
 typedef struct mz_stream_buffered_s {
     mz_stream stream;
     int32_t   error;
-    char      readbuf[INT16_MAX];
+    char      *readbuf;
     int32_t   readbuf_len;
     int32_t   readbuf_pos;
     int32_t   readbuf_hits;
     int32_t   readbuf_misses;
-    char      writebuf[INT16_MAX];
+    char      *writebuf;
     int32_t   writebuf_len;
     int32_t   writebuf_pos;
     int32_t   writebuf_hits;
     int32_t   writebuf_misses;
+    int32_t   buffer_size;
+    int32_t   readahead;
     int64_t   position;
 } mz_stream_buffered;
 
+/* Smallest amount read ahead after a seek, doubled each time the buffer is read through */
+#define MZ_STREAM_BUFFERED_READAHEAD_MIN (4096)
+
 /***************************************************************************/
 
 #if 0
@@ -67,6 +72,7 @@ static int32_t mz_stream_buffered_reset(void *stream) {
     buffered->writebuf_len = 0;
     buffered->writebuf_pos = 0;
     buffered->position = 0;
+    buffered->readahead = MZ_STREAM_BUFFERED_READAHEAD_MIN;
 
     return MZ_OK;
 }
@@ -128,7 +134,7 @@ int32_t mz_stream_buffered_read(void *stream, void *buf, int32_t size) {
     mz_stream_buffered_print("Buffered - Read (size %" PRId32 " pos %" PRId64 ")\n", size, buffered->position);
 
     if (buffered->writebuf_len > 0) {
-        int64_t position  = buffered->position + buffered->writebuf_pos
+        int64_t position = buffered->position + buffered->writebuf_pos;
 
         mz_stream_buffered_print("Buffered - Switch from write to read, flushing (pos %" PRId64 ")\n", position);
 
@@ -137,28 +143,6 @@ int32_t mz_stream_buffered_read(void *stream, void *buf, int32_t size) {
     }
 
     while (bytes_left_to_read > 0) {
-        if ((buffered->readbuf_len == 0) || (buffered->readbuf_pos == buffered->readbuf_len)) {
-            if (buffered->readbuf_len == sizeof(buffered->readbuf)) {
-                buffered->readbuf_pos = 0;
-                buffered->readbuf_len = 0;
-            }
-
-            bytes_to_read = (int32_t)sizeof(buffered->readbuf) - (buffered->readbuf_len - buffered->readbuf_pos);
-            bytes_read = mz_stream_read(buffered->stream.base, buffered->readbuf + buffered->readbuf_pos, bytes_to_read);
-            if (bytes_read < 0)
-                return bytes_read;
-
-            buffered->readbuf_misses += 1;
-            buffered->readbuf_len += bytes_read;
-            buffered->position += bytes_read;
-
-            mz_stream_buffered_print("Buffered - Filled (read %" PRId32 "/%" PRId32 " buf %" PRId32 ":%" PRId32 " pos %" PRId64 ")\n",
-                bytes_read, bytes_to_read, buffered->readbuf_pos, buffered->readbuf_len, buffered->position);
-
-            if (bytes_read == 0)
-                break;
-        }
-
         if ((buffered->readbuf_len - buffered->readbuf_pos) > 0) {
             bytes_to_copy = buffered->readbuf_len - buffered->readbuf_pos;
             if (bytes_to_copy > bytes_left_to_read)
@@ -174,7 +158,64 @@ int32_t mz_stream_buffered_read(void *stream, void *buf, int32_t size) {
 
             mz_stream_buffered_print("Buffered - Emptied (copied %" PRId32 " remaining %" PRId32 " buf %" PRId32 ":%" PRId32 " pos %" PRId64 ")\n",
                 bytes_to_copy, bytes_left_to_read, buffered->readbuf_pos, buffered->readbuf_len, buffered->position);
+            continue;
+        }
+
+        buffered->readbuf_pos = 0;
+        buffered->readbuf_len = 0;
+
+        if (bytes_left_to_read >= buffered->buffer_size) {
+            /* Large reads go straight into the caller's buffer instead of being copied through ours */
+            bytes_read = mz_stream_read(buffered->stream.base, (char *)buf + buf_len, bytes_left_to_read);
+            if (bytes_read < 0)
+                return bytes_read;
+
+            buffered->readbuf_misses += 1;
+            buffered->readahead = buffered->buffer_size;
+            buffered->position += bytes_read;
+
+            mz_stream_buffered_print("Buffered - Direct (read %" PRId32 "/%" PRId32 " pos %" PRId64 ")\n",
+                bytes_read, bytes_left_to_read, buffered->position);
+
+            if (bytes_read == 0)
+                break;
+
+            buf_len += bytes_read;
+            bytes_left_to_read -= bytes_read;
+            continue;
+        }
+
+        if (buffered->readbuf == NULL) {
+            buffered->readbuf = (char *)MZ_ALLOC(buffered->buffer_size);
+            if (buffered->readbuf == NULL)
+                return MZ_MEM_ERROR;
         }
+
+        /* Read ahead more each time the buffer is read through without seeking elsewhere */
+        bytes_to_read = buffered->readahead;
+        if (bytes_to_read < bytes_left_to_read)
+            bytes_to_read = bytes_left_to_read;
+        if (bytes_to_read > buffered->buffer_size)
+            bytes_to_read = buffered->buffer_size;
+
+        bytes_read = mz_stream_read(buffered->stream.base, buffered->readbuf, bytes_to_read);
+        if (bytes_read < 0)
+            return bytes_read;
+
+        buffered->readbuf_misses += 1;
+        buffered->readbuf_len = bytes_read;
+        buffered->position += bytes_read;
+
+        if (buffered->readahead < buffered->buffer_size / 2)
+            buffered->readahead *= 2;
+        else
+            buffered->readahead = buffered->buffer_size;
+
+        mz_stream_buffered_print("Buffered - Filled (read %" PRId32 "/%" PRId32 " buf %" PRId32 ":%" PRId32 " pos %" PRId64 ")\n",
+            bytes_read, bytes_to_read, buffered->readbuf_pos, buffered->readbuf_len, buffered->position);
+
+        if (bytes_read == 0)
+            break;
     }
 
     return size - bytes_left_to_read;
@@ -207,11 +248,17 @@ int32_t mz_stream_buffered_write(void *stream, const void *buf, int32_t size) {
             return err;
     }
 
+    if (buffered->writebuf == NULL) {
+        buffered->writebuf = (char *)MZ_ALLOC(buffered->buffer_size);
+        if (buffered->writebuf == NULL)
+            return MZ_MEM_ERROR;
+    }
+
     while (bytes_left_to_write > 0) {
         bytes_used = buffered->writebuf_len;
         if (bytes_used > buffered->writebuf_pos)
             bytes_used = buffered->writebuf_pos;
-        bytes_to_copy = (int32_t)sizeof(buffered->writebuf) - bytes_used;
+        bytes_to_copy = buffered->buffer_size - bytes_used;
         if (bytes_to_copy > bytes_left_to_write)
             bytes_to_copy = bytes_left_to_write;
 
@@ -325,6 +372,7 @@ int32_t mz_stream_buffered_seek(void *stream, int64_t offset, int32_t origin) {
     buffered->readbuf_pos = 0;
     buffered->writebuf_len = 0;
     buffered->writebuf_pos = 0;
+    buffered->readahead = MZ_STREAM_BUFFERED_READAHEAD_MIN;
 
     return mz_stream_seek(buffered->stream.base, offset, origin);
 }
@@ -356,6 +404,37 @@ int32_t mz_stream_buffered_error(void *stream) {
     return mz_stream_error(buffered->stream.base);
 }
 
+int32_t mz_stream_buffered_get_prop_int64(void *stream, int32_t prop, int64_t *value) {
+    mz_stream_buffered *buffered = (mz_stream_buffered *)stream;
+    switch (prop) {
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = buffered->buffer_size;
+        return MZ_OK;
+    }
+    return MZ_EXIST_ERROR;
+}
+
+int32_t mz_stream_buffered_set_prop_int64(void *stream, int32_t prop, int64_t value) {
+    mz_stream_buffered *buffered = (mz_stream_buffered *)stream;
+    switch (prop) {
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        /* Buffers are allocated again on the next read or write, so they must be empty */
+        if (value <= 0 || value > INT32_MAX || buffered->readbuf_len > 0 || buffered->writebuf_len > 0)
+            return MZ_PARAM_ERROR;
+        if (buffered->buffer_size != (int32_t)value) {
+            if (buffered->readbuf != NULL)
+                MZ_FREE(buffered->readbuf);
+            if (buffered->writebuf != NULL)
+                MZ_FREE(buffered->writebuf);
+            buffered->readbuf = NULL;
+            buffered->writebuf = NULL;
+        }
+        buffered->buffer_size = (int32_t)value;
+        return MZ_OK;
+    }
+    return MZ_EXIST_ERROR;
+}
+
 void *mz_stream_buffered_create(void **stream) {
     mz_stream_buffered *buffered = NULL;
 
@@ -363,6 +442,8 @@ void *mz_stream_buffered_create(void **stream) {
     if (buffered != NULL) {
         memset(buffered, 0, sizeof(mz_stream_buffered));
         buffered->stream.vtbl = &mz_stream_buffered_vtbl;
+        buffered->buffer_size = INT16_MAX;
+        buffered->readahead = MZ_STREAM_BUFFERED_READAHEAD_MIN;
     }
     if (stream != NULL)
         *stream = buffered;
@@ -375,8 +456,13 @@ void mz_stream_buffered_delete(void **stream) {
     if (stream == NULL)
         return;
     buffered = (mz_stream_buffered *)*stream;
-    if (buffered != NULL)
+    if (buffered != NULL) {
+        if (buffered->readbuf != NULL)
+            MZ_FREE(buffered->readbuf);
+        if (buffered->writebuf != NULL)
+            MZ_FREE(buffered->writebuf);
         MZ_FREE(buffered);
+    }
     *stream = NULL;
 }
 
@@ -28,6 +28,9 @@ int32_t mz_stream_buffered_seek(void *stream, int64_t offset, int32_t origin);
 int32_t mz_stream_buffered_close(void *stream);
 int32_t mz_stream_buffered_error(void *stream);
 
+int32_t mz_stream_buffered_get_prop_int64(void *stream, int32_t prop, int64_t *value);
+int32_t mz_stream_buffered_set_prop_int64(void *stream, int32_t prop, int64_t value);
+
 void*   mz_stream_buffered_create(void **stream);
 void    mz_stream_buffered_delete(void **stream);
 
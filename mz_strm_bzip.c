@@ -39,7 +39,8 @@ typedef struct mz_stream_bzip_s {
     bz_stream   bzstream;
     int32_t     mode;
     int32_t     error;
-    uint8_t     buffer[INT16_MAX];
+    uint8_t     *buffer;
+    int32_t     buffer_size;
     int32_t     buffer_len;
     int16_t     stream_end;
     int64_t     total_in;
@@ -56,6 +57,12 @@ int32_t mz_stream_bzip_open(void *stream, const char *path, int32_t mode) {
 
     MZ_UNUSED(path);
 
+    if (bzip->buffer == NULL) {
+        bzip->buffer = (uint8_t *)MZ_ALLOC(bzip->buffer_size);
+        if (bzip->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
     bzip->bzstream.bzalloc = 0;
     bzip->bzstream.bzfree = 0;
     bzip->bzstream.opaque = 0;
@@ -64,6 +71,7 @@ int32_t mz_stream_bzip_open(void *stream, const char *path, int32_t mode) {
     bzip->bzstream.total_out_lo32 = 0;
     bzip->bzstream.total_out_hi32 = 0;
 
+    bzip->buffer_len = 0;
     bzip->total_in = 0;
     bzip->total_out = 0;
 
@@ -72,7 +80,7 @@ int32_t mz_stream_bzip_open(void *stream, const char *path, int32_t mode) {
         return MZ_SUPPORT_ERROR;
 #else
         bzip->bzstream.next_out = (char *)bzip->buffer;
-        bzip->bzstream.avail_out = sizeof(bzip->buffer);
+        bzip->bzstream.avail_out = (unsigned int)bzip->buffer_size;
 
         bzip->error = BZ2_bzCompressInit(&bzip->bzstream, bzip->level, 0, 0);
 #endif
@@ -119,7 +127,7 @@ int32_t mz_stream_bzip_read(void *stream, void *buf, int32_t size) {
     int32_t total_out = 0;
     int32_t in_bytes = 0;
     int32_t out_bytes = 0;
-    int32_t bytes_to_read = sizeof(bzip->buffer);
+    int32_t bytes_to_read = bzip->buffer_size;
     int32_t read = 0;
     int32_t err = BZ_OK;
 
@@ -203,7 +211,7 @@ static int32_t mz_stream_bzip_compress(void *stream, int flush) {
             if (err != MZ_OK)
                 return err;
 
-            bzip->bzstream.avail_out = sizeof(bzip->buffer);
+            bzip->bzstream.avail_out = (unsigned int)bzip->buffer_size;
             bzip->bzstream.next_out = (char *)bzip->buffer;
 
             bzip->buffer_len = 0;
@@ -318,6 +326,9 @@ int32_t mz_stream_bzip_get_prop_int64(void *stream, int32_t prop, int64_t *value
     case MZ_STREAM_PROP_HEADER_SIZE:
         *value = 0;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = bzip->buffer_size;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -336,6 +347,15 @@ int32_t mz_stream_bzip_set_prop_int64(void *stream, int32_t prop, int64_t value)
     case MZ_STREAM_PROP_TOTAL_IN_MAX:
         bzip->max_total_in = value;
         return MZ_OK;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        if (value <= 0 || value > INT32_MAX || bzip->initialized)
+            return MZ_PARAM_ERROR;
+        if (bzip->buffer != NULL && bzip->buffer_size != (int32_t)value) {
+            MZ_FREE(bzip->buffer);
+            bzip->buffer = NULL;
+        }
+        bzip->buffer_size = (int32_t)value;
+        return MZ_OK;
     }
     return MZ_EXIST_ERROR;
 }
@@ -348,6 +368,7 @@ void *mz_stream_bzip_create(void **stream) {
         memset(bzip, 0, sizeof(mz_stream_bzip));
         bzip->stream.vtbl = &mz_stream_bzip_vtbl;
         bzip->level = 6;
+        bzip->buffer_size = INT16_MAX;
     }
     if (stream != NULL)
         *stream = bzip;
@@ -360,8 +381,11 @@ void mz_stream_bzip_delete(void **stream) {
     if (stream == NULL)
         return;
     bzip = (mz_stream_bzip *)*stream;
-    if (bzip != NULL)
+    if (bzip != NULL) {
+        if (bzip->buffer != NULL)
+            MZ_FREE(bzip->buffer);
         MZ_FREE(bzip);
+    }
     *stream = NULL;
 }
 
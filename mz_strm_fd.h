@@ -0,0 +1,51 @@
+/* mz_strm_fd.h -- Stream for positional file descriptor access
+   part of the minizip-ng project
+
+   Copyright (C) 2010-2021 Nathan Moinvaziri
+     https://github.com/zlib-ng/minizip-ng
+
+   This program is distributed under the terms of the same license as zlib.
+   See the accompanying LICENSE file for the full text of the license.
+*/
+
+#ifndef MZ_STREAM_FD_H
+#define MZ_STREAM_FD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************/
+
+int32_t mz_stream_fd_open(void *stream, const char *path, int32_t mode);
+int32_t mz_stream_fd_is_open(void *stream);
+int32_t mz_stream_fd_read(void *stream, void *buf, int32_t size);
+int32_t mz_stream_fd_write(void *stream, const void *buf, int32_t size);
+int64_t mz_stream_fd_tell(void *stream);
+int32_t mz_stream_fd_seek(void *stream, int64_t offset, int32_t origin);
+int32_t mz_stream_fd_close(void *stream);
+int32_t mz_stream_fd_error(void *stream);
+
+int32_t mz_stream_fd_attach(void *stream, void *source);
+/* Opens stream as an independent cursor on the file descriptor of an open source stream,
+   the source stream must remain open while the stream is in use */
+
+int32_t mz_stream_fd_copy(void *target, void *source, int64_t size);
+/* Copies bytes from the source position to the target position inside the kernel, returns
+   MZ_SUPPORT_ERROR if the kernel can't copy between the files in which case neither has changed */
+
+int32_t mz_stream_fd_map_process(void *stream, int64_t size, void *target, mz_stream_write_cb write_cb);
+/* Memory maps bytes from the stream position and passes them to the write callback without copying */
+
+void*   mz_stream_fd_create(void **stream);
+void    mz_stream_fd_delete(void **stream);
+
+void*   mz_stream_fd_get_interface(void);
+
+/***************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
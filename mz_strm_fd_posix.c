@@ -0,0 +1,399 @@
+/* mz_strm_fd_posix.c -- Stream for positional file descriptor access for posix/linux
+   part of the minizip-ng project
+
+   Copyright (C) 2010-2021 Nathan Moinvaziri
+     https://github.com/zlib-ng/minizip-ng
+
+   This program is distributed under the terms of the same license as zlib.
+   See the accompanying LICENSE file for the full text of the license.
+*/
+
+/* Required for copy_file_range which is a gnu extension */
+#if defined(HAVE_COPY_FILE_RANGE) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+/* Required for pread and pwrite when strict posix compliance is requested */
+#if defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE)
+#  define _XOPEN_SOURCE 600
+#endif
+
+#include "mz.h"
+#include "mz_strm.h"
+#include "mz_strm_fd.h"
+
+#include <errno.h>
+#include <fcntl.h> /* open */
+#include <unistd.h> /* pread, pwrite, close, copy_file_range */
+#include <sys/mman.h> /* mmap */
+#include <sys/stat.h> /* fstat */
+#ifdef HAVE_SENDFILE
+#  include <sys/sendfile.h>
+#endif
+
+/***************************************************************************/
+
+#define MZ_STREAM_FD_COPY_MAX       (1024 * 1024 * 1024)
+#define MZ_STREAM_FD_MAP_WINDOW     (64 * 1024 * 1024)
+
+/* Fault in each window up front since it is read sequentially */
+#ifdef MAP_POPULATE
+#  define MZ_STREAM_FD_MAP_FLAGS    (MAP_SHARED | MAP_POPULATE)
+#else
+#  define MZ_STREAM_FD_MAP_FLAGS    (MAP_SHARED)
+#endif
+
+/***************************************************************************/
+
+static mz_stream_vtbl mz_stream_fd_vtbl = {
+    mz_stream_fd_open,
+    mz_stream_fd_is_open,
+    mz_stream_fd_read,
+    mz_stream_fd_write,
+    mz_stream_fd_tell,
+    mz_stream_fd_seek,
+    mz_stream_fd_close,
+    mz_stream_fd_error,
+    mz_stream_fd_create,
+    mz_stream_fd_delete,
+    NULL,
+    NULL
+};
+
+/***************************************************************************/
+
+typedef struct mz_stream_fd_s {
+    mz_stream   stream;
+    int32_t     error;
+    int         handle;
+    uint8_t     owned;
+    int64_t     position;
+} mz_stream_fd;
+
+/***************************************************************************/
+
+int32_t mz_stream_fd_open(void *stream, const char *path, int32_t mode) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    int flags = 0;
+
+    if (path == NULL)
+        return MZ_PARAM_ERROR;
+
+    if ((mode & MZ_OPEN_MODE_READWRITE) == MZ_OPEN_MODE_READ)
+        flags = O_RDONLY;
+    else if (mode & MZ_OPEN_MODE_APPEND)
+        flags = O_RDWR;
+    else if (mode & MZ_OPEN_MODE_CREATE)
+        flags = O_RDWR | O_CREAT | O_TRUNC;
+    else
+        return MZ_OPEN_ERROR;
+
+    fd->handle = open(path, flags, 0666);
+    if (fd->handle == -1) {
+        fd->error = errno;
+        return MZ_OPEN_ERROR;
+    }
+
+    fd->owned = 1;
+    fd->position = 0;
+
+    if (mode & MZ_OPEN_MODE_APPEND)
+        return mz_stream_fd_seek(stream, 0, MZ_SEEK_END);
+
+    return MZ_OK;
+}
+
+int32_t mz_stream_fd_is_open(void *stream) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    if (fd->handle == -1)
+        return MZ_OPEN_ERROR;
+    return MZ_OK;
+}
+
+int32_t mz_stream_fd_read(void *stream, void *buf, int32_t size) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    int32_t total_read = 0;
+    ssize_t read = 0;
+
+    while (total_read < size) {
+        read = pread(fd->handle, (uint8_t *)buf + total_read, (size_t)(size - total_read),
+            (off_t)fd->position);
+        if (read < 0) {
+            if (errno == EINTR)
+                continue;
+            fd->error = errno;
+            return MZ_READ_ERROR;
+        }
+        if (read == 0)
+            break;
+        total_read += (int32_t)read;
+        fd->position += read;
+    }
+
+    return total_read;
+}
+
+int32_t mz_stream_fd_write(void *stream, const void *buf, int32_t size) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    int32_t total_written = 0;
+    ssize_t written = 0;
+
+    while (total_written < size) {
+        written = pwrite(fd->handle, (const uint8_t *)buf + total_written,
+            (size_t)(size - total_written), (off_t)fd->position);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            fd->error = errno;
+            return MZ_WRITE_ERROR;
+        }
+        if (written == 0)
+            break;
+        total_written += (int32_t)written;
+        fd->position += written;
+    }
+
+    return total_written;
+}
+
+int64_t mz_stream_fd_tell(void *stream) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    if (fd->handle == -1)
+        return MZ_TELL_ERROR;
+    return fd->position;
+}
+
+int32_t mz_stream_fd_seek(void *stream, int64_t offset, int32_t origin) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    struct stat file_stat;
+    int64_t new_pos = 0;
+
+    if (fd->handle == -1)
+        return MZ_SEEK_ERROR;
+
+    switch (origin) {
+    case MZ_SEEK_CUR:
+        new_pos = fd->position + offset;
+        break;
+    case MZ_SEEK_END:
+        if (fstat(fd->handle, &file_stat) != 0) {
+            fd->error = errno;
+            return MZ_SEEK_ERROR;
+        }
+        new_pos = (int64_t)file_stat.st_size + offset;
+        break;
+    case MZ_SEEK_SET:
+        new_pos = offset;
+        break;
+    default:
+        return MZ_SEEK_ERROR;
+    }
+
+    if (new_pos < 0)
+        return MZ_SEEK_ERROR;
+
+    fd->position = new_pos;
+    return MZ_OK;
+}
+
+int32_t mz_stream_fd_close(void *stream) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    int32_t closed = 0;
+    if (fd->handle != -1 && fd->owned)
+        closed = close(fd->handle);
+    fd->handle = -1;
+    fd->owned = 0;
+    if (closed != 0) {
+        fd->error = errno;
+        return MZ_CLOSE_ERROR;
+    }
+    return MZ_OK;
+}
+
+int32_t mz_stream_fd_error(void *stream) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    return fd->error;
+}
+
+int32_t mz_stream_fd_attach(void *stream, void *source) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    mz_stream_fd *source_fd = (mz_stream_fd *)source;
+
+    if (fd == NULL || source_fd == NULL || source_fd->handle == -1)
+        return MZ_PARAM_ERROR;
+
+    mz_stream_fd_close(stream);
+
+    fd->handle = source_fd->handle;
+    fd->owned = 0;
+    fd->position = 0;
+    return MZ_OK;
+}
+
+#if defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_SENDFILE)
+static int32_t mz_stream_fd_copy_is_unsupported(int error) {
+    /* Errors returned when the kernel can't copy between the two descriptors */
+    return (error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP ||
+        error == EBADF || error == ESPIPE);
+}
+#endif
+
+int32_t mz_stream_fd_copy(void *target, void *source, int64_t size) {
+    mz_stream_fd *target_fd = (mz_stream_fd *)target;
+    mz_stream_fd *source_fd = (mz_stream_fd *)source;
+    int64_t copied = 0;
+#if defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_SENDFILE)
+    ssize_t result = 0;
+    off_t source_pos = 0;
+    size_t chunk = 0;
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+    off_t target_pos = 0;
+#endif
+
+    if (target_fd == NULL || source_fd == NULL || size < 0)
+        return MZ_PARAM_ERROR;
+    if (target_fd->handle == -1 || source_fd->handle == -1)
+        return MZ_PARAM_ERROR;
+
+#ifdef HAVE_COPY_FILE_RANGE
+    while (copied < size) {
+        source_pos = (off_t)(source_fd->position + copied);
+        target_pos = (off_t)(target_fd->position + copied);
+        chunk = MZ_STREAM_FD_COPY_MAX;
+        if ((int64_t)chunk > size - copied)
+            chunk = (size_t)(size - copied);
+
+        result = copy_file_range(source_fd->handle, &source_pos, target_fd->handle, &target_pos, chunk, 0);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            /* Fall back to sendfile if nothing has been copied yet */
+            if (copied == 0 && mz_stream_fd_copy_is_unsupported(errno))
+                break;
+            target_fd->error = errno;
+            return MZ_WRITE_ERROR;
+        }
+        if (result == 0)
+            break;
+        copied += result;
+    }
+#endif
+#ifdef HAVE_SENDFILE
+    if (copied == 0 && size > 0) {
+        /* Sendfile writes at the current offset of the target descriptor */
+        if (lseek(target_fd->handle, (off_t)target_fd->position, SEEK_SET) == -1) {
+            target_fd->error = errno;
+            return MZ_SEEK_ERROR;
+        }
+
+        while (copied < size) {
+            source_pos = (off_t)(source_fd->position + copied);
+            chunk = MZ_STREAM_FD_COPY_MAX;
+            if ((int64_t)chunk > size - copied)
+                chunk = (size_t)(size - copied);
+
+            result = sendfile(target_fd->handle, source_fd->handle, &source_pos, chunk);
+            if (result < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (copied == 0 && mz_stream_fd_copy_is_unsupported(errno))
+                    break;
+                target_fd->error = errno;
+                return MZ_WRITE_ERROR;
+            }
+            if (result == 0)
+                break;
+            copied += result;
+        }
+    }
+#endif
+
+    /* Nothing has been copied so the caller can still copy through a buffer */
+    if (copied == 0 && size > 0)
+        return MZ_SUPPORT_ERROR;
+    if (copied < size)
+        return MZ_READ_ERROR;
+
+    source_fd->position += size;
+    target_fd->position += size;
+    return MZ_OK;
+}
+
+int32_t mz_stream_fd_map_process(void *stream, int64_t size, void *target, mz_stream_write_cb write_cb) {
+    mz_stream_fd *fd = (mz_stream_fd *)stream;
+    long page_size = sysconf(_SC_PAGESIZE);
+    int64_t position = 0;
+    int64_t map_pos = 0;
+    int32_t map_delta = 0;
+    int32_t chunk = 0;
+    int32_t written = 0;
+    void *map = NULL;
+
+    if (fd == NULL || write_cb == NULL || size < 0)
+        return MZ_PARAM_ERROR;
+    if (fd->handle == -1)
+        return MZ_PARAM_ERROR;
+    if (page_size <= 0)
+        return MZ_SUPPORT_ERROR;
+
+    position = fd->position;
+
+    while (size > 0) {
+        /* Map a window at a time so large files don't exhaust the address space */
+        map_delta = (int32_t)(position % page_size);
+        map_pos = position - map_delta;
+        chunk = MZ_STREAM_FD_MAP_WINDOW;
+        if ((int64_t)chunk > size)
+            chunk = (int32_t)size;
+
+        map = mmap(NULL, (size_t)chunk + map_delta, PROT_READ, MZ_STREAM_FD_MAP_FLAGS,
+            fd->handle, (off_t)map_pos);
+        if (map == MAP_FAILED) {
+            fd->error = errno;
+            return MZ_READ_ERROR;
+        }
+
+        written = write_cb(target, (const uint8_t *)map + map_delta, chunk);
+        munmap(map, (size_t)chunk + map_delta);
+
+        if (written != chunk)
+            return MZ_WRITE_ERROR;
+
+        position += chunk;
+        size -= chunk;
+    }
+
+    fd->position = position;
+    return MZ_OK;
+}
+
+void *mz_stream_fd_create(void **stream) {
+    mz_stream_fd *fd = NULL;
+
+    fd = (mz_stream_fd *)MZ_ALLOC(sizeof(mz_stream_fd));
+    if (fd != NULL) {
+        memset(fd, 0, sizeof(mz_stream_fd));
+        fd->stream.vtbl = &mz_stream_fd_vtbl;
+        fd->handle = -1;
+    }
+    if (stream != NULL)
+        *stream = fd;
+
+    return fd;
+}
+
+void mz_stream_fd_delete(void **stream) {
+    mz_stream_fd *fd = NULL;
+    if (stream == NULL)
+        return;
+    fd = (mz_stream_fd *)*stream;
+    if (fd != NULL) {
+        mz_stream_fd_close(fd);
+        MZ_FREE(fd);
+    }
+    *stream = NULL;
+}
+
+void *mz_stream_fd_get_interface(void) {
+    return (void *)&mz_stream_fd_vtbl;
+}
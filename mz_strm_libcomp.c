@@ -38,7 +38,8 @@ typedef struct mz_stream_libcomp_s {
     mz_stream   stream;
     compression_stream
                 cstream;
-    uint8_t     buffer[INT16_MAX];
+    uint8_t     *buffer;
+    int32_t     buffer_size;
     int32_t     buffer_len;
     int64_t     total_in;
     int64_t     total_out;
@@ -62,8 +63,16 @@ int32_t mz_stream_libcomp_open(void *stream, const char *path, int32_t mode) {
     if (libcomp->method == 0)
         return MZ_PARAM_ERROR;
 
+    if (libcomp->buffer == NULL) {
+        libcomp->buffer = (uint8_t *)MZ_ALLOC(libcomp->buffer_size);
+        if (libcomp->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    libcomp->buffer_len = 0;
     libcomp->total_in = 0;
     libcomp->total_out = 0;
+    libcomp->error = 0;
 
     if (mode & MZ_OPEN_MODE_WRITE) {
 #ifdef MZ_ZIP_NO_COMPRESSION
@@ -121,7 +130,7 @@ int32_t mz_stream_libcomp_read(void *stream, void *buf, int32_t size) {
     int32_t total_out = 0;
     int32_t in_bytes = 0;
     int32_t out_bytes = 0;
-    int32_t bytes_to_read = sizeof(libcomp->buffer);
+    int32_t bytes_to_read = libcomp->buffer_size;
     int32_t read = 0;
     int32_t err = MZ_OK;
     int16_t flags = 0;
@@ -206,7 +215,7 @@ static int32_t mz_stream_libcomp_deflate(void *stream, int flush) {
                 return err;
             }
 
-            libcomp->cstream.dst_size = sizeof(libcomp->buffer);
+            libcomp->cstream.dst_size = (size_t)libcomp->buffer_size;
             libcomp->cstream.dst_ptr = libcomp->buffer;
 
             libcomp->buffer_len = 0;
@@ -310,6 +319,9 @@ int32_t mz_stream_libcomp_get_prop_int64(void *stream, int32_t prop, int64_t *va
     case MZ_STREAM_PROP_HEADER_SIZE:
         *value = 0;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = libcomp->buffer_size;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -325,6 +337,15 @@ int32_t mz_stream_libcomp_set_prop_int64(void *stream, int32_t prop, int64_t val
     case MZ_STREAM_PROP_TOTAL_IN_MAX:
         libcomp->max_total_in = value;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        if (value <= 0 || value > INT32_MAX || libcomp->initialized)
+            return MZ_PARAM_ERROR;
+        if (libcomp->buffer != NULL && libcomp->buffer_size != (int32_t)value) {
+            MZ_FREE(libcomp->buffer);
+            libcomp->buffer = NULL;
+        }
+        libcomp->buffer_size = (int32_t)value;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -338,6 +359,7 @@ void *mz_stream_libcomp_create(void **stream) {
     if (libcomp != NULL) {
         memset(libcomp, 0, sizeof(mz_stream_libcomp));
         libcomp->stream.vtbl = &mz_stream_libcomp_vtbl;
+        libcomp->buffer_size = INT16_MAX;
     }
     if (stream != NULL)
         *stream = libcomp;
@@ -350,7 +372,10 @@ void mz_stream_libcomp_delete(void **stream) {
     if (stream == NULL)
         return;
     libcomp = (mz_stream_libcomp *)*stream;
-    if (libcomp != NULL)
+    if (libcomp != NULL) {
+        if (libcomp->buffer != NULL)
+            MZ_FREE(libcomp->buffer);
         MZ_FREE(libcomp);
+    }
     *stream = NULL;
 }
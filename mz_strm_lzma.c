@@ -21,6 +21,14 @@
 #define MZ_LZMA_ZIP_HEADER_SIZE   (5)
 #define MZ_LZMA_ALONE_HEADER_SIZE (MZ_LZMA_ZIP_HEADER_SIZE + 8)
 
+/* Multithreaded xz encoding requires liblzma 5.2 and decoding requires liblzma 5.4 */
+#if defined(HAVE_LZMA_MT) && (LZMA_VERSION >= UINT32_C(50020002))
+#  define MZ_LZMA_ENCODER_MT
+#endif
+#if defined(HAVE_LZMA_MT) && (LZMA_VERSION >= UINT32_C(50040002))
+#  define MZ_LZMA_DECODER_MT
+#endif
+
 /***************************************************************************/
 
 static mz_stream_vtbl mz_stream_lzma_vtbl = {
@@ -45,7 +53,8 @@ typedef struct mz_stream_lzma_s {
     lzma_stream lstream;
     int32_t     mode;
     int32_t     error;
-    uint8_t     buffer[INT16_MAX];
+    uint8_t     *buffer;
+    int32_t     buffer_size;
     int32_t     buffer_len;
     int64_t     total_in;
     int64_t     total_out;
@@ -56,10 +65,62 @@ typedef struct mz_stream_lzma_s {
     int32_t     header_size;
     uint32_t    preset;
     int16_t     method;
+    int32_t     thread_count;
+    int64_t     block_size;
+    int64_t     memory_limit;
 } mz_stream_lzma;
 
 /***************************************************************************/
 
+#if defined(MZ_LZMA_ENCODER_MT) && !defined(MZ_ZIP_NO_COMPRESSION)
+static lzma_ret mz_stream_lzma_encoder_mt(mz_stream_lzma *lzma, lzma_filter *filters) {
+    lzma_mt mt;
+    lzma_ret err = LZMA_OK;
+
+    memset(&mt, 0, sizeof(mt));
+    mt.threads = (uint32_t)lzma->thread_count;
+    mt.filters = filters;
+    mt.check = LZMA_CHECK_CRC64;
+    if (lzma->block_size > 0)
+        mt.block_size = (uint64_t)lzma->block_size;
+
+    /* Each thread buffers a few blocks, so use fewer threads to stay within the memory limit */
+    if (lzma->memory_limit > 0) {
+        while (mt.threads > 1 && lzma_stream_encoder_mt_memusage(&mt) > (uint64_t)lzma->memory_limit)
+            mt.threads -= 1;
+    }
+
+    err = lzma_stream_encoder_mt(&lzma->lstream, &mt);
+
+    /* Encode on this thread if liblzma was built without threads */
+    if (err == LZMA_OPTIONS_ERROR || err == LZMA_UNSUPPORTED_CHECK || err == LZMA_PROG_ERROR)
+        err = lzma_stream_encoder(&lzma->lstream, filters, LZMA_CHECK_CRC64);
+    return err;
+}
+#endif
+
+#if defined(MZ_LZMA_DECODER_MT) && !defined(MZ_ZIP_NO_DECOMPRESSION)
+static lzma_ret mz_stream_lzma_decoder_mt(mz_stream_lzma *lzma) {
+    lzma_mt mt;
+    lzma_ret err = LZMA_OK;
+
+    memset(&mt, 0, sizeof(mt));
+    mt.threads = (uint32_t)lzma->thread_count;
+
+    /* Blocks are decoded one at a time instead of failing when over the memory limit */
+    mt.memlimit_threading = UINT64_MAX;
+    if (lzma->memory_limit > 0)
+        mt.memlimit_threading = (uint64_t)lzma->memory_limit;
+    mt.memlimit_stop = UINT64_MAX;
+
+    err = lzma_stream_decoder_mt(&lzma->lstream, &mt);
+
+    if (err == LZMA_OPTIONS_ERROR || err == LZMA_PROG_ERROR)
+        err = lzma_stream_decoder(&lzma->lstream, UINT64_MAX, 0);
+    return err;
+}
+#endif
+
 int32_t mz_stream_lzma_open(void *stream, const char *path, int32_t mode) {
     mz_stream_lzma *lzma = (mz_stream_lzma *)stream;
     lzma_filter filters[LZMA_FILTERS_MAX + 1];
@@ -70,14 +131,22 @@ int32_t mz_stream_lzma_open(void *stream, const char *path, int32_t mode) {
 
     MZ_UNUSED(path);
 
+    if (lzma->buffer == NULL) {
+        lzma->buffer = (uint8_t *)MZ_ALLOC(lzma->buffer_size);
+        if (lzma->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
     memset(&opt_lzma, 0, sizeof(opt_lzma));
 
     lzma->lstream.total_in = 0;
     lzma->lstream.total_out = 0;
 
+    lzma->buffer_len = 0;
     lzma->total_in = 0;
     lzma->total_out = 0;
     lzma->header = 0;
+    lzma->header_size = 0;
 
     if (mode & MZ_OPEN_MODE_WRITE) {
 #ifdef MZ_ZIP_NO_COMPRESSION
@@ -87,7 +156,7 @@ int32_t mz_stream_lzma_open(void *stream, const char *path, int32_t mode) {
         return MZ_SUPPORT_ERROR;
 #else
         lzma->lstream.next_out = lzma->buffer;
-        lzma->lstream.avail_out = sizeof(lzma->buffer);
+        lzma->lstream.avail_out = (size_t)lzma->buffer_size;
 
         if (lzma_lzma_preset(&opt_lzma, lzma->preset))
             return MZ_OPEN_ERROR;
@@ -113,8 +182,14 @@ int32_t mz_stream_lzma_open(void *stream, const char *path, int32_t mode) {
             lzma->total_out += MZ_LZMA_MAGIC_SIZE;
 
             lzma->error = lzma_alone_encoder(&lzma->lstream, &opt_lzma);
-        } else if (lzma->method == MZ_COMPRESS_METHOD_XZ)
+        } else if (lzma->method == MZ_COMPRESS_METHOD_XZ) {
+#ifdef MZ_LZMA_ENCODER_MT
+            if (lzma->thread_count > 1)
+                lzma->error = mz_stream_lzma_encoder_mt(lzma, filters);
+            else
+#endif
             lzma->error = lzma_stream_encoder(&lzma->lstream, filters, LZMA_CHECK_CRC64);
+        }
 #endif
     } else if (mode & MZ_OPEN_MODE_READ) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
@@ -135,8 +210,14 @@ int32_t mz_stream_lzma_open(void *stream, const char *path, int32_t mode) {
             lzma->total_in += MZ_LZMA_MAGIC_SIZE;
 
             lzma->error = lzma_alone_decoder(&lzma->lstream, UINT64_MAX);
-        } else if (lzma->method == MZ_COMPRESS_METHOD_XZ)
+        } else if (lzma->method == MZ_COMPRESS_METHOD_XZ) {
+#ifdef MZ_LZMA_DECODER_MT
+            if (lzma->thread_count > 1)
+                lzma->error = mz_stream_lzma_decoder_mt(lzma);
+            else
+#endif
             lzma->error = lzma_stream_decoder(&lzma->lstream, UINT64_MAX, 0);
+        }
 #endif
     }
 
@@ -171,7 +252,7 @@ int32_t mz_stream_lzma_read(void *stream, void *buf, int32_t size) {
     int32_t total_out = 0;
     int32_t in_bytes = 0;
     int32_t out_bytes = 0;
-    int32_t bytes_to_read = sizeof(lzma->buffer);
+    int32_t bytes_to_read = lzma->buffer_size;
     int32_t read = 0;
     int32_t err = LZMA_OK;
 
@@ -205,7 +286,7 @@ int32_t mz_stream_lzma_read(void *stream, void *buf, int32_t size) {
                     memcpy(lzma->buffer + MZ_LZMA_ZIP_HEADER_SIZE, &uncompressed_size, sizeof(uncompressed_size));
 
                     read += sizeof(uncompressed_size);
-                    bytes_to_read = sizeof(lzma->buffer);
+                    bytes_to_read = lzma->buffer_size;
 
                     lzma->total_in -= sizeof(uncompressed_size);
                     lzma->header = 0;
@@ -294,7 +375,7 @@ static int32_t mz_stream_lzma_code(void *stream, int32_t flush) {
             if (err != MZ_OK)
                 return err;
 
-            lzma->lstream.avail_out = sizeof(lzma->buffer);
+            lzma->lstream.avail_out = (size_t)lzma->buffer_size;
             lzma->lstream.next_out = lzma->buffer;
 
             lzma->buffer_len = 0;
@@ -363,16 +444,13 @@ int32_t mz_stream_lzma_close(void *stream) {
 #ifdef MZ_ZIP_NO_COMPRESSION
         return MZ_SUPPORT_ERROR;
 #else
+        /* Coder memory is kept until the stream is deleted, liblzma reuses it when initialized again */
         mz_stream_lzma_code(stream, LZMA_FINISH);
         mz_stream_lzma_flush(stream);
-
-        lzma_end(&lzma->lstream);
 #endif
     } else if (lzma->mode & MZ_OPEN_MODE_READ) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
         return MZ_SUPPORT_ERROR;
-#else
-        lzma_end(&lzma->lstream);
 #endif
     }
 
@@ -406,6 +484,9 @@ int32_t mz_stream_lzma_get_prop_int64(void *stream, int32_t prop, int64_t *value
     case MZ_STREAM_PROP_HEADER_SIZE:
         *value = MZ_LZMA_MAGIC_SIZE;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = lzma->buffer_size;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -432,6 +513,25 @@ int32_t mz_stream_lzma_set_prop_int64(void *stream, int32_t prop, int64_t value)
             return MZ_PARAM_ERROR;
         lzma->max_total_out = value;
         break;
+    case MZ_STREAM_PROP_COMPRESS_THREADS:
+        lzma->thread_count = (int32_t)value;
+        break;
+    case MZ_STREAM_PROP_COMPRESS_JOB_SIZE:
+        lzma->block_size = value;
+        break;
+    case MZ_STREAM_PROP_MEMORY_LIMIT:
+        lzma->memory_limit = value;
+        break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        /* Buffer must hold the whole lzma alone header */
+        if (value < MZ_LZMA_ALONE_HEADER_SIZE || value > INT32_MAX || lzma->initialized)
+            return MZ_PARAM_ERROR;
+        if (lzma->buffer != NULL && lzma->buffer_size != (int32_t)value) {
+            MZ_FREE(lzma->buffer);
+            lzma->buffer = NULL;
+        }
+        lzma->buffer_size = (int32_t)value;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -448,6 +548,7 @@ void *mz_stream_lzma_create(void **stream) {
         lzma->method = MZ_COMPRESS_METHOD_LZMA;
         lzma->preset = LZMA_PRESET_DEFAULT;
         lzma->max_total_out = -1;
+        lzma->buffer_size = INT16_MAX;
     }
     if (stream != NULL)
         *stream = lzma;
@@ -460,8 +561,12 @@ void mz_stream_lzma_delete(void **stream) {
     if (stream == NULL)
         return;
     lzma = (mz_stream_lzma *)*stream;
-    if (lzma != NULL)
+    if (lzma != NULL) {
+        lzma_end(&lzma->lstream);
+        if (lzma->buffer != NULL)
+            MZ_FREE(lzma->buffer);
         MZ_FREE(lzma);
+    }
     *stream = NULL;
 }
 
@@ -0,0 +1,45 @@
+/* mz_strm_mmap.h -- Stream for memory mapped file access
+   part of the minizip-ng project
+
+   Copyright (C) 2010-2021 Nathan Moinvaziri
+     https://github.com/zlib-ng/minizip-ng
+
+   This program is distributed under the terms of the same license as zlib.
+   See the accompanying LICENSE file for the full text of the license.
+*/
+
+#ifndef MZ_STREAM_MMAP_H
+#define MZ_STREAM_MMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************/
+
+int32_t mz_stream_mmap_open(void *stream, const char *path, int32_t mode);
+int32_t mz_stream_mmap_is_open(void *stream);
+int32_t mz_stream_mmap_read(void *stream, void *buf, int32_t size);
+int32_t mz_stream_mmap_write(void *stream, const void *buf, int32_t size);
+int64_t mz_stream_mmap_tell(void *stream);
+int32_t mz_stream_mmap_seek(void *stream, int64_t offset, int32_t origin);
+int32_t mz_stream_mmap_close(void *stream);
+int32_t mz_stream_mmap_error(void *stream);
+
+int32_t mz_stream_mmap_get_buffer(void *stream, const void **buf);
+int32_t mz_stream_mmap_attach(void *stream, void *source);
+/* Opens stream as an independent cursor on the mapping of an open source stream,
+   the source stream must remain open while the stream is in use */
+
+void*   mz_stream_mmap_create(void **stream);
+void    mz_stream_mmap_delete(void **stream);
+
+void*   mz_stream_mmap_get_interface(void);
+
+/***************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+/* mz_strm_mmap_posix.c -- Stream for memory mapped file access for posix/linux
+   part of the minizip-ng project
+
+   Copyright (C) 2010-2021 Nathan Moinvaziri
+     https://github.com/zlib-ng/minizip-ng
+
+   This program is distributed under the terms of the same license as zlib.
+   See the accompanying LICENSE file for the full text of the license.
+*/
+
+
+#include "mz.h"
+#include "mz_strm.h"
+#include "mz_strm_mmap.h"
+
+#include <errno.h>
+#include <fcntl.h> /* open */
+#include <unistd.h> /* close */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* fstat */
+
+/***************************************************************************/
+
+static mz_stream_vtbl mz_stream_mmap_vtbl = {
+    mz_stream_mmap_open,
+    mz_stream_mmap_is_open,
+    mz_stream_mmap_read,
+    mz_stream_mmap_write,
+    mz_stream_mmap_tell,
+    mz_stream_mmap_seek,
+    mz_stream_mmap_close,
+    mz_stream_mmap_error,
+    mz_stream_mmap_create,
+    mz_stream_mmap_delete,
+    NULL,
+    NULL
+};
+
+/***************************************************************************/
+
+typedef struct mz_stream_mmap_s {
+    mz_stream   stream;
+    int32_t     error;
+    int32_t     opened;
+    uint8_t     owned;
+    uint8_t     *buffer;
+    int64_t     size;
+    int64_t     position;
+} mz_stream_mmap;
+
+/***************************************************************************/
+
+int32_t mz_stream_mmap_open(void *stream, const char *path, int32_t mode) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    struct stat file_stat;
+    void *buffer = NULL;
+    int fd = -1;
+
+    if (path == NULL)
+        return MZ_PARAM_ERROR;
+
+    /* Mappings are only supported for reading */
+    if ((mode & MZ_OPEN_MODE_READWRITE) != MZ_OPEN_MODE_READ)
+        return MZ_OPEN_ERROR;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        mmap_stream->error = errno;
+        return MZ_OPEN_ERROR;
+    }
+
+    memset(&file_stat, 0, sizeof(file_stat));
+    if (fstat(fd, &file_stat) != 0) {
+        mmap_stream->error = errno;
+        close(fd);
+        return MZ_OPEN_ERROR;
+    }
+
+    if ((file_stat.st_size < 0) || ((uint64_t)file_stat.st_size > (uint64_t)SIZE_MAX)) {
+        close(fd);
+        return MZ_OPEN_ERROR;
+    }
+
+    /* Empty files can not be mapped but can still be opened */
+    if (file_stat.st_size > 0) {
+        buffer = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (buffer == MAP_FAILED) {
+            mmap_stream->error = errno;
+            close(fd);
+            return MZ_OPEN_ERROR;
+        }
+    }
+
+    /* Mapping stays valid after the descriptor is closed */
+    close(fd);
+
+    mmap_stream->buffer = (uint8_t *)buffer;
+    mmap_stream->size = (int64_t)file_stat.st_size;
+    mmap_stream->position = 0;
+    mmap_stream->opened = 1;
+    mmap_stream->owned = 1;
+    return MZ_OK;
+}
+
+int32_t mz_stream_mmap_is_open(void *stream) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    if (!mmap_stream->opened)
+        return MZ_OPEN_ERROR;
+    return MZ_OK;
+}
+
+int32_t mz_stream_mmap_read(void *stream, void *buf, int32_t size) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+
+    if (mmap_stream->position >= mmap_stream->size)
+        return 0;
+    if (size > mmap_stream->size - mmap_stream->position)
+        size = (int32_t)(mmap_stream->size - mmap_stream->position);
+    if (size <= 0)
+        return 0;
+
+    memcpy(buf, mmap_stream->buffer + mmap_stream->position, size);
+    mmap_stream->position += size;
+
+    return size;
+}
+
+int32_t mz_stream_mmap_write(void *stream, const void *buf, int32_t size) {
+    MZ_UNUSED(stream);
+    MZ_UNUSED(buf);
+    MZ_UNUSED(size);
+    return MZ_WRITE_ERROR;
+}
+
+int64_t mz_stream_mmap_tell(void *stream) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    return mmap_stream->position;
+}
+
+int32_t mz_stream_mmap_seek(void *stream, int64_t offset, int32_t origin) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    int64_t new_pos = 0;
+
+    switch (origin) {
+    case MZ_SEEK_CUR:
+        new_pos = mmap_stream->position + offset;
+        break;
+    case MZ_SEEK_END:
+        new_pos = mmap_stream->size + offset;
+        break;
+    case MZ_SEEK_SET:
+        new_pos = offset;
+        break;
+    default:
+        return MZ_SEEK_ERROR;
+    }
+
+    if (new_pos < 0 || new_pos > mmap_stream->size)
+        return MZ_SEEK_ERROR;
+
+    mmap_stream->position = new_pos;
+    return MZ_OK;
+}
+
+int32_t mz_stream_mmap_close(void *stream) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    int32_t err = MZ_OK;
+
+    if ((mmap_stream->buffer != NULL) && (mmap_stream->owned)) {
+        if (munmap(mmap_stream->buffer, (size_t)mmap_stream->size) != 0) {
+            mmap_stream->error = errno;
+            err = MZ_CLOSE_ERROR;
+        }
+    }
+
+    mmap_stream->buffer = NULL;
+    mmap_stream->size = 0;
+    mmap_stream->position = 0;
+    mmap_stream->opened = 0;
+    mmap_stream->owned = 0;
+    return err;
+}
+
+int32_t mz_stream_mmap_error(void *stream) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    return mmap_stream->error;
+}
+
+int32_t mz_stream_mmap_get_buffer(void *stream, const void **buf) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    if (buf == NULL || !mmap_stream->opened)
+        return MZ_PARAM_ERROR;
+    *buf = mmap_stream->buffer;
+    return MZ_OK;
+}
+
+int32_t mz_stream_mmap_attach(void *stream, void *source) {
+    mz_stream_mmap *mmap_stream = (mz_stream_mmap *)stream;
+    mz_stream_mmap *source_stream = (mz_stream_mmap *)source;
+
+    if (mmap_stream == NULL || source_stream == NULL || !source_stream->opened)
+        return MZ_PARAM_ERROR;
+
+    mz_stream_mmap_close(stream);
+
+    mmap_stream->buffer = source_stream->buffer;
+    mmap_stream->size = source_stream->size;
+    mmap_stream->position = 0;
+    mmap_stream->opened = 1;
+    mmap_stream->owned = 0;
+    return MZ_OK;
+}
+
+void *mz_stream_mmap_create(void **stream) {
+    mz_stream_mmap *mmap_stream = NULL;
+
+    mmap_stream = (mz_stream_mmap *)MZ_ALLOC(sizeof(mz_stream_mmap));
+    if (mmap_stream != NULL) {
+        memset(mmap_stream, 0, sizeof(mz_stream_mmap));
+        mmap_stream->stream.vtbl = &mz_stream_mmap_vtbl;
+    }
+    if (stream != NULL)
+        *stream = mmap_stream;
+
+    return mmap_stream;
+}
+
+void mz_stream_mmap_delete(void **stream) {
+    mz_stream_mmap *mmap_stream = NULL;
+    if (stream == NULL)
+        return;
+    mmap_stream = (mz_stream_mmap *)*stream;
+    if (mmap_stream != NULL) {
+        mz_stream_mmap_close(mmap_stream);
+        MZ_FREE(mmap_stream);
+    }
+    *stream = NULL;
+}
+
+void *mz_stream_mmap_get_interface(void) {
+    return (void *)&mz_stream_mmap_vtbl;
+}
@@ -50,7 +50,8 @@ typedef struct mz_stream_pkcrypt_s {
     mz_stream       stream;
     int32_t         error;
     int16_t         initialized;
-    uint8_t         buffer[UINT16_MAX];
+    uint8_t         *buffer;
+    int32_t         buffer_size;
     int64_t         total_in;
     int64_t         max_total_in;
     int64_t         total_out;
@@ -206,7 +207,7 @@ int32_t mz_stream_pkcrypt_read(void *stream, void *buf, int32_t size) {
 int32_t mz_stream_pkcrypt_write(void *stream, const void *buf, int32_t size) {
     mz_stream_pkcrypt *pkcrypt = (mz_stream_pkcrypt *)stream;
     const uint8_t *buf_ptr = (const uint8_t *)buf;
-    int32_t bytes_to_write = sizeof(pkcrypt->buffer);
+    int32_t bytes_to_write = pkcrypt->buffer_size;
     int32_t total_written = 0;
     int32_t written = 0;
     int32_t i = 0;
@@ -215,6 +216,12 @@ int32_t mz_stream_pkcrypt_write(void *stream, const void *buf, int32_t size) {
     if (size < 0)
         return MZ_PARAM_ERROR;
 
+    if (pkcrypt->buffer == NULL) {
+        pkcrypt->buffer = (uint8_t *)MZ_ALLOC(pkcrypt->buffer_size);
+        if (pkcrypt->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
     do {
         if (bytes_to_write > (size - total_written))
             bytes_to_write = (size - total_written);
@@ -291,6 +298,9 @@ int32_t mz_stream_pkcrypt_get_prop_int64(void *stream, int32_t prop, int64_t *va
     case MZ_STREAM_PROP_FOOTER_SIZE:
         *value = 0;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = pkcrypt->buffer_size;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -303,6 +313,15 @@ int32_t mz_stream_pkcrypt_set_prop_int64(void *stream, int32_t prop, int64_t val
     case MZ_STREAM_PROP_TOTAL_IN_MAX:
         pkcrypt->max_total_in = value;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        if (value <= 0 || value > INT32_MAX || pkcrypt->initialized)
+            return MZ_PARAM_ERROR;
+        if (pkcrypt->buffer != NULL && pkcrypt->buffer_size != (int32_t)value) {
+            MZ_FREE(pkcrypt->buffer);
+            pkcrypt->buffer = NULL;
+        }
+        pkcrypt->buffer_size = (int32_t)value;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -316,6 +335,7 @@ void *mz_stream_pkcrypt_create(void **stream) {
     if (pkcrypt != NULL) {
         memset(pkcrypt, 0, sizeof(mz_stream_pkcrypt));
         pkcrypt->stream.vtbl = &mz_stream_pkcrypt_vtbl;
+        pkcrypt->buffer_size = UINT16_MAX;
     }
 
     if (stream != NULL)
@@ -328,8 +348,11 @@ void mz_stream_pkcrypt_delete(void **stream) {
     if (stream == NULL)
         return;
     pkcrypt = (mz_stream_pkcrypt *)*stream;
-    if (pkcrypt != NULL)
+    if (pkcrypt != NULL) {
+        if (pkcrypt->buffer != NULL)
+            MZ_FREE(pkcrypt->buffer);
         MZ_FREE(pkcrypt);
+    }
     *stream = NULL;
 }
 
@@ -12,6 +12,7 @@
 
 #include "mz.h"
 #include "mz_crypt.h"
+#include "mz_os.h"
 #include "mz_strm.h"
 #include "mz_strm_wzaes.h"
 
@@ -24,6 +25,10 @@
 #define MZ_AES_PW_VERIFY_SIZE       (2)
 #define MZ_AES_AUTHCODE_SIZE        (10)
 
+#define MZ_AES_HMAC_CHUNK_SIZE      (256 * 1024)
+#define MZ_AES_HMAC_CHUNK_COUNT     (4)
+#define MZ_AES_HMAC_THREAD_MIN      (1024 * 1024)
+
 /***************************************************************************/
 
 static mz_stream_vtbl mz_stream_wzaes_vtbl = {
@@ -48,7 +53,8 @@ typedef struct mz_stream_wzaes_s {
     int32_t         mode;
     int32_t         error;
     int16_t         initialized;
-    uint8_t         buffer[UINT16_MAX];
+    uint8_t         *buffer;
+    int32_t         buffer_size;
     int64_t         total_in;
     int64_t         max_total_in;
     int64_t         total_out;
@@ -59,10 +65,134 @@ typedef struct mz_stream_wzaes_s {
     uint8_t         crypt_block[MZ_AES_BLOCK_SIZE];
     void            *hmac;
     uint8_t         nonce[MZ_AES_BLOCK_SIZE];
+    int32_t         hmac_thread;        /* hash on a helper thread when enabled */
+    int64_t         hmac_total;         /* bytes hashed before the helper thread starts */
+    void            *hmac_worker;
+    void            *hmac_mutex;
+    void            *hmac_work_cond;
+    void            *hmac_done_cond;
+    uint8_t         *hmac_chunks;       /* ring of ciphertext copies waiting to be hashed */
+    int32_t         hmac_chunk_size[MZ_AES_HMAC_CHUNK_COUNT];
+    int32_t         hmac_head;
+    int32_t         hmac_count;
+    int32_t         hmac_stop;
 } mz_stream_wzaes;
 
 /***************************************************************************/
 
+static void mz_stream_wzaes_hmac_thread(void *userdata) {
+    mz_stream_wzaes *wzaes = (mz_stream_wzaes *)userdata;
+    uint8_t *chunk = NULL;
+    int32_t chunk_size = 0;
+
+    mz_os_mutex_lock(wzaes->hmac_mutex);
+
+    for (;;) {
+        while (!wzaes->hmac_stop && wzaes->hmac_count == 0)
+            mz_os_cond_wait(wzaes->hmac_work_cond, wzaes->hmac_mutex);
+        /* Chunks queued before stopping still need to be hashed */
+        if (wzaes->hmac_count == 0)
+            break;
+
+        chunk = wzaes->hmac_chunks + ((int64_t)wzaes->hmac_head * MZ_AES_HMAC_CHUNK_SIZE);
+        chunk_size = wzaes->hmac_chunk_size[wzaes->hmac_head];
+        mz_os_mutex_unlock(wzaes->hmac_mutex);
+
+        mz_crypt_hmac_update(wzaes->hmac, chunk, chunk_size);
+
+        mz_os_mutex_lock(wzaes->hmac_mutex);
+        wzaes->hmac_head = (wzaes->hmac_head + 1) % MZ_AES_HMAC_CHUNK_COUNT;
+        wzaes->hmac_count -= 1;
+        mz_os_cond_signal(wzaes->hmac_done_cond);
+    }
+
+    mz_os_mutex_unlock(wzaes->hmac_mutex);
+}
+
+static void mz_stream_wzaes_hmac_stop(mz_stream_wzaes *wzaes) {
+    if (wzaes->hmac_worker != NULL) {
+        mz_os_mutex_lock(wzaes->hmac_mutex);
+        wzaes->hmac_stop = 1;
+        mz_os_cond_signal(wzaes->hmac_work_cond);
+        mz_os_mutex_unlock(wzaes->hmac_mutex);
+
+        mz_os_thread_join(&wzaes->hmac_worker);
+    }
+
+    mz_os_cond_delete(&wzaes->hmac_done_cond);
+    mz_os_cond_delete(&wzaes->hmac_work_cond);
+    mz_os_mutex_delete(&wzaes->hmac_mutex);
+
+    wzaes->hmac_head = 0;
+    wzaes->hmac_count = 0;
+    wzaes->hmac_stop = 0;
+}
+
+static int32_t mz_stream_wzaes_hmac_start(mz_stream_wzaes *wzaes) {
+    int32_t err = MZ_OK;
+
+    if (wzaes->hmac_chunks == NULL) {
+        wzaes->hmac_chunks = (uint8_t *)MZ_ALLOC(MZ_AES_HMAC_CHUNK_SIZE * MZ_AES_HMAC_CHUNK_COUNT);
+        if (wzaes->hmac_chunks == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    err = mz_os_mutex_create(&wzaes->hmac_mutex);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&wzaes->hmac_work_cond);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&wzaes->hmac_done_cond);
+    if (err == MZ_OK)
+        err = mz_os_thread_create(&wzaes->hmac_worker, mz_stream_wzaes_hmac_thread, wzaes);
+    if (err != MZ_OK)
+        mz_stream_wzaes_hmac_stop(wzaes);
+    return err;
+}
+
+static void mz_stream_wzaes_hmac_update(mz_stream_wzaes *wzaes, const uint8_t *buf, int32_t size) {
+    uint8_t *chunk = NULL;
+    int32_t chunk_size = 0;
+    int32_t tail = 0;
+
+    /* Small entries are not worth a thread, so start one only once enough data has been hashed */
+    if (wzaes->hmac_worker == NULL && wzaes->hmac_thread && wzaes->hmac_total >= MZ_AES_HMAC_THREAD_MIN) {
+        if (mz_stream_wzaes_hmac_start(wzaes) != MZ_OK)
+            wzaes->hmac_thread = 0;
+    }
+
+    if (wzaes->hmac_worker == NULL) {
+        wzaes->hmac_total += size;
+        mz_crypt_hmac_update(wzaes->hmac, buf, size);
+        return;
+    }
+
+    /* Queue copies of the ciphertext since the caller decrypts it in place */
+    while (size > 0) {
+        chunk_size = size;
+        if (chunk_size > MZ_AES_HMAC_CHUNK_SIZE)
+            chunk_size = MZ_AES_HMAC_CHUNK_SIZE;
+
+        mz_os_mutex_lock(wzaes->hmac_mutex);
+        while (wzaes->hmac_count == MZ_AES_HMAC_CHUNK_COUNT)
+            mz_os_cond_wait(wzaes->hmac_done_cond, wzaes->hmac_mutex);
+        tail = (wzaes->hmac_head + wzaes->hmac_count) % MZ_AES_HMAC_CHUNK_COUNT;
+        mz_os_mutex_unlock(wzaes->hmac_mutex);
+
+        /* The helper thread never touches chunks that are not queued yet */
+        chunk = wzaes->hmac_chunks + ((int64_t)tail * MZ_AES_HMAC_CHUNK_SIZE);
+        memcpy(chunk, buf, chunk_size);
+        wzaes->hmac_chunk_size[tail] = chunk_size;
+
+        mz_os_mutex_lock(wzaes->hmac_mutex);
+        wzaes->hmac_count += 1;
+        mz_os_cond_signal(wzaes->hmac_work_cond);
+        mz_os_mutex_unlock(wzaes->hmac_mutex);
+
+        buf += chunk_size;
+        size -= chunk_size;
+    }
+}
+
 int32_t mz_stream_wzaes_open(void *stream, const char *path, int32_t mode) {
     mz_stream_wzaes *wzaes = (mz_stream_wzaes *)stream;
     uint16_t salt_length = 0;
@@ -107,9 +237,14 @@ int32_t mz_stream_wzaes_open(void *stream, const char *path, int32_t mode) {
     mz_crypt_pbkdf2((uint8_t *)password, password_length, salt_value, salt_length,
         MZ_AES_KEYING_ITERATIONS, kbuf, 2 * key_length + MZ_AES_PW_VERIFY_SIZE);
 
-    /* Initialize the encryption nonce and buffer pos */
+    /* Initialize the encryption nonce and buffer pos, the first counter block is 1 */
     wzaes->crypt_pos = MZ_AES_BLOCK_SIZE;
     memset(wzaes->nonce, 0, sizeof(wzaes->nonce));
+    wzaes->nonce[0] = 1;
+
+    /* Stop hashing on behalf of a previous entry */
+    mz_stream_wzaes_hmac_stop(wzaes);
+    wzaes->hmac_total = 0;
 
     /* Initialize for encryption using key 1 */
     mz_crypt_aes_reset(wzaes->aes);
@@ -161,28 +296,36 @@ int32_t mz_stream_wzaes_is_open(void *stream) {
 static int32_t mz_stream_wzaes_ctr_encrypt(void *stream, uint8_t *buf, int32_t size) {
     mz_stream_wzaes *wzaes = (mz_stream_wzaes *)stream;
     uint32_t pos = wzaes->crypt_pos;
-    uint32_t i = 0;
+    int32_t full_size = 0;
+    int32_t i = 0;
     int32_t err = MZ_OK;
 
-    while (i < (uint32_t)size) {
-        if (pos == MZ_AES_BLOCK_SIZE) {
-            uint32_t j = 0;
-
-            /* Increment encryption nonce */
-            while (j < 8 && !++wzaes->nonce[j])
-                j += 1;
+    /* Use up what is left of the previous keystream block */
+    while (i < size && pos < MZ_AES_BLOCK_SIZE)
+        buf[i++] ^= wzaes->crypt_block[pos++];
 
-            /* Encrypt the nonce to form next xor buffer */
-            memcpy(wzaes->crypt_block, wzaes->nonce, MZ_AES_BLOCK_SIZE);
-            mz_crypt_aes_encrypt(wzaes->aes, wzaes->crypt_block, sizeof(wzaes->crypt_block));
-            pos = 0;
-        }
+    /* Encrypt whole blocks in bulk */
+    full_size = (size - i) & ~(MZ_AES_BLOCK_SIZE - 1);
+    if (full_size > 0) {
+        err = mz_crypt_aes_encrypt_ctr(wzaes->aes, wzaes->nonce, buf + i, full_size);
+        if (err < 0)
+            return err;
+        i += full_size;
+    }
 
-        buf[i++] ^= wzaes->crypt_block[pos++];
+    /* Generate the next keystream block for any trailing bytes */
+    if (i < size) {
+        memset(wzaes->crypt_block, 0, sizeof(wzaes->crypt_block));
+        err = mz_crypt_aes_encrypt_ctr(wzaes->aes, wzaes->nonce, wzaes->crypt_block, sizeof(wzaes->crypt_block));
+        if (err < 0)
+            return err;
+        pos = 0;
+        while (i < size)
+            buf[i++] ^= wzaes->crypt_block[pos++];
     }
 
     wzaes->crypt_pos = pos;
-    return err;
+    return MZ_OK;
 }
 
 int32_t mz_stream_wzaes_read(void *stream, void *buf, int32_t size) {
@@ -190,6 +333,7 @@ int32_t mz_stream_wzaes_read(void *stream, void *buf, int32_t size) {
     int64_t max_total_in = 0;
     int32_t bytes_to_read = size;
     int32_t read = 0;
+    int32_t err = MZ_OK;
 
     max_total_in = wzaes->max_total_in - MZ_AES_FOOTER_SIZE;
     if ((int64_t)bytes_to_read > (max_total_in - wzaes->total_in))
@@ -198,8 +342,10 @@ int32_t mz_stream_wzaes_read(void *stream, void *buf, int32_t size) {
     read = mz_stream_read(wzaes->stream.base, buf, bytes_to_read);
 
     if (read > 0) {
-        mz_crypt_hmac_update(wzaes->hmac, (uint8_t *)buf, read);
-        mz_stream_wzaes_ctr_encrypt(stream, (uint8_t *)buf, read);
+        mz_stream_wzaes_hmac_update(wzaes, (uint8_t *)buf, read);
+        err = mz_stream_wzaes_ctr_encrypt(stream, (uint8_t *)buf, read);
+        if (err != MZ_OK)
+            return err;
 
         wzaes->total_in += read;
     }
@@ -210,13 +356,20 @@ int32_t mz_stream_wzaes_read(void *stream, void *buf, int32_t size) {
 int32_t mz_stream_wzaes_write(void *stream, const void *buf, int32_t size) {
     mz_stream_wzaes *wzaes = (mz_stream_wzaes *)stream;
     const uint8_t *buf_ptr = (const uint8_t *)buf;
-    int32_t bytes_to_write = sizeof(wzaes->buffer);
+    int32_t bytes_to_write = wzaes->buffer_size;
     int32_t total_written = 0;
     int32_t written = 0;
+    int32_t err = MZ_OK;
 
     if (size < 0)
         return MZ_PARAM_ERROR;
 
+    if (wzaes->buffer == NULL) {
+        wzaes->buffer = (uint8_t *)MZ_ALLOC(wzaes->buffer_size);
+        if (wzaes->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
     do {
         if (bytes_to_write > (size - total_written))
             bytes_to_write = (size - total_written);
@@ -224,8 +377,10 @@ int32_t mz_stream_wzaes_write(void *stream, const void *buf, int32_t size) {
         memcpy(wzaes->buffer, buf_ptr, bytes_to_write);
         buf_ptr += bytes_to_write;
 
-        mz_stream_wzaes_ctr_encrypt(stream, (uint8_t *)wzaes->buffer, bytes_to_write);
-        mz_crypt_hmac_update(wzaes->hmac, wzaes->buffer, bytes_to_write);
+        err = mz_stream_wzaes_ctr_encrypt(stream, (uint8_t *)wzaes->buffer, bytes_to_write);
+        if (err != MZ_OK)
+            return err;
+        mz_stream_wzaes_hmac_update(wzaes, wzaes->buffer, bytes_to_write);
 
         written = mz_stream_write(wzaes->stream.base, wzaes->buffer, bytes_to_write);
         if (written < 0)
@@ -253,6 +408,8 @@ int32_t mz_stream_wzaes_close(void *stream) {
     uint8_t expected_hash[MZ_AES_AUTHCODE_SIZE];
     uint8_t computed_hash[MZ_HASH_SHA1_SIZE];
 
+    /* Wait for the helper thread to hash the remaining ciphertext */
+    mz_stream_wzaes_hmac_stop(wzaes);
     mz_crypt_hmac_end(wzaes->hmac, computed_hash, sizeof(computed_hash));
 
     if (wzaes->mode & MZ_OPEN_MODE_WRITE) {
@@ -308,6 +465,12 @@ int32_t mz_stream_wzaes_get_prop_int64(void *stream, int32_t prop, int64_t *valu
     case MZ_STREAM_PROP_FOOTER_SIZE:
         *value = MZ_AES_AUTHCODE_SIZE;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = wzaes->buffer_size;
+        break;
+    case MZ_STREAM_PROP_HMAC_THREAD:
+        *value = wzaes->hmac_thread;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -320,6 +483,20 @@ int32_t mz_stream_wzaes_set_prop_int64(void *stream, int32_t prop, int64_t value
     case MZ_STREAM_PROP_TOTAL_IN_MAX:
         wzaes->max_total_in = value;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        if (value <= 0 || value > INT32_MAX || wzaes->initialized)
+            return MZ_PARAM_ERROR;
+        if (wzaes->buffer != NULL && wzaes->buffer_size != (int32_t)value) {
+            MZ_FREE(wzaes->buffer);
+            wzaes->buffer = NULL;
+        }
+        wzaes->buffer_size = (int32_t)value;
+        break;
+    case MZ_STREAM_PROP_HMAC_THREAD:
+        if (wzaes->initialized)
+            return MZ_PARAM_ERROR;
+        wzaes->hmac_thread = (value != 0);
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -334,6 +511,7 @@ void *mz_stream_wzaes_create(void **stream) {
         memset(wzaes, 0, sizeof(mz_stream_wzaes));
         wzaes->stream.vtbl = &mz_stream_wzaes_vtbl;
         wzaes->encryption_mode = MZ_AES_ENCRYPTION_MODE_256;
+        wzaes->buffer_size = UINT16_MAX;
 
         mz_crypt_hmac_create(&wzaes->hmac);
         mz_crypt_aes_create(&wzaes->aes);
@@ -350,8 +528,13 @@ void mz_stream_wzaes_delete(void **stream) {
         return;
     wzaes = (mz_stream_wzaes *)*stream;
     if (wzaes != NULL) {
+        mz_stream_wzaes_hmac_stop(wzaes);
+        if (wzaes->hmac_chunks != NULL)
+            MZ_FREE(wzaes->hmac_chunks);
         mz_crypt_aes_delete(&wzaes->aes);
         mz_crypt_hmac_delete(&wzaes->hmac);
+        if (wzaes->buffer != NULL)
+            MZ_FREE(wzaes->buffer);
         MZ_FREE(wzaes);
     }
     *stream = NULL;
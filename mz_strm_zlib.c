@@ -10,6 +10,7 @@
 
 
 #include "mz.h"
+#include "mz_os.h"
 #include "mz_strm.h"
 #include "mz_strm_zlib.h"
 
@@ -18,6 +19,9 @@
 #else
 #  include "zlib.h"
 #endif
+#ifdef HAVE_LIBDEFLATE
+#  include "libdeflate.h"
+#endif
 
 /***************************************************************************/
 
@@ -37,6 +41,9 @@
 #  endif
 #endif
 
+#define MZ_STREAM_ZLIB_BLOCK_SIZE       (1024 * 1024)
+#define MZ_STREAM_ZLIB_DICT_SIZE        (32768)
+
 /***************************************************************************/
 
 static mz_stream_vtbl mz_stream_zlib_vtbl = {
@@ -59,44 +66,524 @@ static mz_stream_vtbl mz_stream_zlib_vtbl = {
 typedef struct mz_stream_zlib_s {
     mz_stream   stream;
     zlib_stream zstream;
-    uint8_t     buffer[INT16_MAX];
+    uint8_t     *buffer;
+    int32_t     buffer_size;
     int32_t     buffer_len;
     int64_t     total_in;
     int64_t     total_out;
     int64_t     max_total_in;
+    int64_t     max_total_out;
     int8_t      initialized;
     int16_t     level;
     int32_t     window_bits;
     int32_t     mode;
     int32_t     error;
+    int32_t     thread_count;
+    int64_t     job_size;
+    void        *threads;
+    int32_t     zstream_mode;
+    int16_t     zstream_level;
+    int32_t     zstream_window_bits;
+    int8_t      finished;
+    int8_t      read_all;
+#ifdef HAVE_LIBDEFLATE
+    struct libdeflate_compressor   *compressor;
+    int16_t                        compressor_level;
+    struct libdeflate_decompressor *decompressor;
+#endif
 } mz_stream_zlib;
 
 /***************************************************************************/
 
-int32_t mz_stream_zlib_open(void *stream, const char *path, int32_t mode) {
+#ifndef MZ_ZIP_NO_COMPRESSION
+
+#define MZ_STREAM_ZLIB_JOB_FILLING      (0)
+#define MZ_STREAM_ZLIB_JOB_QUEUED       (1)
+#define MZ_STREAM_ZLIB_JOB_RUNNING      (2)
+#define MZ_STREAM_ZLIB_JOB_DONE         (3)
+
+typedef struct mz_stream_zlib_job_s {
+    uint8_t     *in;
+    int32_t     in_len;
+    uint8_t     *out;
+    int32_t     out_len;
+    int32_t     out_max;
+    uint8_t     dict[MZ_STREAM_ZLIB_DICT_SIZE];
+    int32_t     dict_len;
+    uint8_t     last;
+    int32_t     state;
+    int32_t     error;
+} mz_stream_zlib_job;
+
+typedef struct mz_stream_zlib_worker_s {
+    void        *threads;
+    zlib_stream zstream;
+    int8_t      initialized;
+    void        *thread;
+} mz_stream_zlib_worker;
+
+typedef struct mz_stream_zlib_threads_s {
+    void        *mutex;
+    void        *work_cond;
+    void        *done_cond;
+    mz_stream_zlib_job
+                *jobs;
+    int32_t     max_jobs;
+    int64_t     head;
+    int64_t     tail;
+    int32_t     block_size;
+    uint8_t     filling;
+    uint8_t     dict[MZ_STREAM_ZLIB_DICT_SIZE];
+    int32_t     dict_len;
+    mz_stream_zlib_worker
+                *workers;
+    int32_t     worker_count;
+    uint8_t     started;
+    uint8_t     stop;
+    int16_t     level;
+    int32_t     window_bits;
+    int32_t     error;
+} mz_stream_zlib_threads;
+
+static void mz_stream_zlib_job_compress(mz_stream_zlib_threads *threads, mz_stream_zlib_worker *worker,
+    mz_stream_zlib_job *job) {
+    zlib_stream *zstream = &worker->zstream;
+    int32_t out_max = 0;
+    int32_t err = Z_OK;
+
+    if (!worker->initialized) {
+        memset(zstream, 0, sizeof(zlib_stream));
+        zstream->data_type = Z_BINARY;
+
+        err = ZLIB_PREFIX(deflateInit2)(zstream, (int8_t)threads->level, Z_DEFLATED,
+            threads->window_bits, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+        if (err != Z_OK) {
+            job->error = MZ_MEM_ERROR;
+            return;
+        }
+        worker->initialized = 1;
+    } else {
+        ZLIB_PREFIX(deflateReset)(zstream);
+    }
+
+    /* Leave room for the empty stored block written by a sync flush */
+    out_max = (int32_t)ZLIB_PREFIX(deflateBound)(zstream, (uLong)job->in_len) + 64;
+    if (job->out_max < out_max) {
+        if (job->out != NULL)
+            MZ_FREE(job->out);
+        job->out = (uint8_t *)MZ_ALLOC(out_max);
+        job->out_max = (job->out != NULL) ? out_max : 0;
+        if (job->out == NULL) {
+            job->error = MZ_MEM_ERROR;
+            return;
+        }
+    }
+
+    /* Back-references may reach into the end of the previous block */
+    if (job->dict_len > 0)
+        err = ZLIB_PREFIX(deflateSetDictionary)(zstream, job->dict, (uInt)job->dict_len);
+
+    if (err == Z_OK) {
+        zstream->next_in = job->in;
+        zstream->avail_in = (uInt)job->in_len;
+        zstream->next_out = job->out;
+        zstream->avail_out = (uInt)job->out_max;
+
+        /* Blocks end on a byte boundary so they can be joined into a single deflate stream */
+        err = ZLIB_PREFIX(deflate)(zstream, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+        if (job->last && err == Z_STREAM_END)
+            err = Z_OK;
+        else if (!job->last && err == Z_OK && zstream->avail_out == 0)
+            err = Z_BUF_ERROR;
+        else if (job->last && err == Z_OK)
+            err = Z_BUF_ERROR;
+    }
+
+    job->out_len = job->out_max - (int32_t)zstream->avail_out;
+    job->error = (err == Z_OK) ? MZ_OK : MZ_DATA_ERROR;
+}
+
+static void mz_stream_zlib_worker_run(void *userdata) {
+    mz_stream_zlib_worker *worker = (mz_stream_zlib_worker *)userdata;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)worker->threads;
+    mz_stream_zlib_job *job = NULL;
+    int64_t i = 0;
+
+    mz_os_mutex_lock(threads->mutex);
+    while (!threads->stop) {
+        /* Find the oldest block nobody has started compressing */
+        job = NULL;
+        for (i = threads->head; i < threads->tail; i += 1) {
+            job = &threads->jobs[i % threads->max_jobs];
+            if (job->state == MZ_STREAM_ZLIB_JOB_QUEUED)
+                break;
+            job = NULL;
+        }
+
+        if (job == NULL) {
+            mz_os_cond_wait(threads->work_cond, threads->mutex);
+            continue;
+        }
+
+        job->state = MZ_STREAM_ZLIB_JOB_RUNNING;
+        mz_os_mutex_unlock(threads->mutex);
+
+        mz_stream_zlib_job_compress(threads, worker, job);
+
+        mz_os_mutex_lock(threads->mutex);
+        job->state = MZ_STREAM_ZLIB_JOB_DONE;
+        mz_os_cond_broadcast(threads->done_cond);
+    }
+    mz_os_mutex_unlock(threads->mutex);
+}
+
+static void mz_stream_zlib_threads_stop(void *stream) {
     mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)zlib->threads;
+    int32_t i = 0;
 
-    MZ_UNUSED(path);
+    if (threads == NULL)
+        return;
+
+    if (threads->mutex != NULL) {
+        mz_os_mutex_lock(threads->mutex);
+        threads->stop = 1;
+        mz_os_cond_broadcast(threads->work_cond);
+        mz_os_mutex_unlock(threads->mutex);
+    }
+
+    if (threads->workers != NULL) {
+        for (i = 0; i < threads->worker_count; i += 1) {
+            if (threads->workers[i].thread != NULL)
+                mz_os_thread_join(&threads->workers[i].thread);
+            if (threads->workers[i].initialized)
+                ZLIB_PREFIX(deflateEnd)(&threads->workers[i].zstream);
+        }
+        MZ_FREE(threads->workers);
+    }
+
+    if (threads->jobs != NULL) {
+        for (i = 0; i < threads->max_jobs; i += 1) {
+            if (threads->jobs[i].in != NULL)
+                MZ_FREE(threads->jobs[i].in);
+            if (threads->jobs[i].out != NULL)
+                MZ_FREE(threads->jobs[i].out);
+        }
+        MZ_FREE(threads->jobs);
+    }
+
+    mz_os_cond_delete(&threads->done_cond);
+    mz_os_cond_delete(&threads->work_cond);
+    mz_os_mutex_delete(&threads->mutex);
+
+    zlib->threads = NULL;
+    MZ_FREE(threads);
+}
+
+static int32_t mz_stream_zlib_threads_init(void *stream) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = NULL;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+
+    threads = (mz_stream_zlib_threads *)MZ_ALLOC(sizeof(mz_stream_zlib_threads));
+    if (threads == NULL)
+        return MZ_MEM_ERROR;
+    memset(threads, 0, sizeof(mz_stream_zlib_threads));
+    zlib->threads = threads;
+
+    err = mz_os_mutex_create(&threads->mutex);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&threads->work_cond);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&threads->done_cond);
+
+    if (err != MZ_OK) {
+        mz_stream_zlib_threads_stop(stream);
+        return MZ_SUPPORT_ERROR;
+    }
+
+    threads->level = zlib->level;
+    threads->window_bits = zlib->window_bits;
+    threads->block_size = MZ_STREAM_ZLIB_BLOCK_SIZE;
+    if (zlib->job_size > 0)
+        threads->block_size = (int32_t)((zlib->job_size < INT32_MAX / 2) ? zlib->job_size : INT32_MAX / 2);
+    threads->worker_count = zlib->thread_count;
+    threads->max_jobs = zlib->thread_count * 2;
+
+    threads->jobs = (mz_stream_zlib_job *)MZ_ALLOC(threads->max_jobs * sizeof(mz_stream_zlib_job));
+    threads->workers = (mz_stream_zlib_worker *)MZ_ALLOC(threads->worker_count * sizeof(mz_stream_zlib_worker));
+
+    if (threads->jobs == NULL || threads->workers == NULL) {
+        mz_stream_zlib_threads_stop(stream);
+        return MZ_MEM_ERROR;
+    }
+
+    memset(threads->jobs, 0, threads->max_jobs * sizeof(mz_stream_zlib_job));
+    memset(threads->workers, 0, threads->worker_count * sizeof(mz_stream_zlib_worker));
+
+    for (i = 0; i < threads->worker_count; i += 1)
+        threads->workers[i].threads = threads;
+
+    return MZ_OK;
+}
+
+static int32_t mz_stream_zlib_threads_write_head(void *stream) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)zlib->threads;
+    mz_stream_zlib_job *job = &threads->jobs[threads->head % threads->max_jobs];
+
+    mz_os_mutex_lock(threads->mutex);
+    if (job->state == MZ_STREAM_ZLIB_JOB_QUEUED) {
+        /* Compress the block on the calling thread instead of waiting for a free thread */
+        job->state = MZ_STREAM_ZLIB_JOB_RUNNING;
+        mz_os_mutex_unlock(threads->mutex);
+
+        mz_stream_zlib_job_compress(threads, &threads->workers[0], job);
+
+        mz_os_mutex_lock(threads->mutex);
+        job->state = MZ_STREAM_ZLIB_JOB_DONE;
+    }
+    while (job->state != MZ_STREAM_ZLIB_JOB_DONE)
+        mz_os_cond_wait(threads->done_cond, threads->mutex);
+    mz_os_mutex_unlock(threads->mutex);
+
+    /* Blocks after the first error are discarded */
+    if (threads->error == MZ_OK) {
+        if (job->error != MZ_OK)
+            threads->error = job->error;
+        else if (mz_stream_write(zlib->stream.base, job->out, job->out_len) != job->out_len)
+            threads->error = MZ_WRITE_ERROR;
+        else
+            zlib->total_out += job->out_len;
+    }
+
+    mz_os_mutex_lock(threads->mutex);
+    job->state = MZ_STREAM_ZLIB_JOB_FILLING;
+    threads->head += 1;
+    mz_os_mutex_unlock(threads->mutex);
+
+    return threads->error;
+}
+
+static mz_stream_zlib_job *mz_stream_zlib_threads_fill_job(void *stream) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)zlib->threads;
+    mz_stream_zlib_job *job = NULL;
+
+    if (threads->filling)
+        return &threads->jobs[threads->tail % threads->max_jobs];
+
+    /* Write the oldest blocks until there is room in the queue */
+    while (threads->tail - threads->head >= threads->max_jobs) {
+        if (mz_stream_zlib_threads_write_head(stream) != MZ_OK)
+            return NULL;
+    }
+
+    job = &threads->jobs[threads->tail % threads->max_jobs];
+    if (job->in == NULL) {
+        job->in = (uint8_t *)MZ_ALLOC(threads->block_size);
+        if (job->in == NULL) {
+            threads->error = MZ_MEM_ERROR;
+            return NULL;
+        }
+    }
+
+    job->in_len = 0;
+    job->out_len = 0;
+    job->last = 0;
+    job->error = MZ_OK;
+    job->dict_len = threads->dict_len;
+    memcpy(job->dict, threads->dict, threads->dict_len);
+
+    threads->filling = 1;
+    return job;
+}
+
+static void mz_stream_zlib_threads_queue_job(void *stream, uint8_t last) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)zlib->threads;
+    mz_stream_zlib_job *job = &threads->jobs[threads->tail % threads->max_jobs];
+    int32_t keep = 0;
+    int32_t i = 0;
+
+    /* Remember the end of the data so far as the dictionary for the next block */
+    if (job->in_len >= MZ_STREAM_ZLIB_DICT_SIZE) {
+        memcpy(threads->dict, job->in + job->in_len - MZ_STREAM_ZLIB_DICT_SIZE, MZ_STREAM_ZLIB_DICT_SIZE);
+        threads->dict_len = MZ_STREAM_ZLIB_DICT_SIZE;
+    } else {
+        keep = MZ_STREAM_ZLIB_DICT_SIZE - job->in_len;
+        if (keep > threads->dict_len)
+            keep = threads->dict_len;
+        memmove(threads->dict, threads->dict + threads->dict_len - keep, keep);
+        memcpy(threads->dict + keep, job->in, job->in_len);
+        threads->dict_len = keep + job->in_len;
+    }
+
+    job->last = last;
+    threads->filling = 0;
+
+    mz_os_mutex_lock(threads->mutex);
+    job->state = MZ_STREAM_ZLIB_JOB_QUEUED;
+    threads->tail += 1;
+    mz_os_cond_signal(threads->work_cond);
+    mz_os_mutex_unlock(threads->mutex);
+
+    /* Entries that fit in a single block are compressed without starting any threads */
+    if (!last && !threads->started) {
+        threads->started = 1;
+        for (i = 1; i < threads->worker_count; i += 1)
+            mz_os_thread_create(&threads->workers[i].thread, mz_stream_zlib_worker_run, &threads->workers[i]);
+    }
+}
+
+static int32_t mz_stream_zlib_threads_write(void *stream, const void *buf, int32_t size) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)zlib->threads;
+    mz_stream_zlib_job *job = NULL;
+    const uint8_t *buf_ptr = (const uint8_t *)buf;
+    int32_t bytes_left = size;
+    int32_t copy = 0;
+
+    while (bytes_left > 0) {
+        job = mz_stream_zlib_threads_fill_job(stream);
+        if (job == NULL)
+            return threads->error;
+
+        copy = threads->block_size - job->in_len;
+        if (copy > bytes_left)
+            copy = bytes_left;
+
+        memcpy(job->in + job->in_len, buf_ptr, copy);
+        job->in_len += copy;
+        buf_ptr += copy;
+        bytes_left -= copy;
+
+        if (job->in_len == threads->block_size)
+            mz_stream_zlib_threads_queue_job(stream, 0);
+    }
+
+    if (threads->error != MZ_OK)
+        return threads->error;
+
+    zlib->total_in += size;
+    return size;
+}
+
+static int32_t mz_stream_zlib_threads_finish(void *stream) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+    mz_stream_zlib_threads *threads = (mz_stream_zlib_threads *)zlib->threads;
+
+    /* The last block is always queued, even when empty, to end the deflate stream */
+    if (mz_stream_zlib_threads_fill_job(stream) != NULL)
+        mz_stream_zlib_threads_queue_job(stream, 1);
+
+    while (threads->head < threads->tail)
+        mz_stream_zlib_threads_write_head(stream);
+
+    return threads->error;
+}
+#endif
+
+/***************************************************************************/
+
+static void mz_stream_zlib_end(mz_stream_zlib *zlib) {
+    if (zlib->zstream_mode & MZ_OPEN_MODE_WRITE) {
+#ifndef MZ_ZIP_NO_COMPRESSION
+        ZLIB_PREFIX(deflateEnd)(&zlib->zstream);
+#endif
+    } else if (zlib->zstream_mode & MZ_OPEN_MODE_READ) {
+#ifndef MZ_ZIP_NO_DECOMPRESSION
+        ZLIB_PREFIX(inflateEnd)(&zlib->zstream);
+#endif
+    }
+    zlib->zstream_mode = 0;
+}
+
+static int32_t mz_stream_zlib_init(mz_stream_zlib *zlib, int32_t mode) {
+    /* Reset the state kept from the last time the stream was opened instead of allocating it again,
+       deflate state is only reset when it was initialized with the same level */
+    if (zlib->zstream_mode == mode && zlib->zstream_window_bits == zlib->window_bits &&
+        (!(mode & MZ_OPEN_MODE_WRITE) || zlib->zstream_level == zlib->level)) {
+        if (mode & MZ_OPEN_MODE_WRITE) {
+#ifndef MZ_ZIP_NO_COMPRESSION
+            zlib->error = ZLIB_PREFIX(deflateReset)(&zlib->zstream);
+#endif
+        } else {
+#ifndef MZ_ZIP_NO_DECOMPRESSION
+            zlib->error = ZLIB_PREFIX(inflateReset)(&zlib->zstream);
+#endif
+        }
+        if (zlib->error == Z_OK)
+            return Z_OK;
+    }
+
+    mz_stream_zlib_end(zlib);
 
-    zlib->zstream.data_type = Z_BINARY;
     zlib->zstream.zalloc = Z_NULL;
     zlib->zstream.zfree = Z_NULL;
     zlib->zstream.opaque = Z_NULL;
+
+    if (mode & MZ_OPEN_MODE_WRITE) {
+#ifndef MZ_ZIP_NO_COMPRESSION
+        zlib->error = ZLIB_PREFIX(deflateInit2)(&zlib->zstream, (int8_t)zlib->level, Z_DEFLATED,
+            zlib->window_bits, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+#endif
+    } else {
+#ifndef MZ_ZIP_NO_DECOMPRESSION
+        zlib->error = ZLIB_PREFIX(inflateInit2)(&zlib->zstream, zlib->window_bits);
+#endif
+    }
+
+    if (zlib->error == Z_OK) {
+        zlib->zstream_mode = mode;
+        zlib->zstream_level = zlib->level;
+        zlib->zstream_window_bits = zlib->window_bits;
+    }
+    return zlib->error;
+}
+
+int32_t mz_stream_zlib_open(void *stream, const char *path, int32_t mode) {
+    mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
+
+    MZ_UNUSED(path);
+
+    if (zlib->buffer == NULL) {
+        zlib->buffer = (uint8_t *)MZ_ALLOC(zlib->buffer_size);
+        if (zlib->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    zlib->zstream.data_type = Z_BINARY;
     zlib->zstream.total_in = 0;
     zlib->zstream.total_out = 0;
 
+    zlib->buffer_len = 0;
     zlib->total_in = 0;
     zlib->total_out = 0;
+    zlib->error = Z_OK;
+    zlib->finished = 0;
+    zlib->read_all = 0;
 
     if (mode & MZ_OPEN_MODE_WRITE) {
 #ifdef MZ_ZIP_NO_COMPRESSION
         return MZ_SUPPORT_ERROR;
 #else
+        /* Blocks are compressed by separate streams, fall back to one stream if threads aren't supported */
+        if (zlib->thread_count > 1) {
+            if (mz_stream_zlib_threads_init(zlib) == MZ_OK) {
+                zlib->initialized = 1;
+                zlib->mode = mode;
+                return MZ_OK;
+            }
+            zlib->thread_count = 1;
+        }
+
         zlib->zstream.next_out = zlib->buffer;
-        zlib->zstream.avail_out = sizeof(zlib->buffer);
+        zlib->zstream.avail_out = (uInt)zlib->buffer_size;
 
-        zlib->error = ZLIB_PREFIX(deflateInit2)(&zlib->zstream, (int8_t)zlib->level, Z_DEFLATED,
-            zlib->window_bits, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+        mz_stream_zlib_init(zlib, mode);
 #endif
     } else if (mode & MZ_OPEN_MODE_READ) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
@@ -105,7 +592,7 @@ int32_t mz_stream_zlib_open(void *stream, const char *path, int32_t mode) {
         zlib->zstream.next_in = zlib->buffer;
         zlib->zstream.avail_in = 0;
 
-        zlib->error = ZLIB_PREFIX(inflateInit2)(&zlib->zstream, zlib->window_bits);
+        mz_stream_zlib_init(zlib, mode);
 #endif
     }
 
@@ -124,6 +611,87 @@ int32_t mz_stream_zlib_is_open(void *stream) {
     return MZ_OK;
 }
 
+#ifndef MZ_ZIP_NO_DECOMPRESSION
+static int32_t mz_stream_zlib_read_all(mz_stream_zlib *zlib, void *buf, int32_t size) {
+    uint8_t *input = zlib->buffer;
+    int32_t input_size = (int32_t)zlib->max_total_in;
+    int32_t input_len = 0;
+    int32_t read = 0;
+    int32_t err = Z_OK;
+
+    /* Read all compressed data and inflate it straight into the caller's buffer */
+    if (input_size > zlib->buffer_size) {
+        input = (uint8_t *)MZ_ALLOC(input_size);
+        if (input == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    while (input_len < input_size) {
+        read = mz_stream_read(zlib->stream.base, input + input_len, input_size - input_len);
+        if (read <= 0)
+            break;
+        input_len += read;
+    }
+
+#ifdef HAVE_LIBDEFLATE
+    /* libdeflate only decodes raw deflate, other window bits are left to zlib */
+    if (read >= 0 && zlib->window_bits == -MAX_WBITS) {
+        if (zlib->decompressor == NULL)
+            zlib->decompressor = libdeflate_alloc_decompressor();
+        if (zlib->decompressor != NULL) {
+            size_t actual_in = 0;
+            size_t actual_out = 0;
+
+            if (libdeflate_deflate_decompress_ex(zlib->decompressor, input, (size_t)input_len, buf, (size_t)size,
+                &actual_in, &actual_out) == LIBDEFLATE_SUCCESS) {
+                zlib->total_in += (int64_t)actual_in;
+                zlib->total_out += (int64_t)actual_out;
+                zlib->finished = 1;
+                read = (int32_t)actual_out;
+            } else {
+                zlib->error = Z_DATA_ERROR;
+                read = Z_DATA_ERROR;
+            }
+
+            if (input != zlib->buffer)
+                MZ_FREE(input);
+            return read;
+        }
+    }
+#endif
+
+    if (read < 0) {
+        err = read;
+    } else {
+        zlib->zstream.next_in = input;
+        zlib->zstream.avail_in = (uInt)input_len;
+        zlib->zstream.next_out = (Bytef *)buf;
+        zlib->zstream.avail_out = (uInt)size;
+
+        err = ZLIB_PREFIX(inflate)(&zlib->zstream, Z_FINISH);
+
+        zlib->total_in += input_len - (int32_t)zlib->zstream.avail_in;
+        zlib->total_out += size - (int32_t)zlib->zstream.avail_out;
+
+        if (err == Z_STREAM_END && zlib->zstream.msg == NULL)
+            err = Z_OK;
+        else if (err >= Z_OK || err == Z_BUF_ERROR)
+            err = Z_DATA_ERROR;
+        zlib->error = err;
+    }
+
+    zlib->zstream.next_in = zlib->buffer;
+    zlib->zstream.avail_in = 0;
+
+    if (input != zlib->buffer)
+        MZ_FREE(input);
+
+    if (err != Z_OK)
+        return err;
+    return size - (int32_t)zlib->zstream.avail_out;
+}
+#endif
+
 int32_t mz_stream_zlib_read(void *stream, void *buf, int32_t size) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
     MZ_UNUSED(stream);
@@ -140,10 +708,23 @@ int32_t mz_stream_zlib_read(void *stream, void *buf, int32_t size) {
     uint32_t total_out = 0;
     uint32_t in_bytes = 0;
     uint32_t out_bytes = 0;
-    int32_t bytes_to_read = sizeof(zlib->buffer);
+    int32_t bytes_to_read = zlib->buffer_size;
     int32_t read = 0;
     int32_t err = Z_OK;
 
+    /* Inflate state never saw the data when it was all decoded by libdeflate */
+    if (zlib->finished)
+        return 0;
+
+    /* Decode in one call when asked for the whole entry and both sizes are known, the compressed
+       size comes from the zip so it must not be larger than the uncompressed data could deflate to */
+    if (zlib->read_all) {
+        zlib->read_all = 0;
+        if (zlib->total_in == 0 && zlib->total_out == 0 && zlib->max_total_in > 0 &&
+            zlib->max_total_in <= INT32_MAX && zlib->max_total_out >= 0 && size >= zlib->max_total_out &&
+            zlib->max_total_in <= (int64_t)ZLIB_PREFIX(compressBound)((uLong)zlib->max_total_out))
+            return mz_stream_zlib_read_all(zlib, buf, size);
+    }
 
     zlib->zstream.next_out = (Bytef*)buf;
     zlib->zstream.avail_out = (uInt)size;
@@ -224,7 +805,7 @@ static int32_t mz_stream_zlib_deflate(void *stream, int flush) {
             if (err != MZ_OK)
                 return err;
 
-            zlib->zstream.avail_out = sizeof(zlib->buffer);
+            zlib->zstream.avail_out = (uInt)zlib->buffer_size;
             zlib->zstream.next_out = zlib->buffer;
 
             zlib->buffer_len = 0;
@@ -251,6 +832,55 @@ static int32_t mz_stream_zlib_deflate(void *stream, int flush) {
 }
 #endif
 
+#if defined(HAVE_LIBDEFLATE) && !defined(MZ_ZIP_NO_COMPRESSION)
+static int32_t mz_stream_zlib_deflate_all(mz_stream_zlib *zlib, const void *buf, int32_t size) {
+    uint8_t *output = zlib->buffer;
+    size_t output_size = 0;
+    int16_t level = zlib->level;
+    int32_t written = 0;
+
+    if (zlib->window_bits != -MAX_WBITS)
+        return MZ_SUPPORT_ERROR;
+    if (level < 0)
+        level = 6;
+
+    /* Compressor is kept for the next entry unless the level changes */
+    if (zlib->compressor != NULL && zlib->compressor_level != level) {
+        libdeflate_free_compressor(zlib->compressor);
+        zlib->compressor = NULL;
+    }
+    if (zlib->compressor == NULL) {
+        zlib->compressor = libdeflate_alloc_compressor(level);
+        zlib->compressor_level = level;
+        if (zlib->compressor == NULL)
+            return MZ_SUPPORT_ERROR;
+    }
+
+    output_size = libdeflate_deflate_compress_bound(zlib->compressor, (size_t)size);
+    if (output_size > INT32_MAX)
+        return MZ_SUPPORT_ERROR;
+    if (output_size > (size_t)zlib->buffer_size) {
+        output = (uint8_t *)MZ_ALLOC(output_size);
+        if (output == NULL)
+            return MZ_SUPPORT_ERROR;
+    }
+
+    written = (int32_t)libdeflate_deflate_compress(zlib->compressor, buf, (size_t)size, output, output_size);
+    if (written > 0 && mz_stream_write(zlib->stream.base, output, written) == written) {
+        zlib->total_out += written;
+        zlib->finished = 1;
+        written = MZ_OK;
+    } else {
+        zlib->error = Z_DATA_ERROR;
+        written = MZ_WRITE_ERROR;
+    }
+
+    if (output != zlib->buffer)
+        MZ_FREE(output);
+    return written;
+}
+#endif
+
 int32_t mz_stream_zlib_write(void *stream, const void *buf, int32_t size) {
 #ifdef MZ_ZIP_NO_COMPRESSION
     MZ_UNUSED(stream);
@@ -261,10 +891,29 @@ int32_t mz_stream_zlib_write(void *stream, const void *buf, int32_t size) {
     mz_stream_zlib *zlib = (mz_stream_zlib *)stream;
     int32_t err = MZ_OK;
 
+    if (zlib->threads != NULL)
+        return mz_stream_zlib_threads_write(stream, buf, size);
+    if (zlib->finished)
+        return MZ_WRITE_ERROR;
+
     zlib->zstream.next_in = (Bytef*)(intptr_t)buf;
     zlib->zstream.avail_in = (uInt)size;
 
-    err = mz_stream_zlib_deflate(stream, Z_NO_FLUSH);
+    /* Finish the stream in the same call when this is all the input there will be */
+    if (zlib->total_in == 0 && zlib->max_total_in > 0 && zlib->max_total_in == size) {
+#ifdef HAVE_LIBDEFLATE
+        err = mz_stream_zlib_deflate_all(zlib, buf, size);
+        if (err == MZ_OK) {
+            zlib->total_in += size;
+            return size;
+        }
+        if (err != MZ_SUPPORT_ERROR)
+            return err;
+#endif
+        err = mz_stream_zlib_deflate(stream, Z_FINISH);
+    } else {
+        err = mz_stream_zlib_deflate(stream, Z_NO_FLUSH);
+    }
     if (err != MZ_OK) {
         return err;
     }
@@ -296,16 +945,21 @@ int32_t mz_stream_zlib_close(void *stream) {
 #ifdef MZ_ZIP_NO_COMPRESSION
         return MZ_SUPPORT_ERROR;
 #else
-        mz_stream_zlib_deflate(stream, Z_FINISH);
-        mz_stream_zlib_flush(stream);
-
-        ZLIB_PREFIX(deflateEnd)(&zlib->zstream);
+        if (zlib->threads != NULL) {
+            if (mz_stream_zlib_threads_finish(stream) != MZ_OK)
+                zlib->error = Z_DATA_ERROR;
+            mz_stream_zlib_threads_stop(stream);
+        } else {
+            /* Deflate state is kept until the stream is deleted so it can be reused */
+            if (!zlib->finished) {
+                mz_stream_zlib_deflate(stream, Z_FINISH);
+                mz_stream_zlib_flush(stream);
+            }
+        }
 #endif
     } else if (zlib->mode & MZ_OPEN_MODE_READ) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
         return MZ_SUPPORT_ERROR;
-#else
-        ZLIB_PREFIX(inflateEnd)(&zlib->zstream);
 #endif
     }
 
@@ -333,12 +987,18 @@ int32_t mz_stream_zlib_get_prop_int64(void *stream, int32_t prop, int64_t *value
     case MZ_STREAM_PROP_TOTAL_OUT:
         *value = zlib->total_out;
         break;
+    case MZ_STREAM_PROP_TOTAL_OUT_MAX:
+        *value = zlib->max_total_out;
+        break;
     case MZ_STREAM_PROP_HEADER_SIZE:
         *value = 0;
         break;
     case MZ_STREAM_PROP_COMPRESS_WINDOW:
         *value = zlib->window_bits;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = zlib->buffer_size;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -354,9 +1014,30 @@ int32_t mz_stream_zlib_set_prop_int64(void *stream, int32_t prop, int64_t value)
     case MZ_STREAM_PROP_TOTAL_IN_MAX:
         zlib->max_total_in = value;
         break;
+    case MZ_STREAM_PROP_TOTAL_OUT_MAX:
+        zlib->max_total_out = value;
+        break;
+    case MZ_STREAM_PROP_READ_ALL:
+        zlib->read_all = (int8_t)(value != 0);
+        break;
     case MZ_STREAM_PROP_COMPRESS_WINDOW:
         zlib->window_bits = (int32_t)value;
         break;
+    case MZ_STREAM_PROP_COMPRESS_THREADS:
+        zlib->thread_count = (int32_t)value;
+        break;
+    case MZ_STREAM_PROP_COMPRESS_JOB_SIZE:
+        zlib->job_size = value;
+        break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        if (value <= 0 || value > INT32_MAX || zlib->initialized)
+            return MZ_PARAM_ERROR;
+        if (zlib->buffer != NULL && zlib->buffer_size != (int32_t)value) {
+            MZ_FREE(zlib->buffer);
+            zlib->buffer = NULL;
+        }
+        zlib->buffer_size = (int32_t)value;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -372,6 +1053,8 @@ void *mz_stream_zlib_create(void **stream) {
         zlib->stream.vtbl = &mz_stream_zlib_vtbl;
         zlib->level = Z_DEFAULT_COMPRESSION;
         zlib->window_bits = -MAX_WBITS;
+        zlib->buffer_size = INT16_MAX;
+        zlib->max_total_out = -1;
     }
     if (stream != NULL)
         *stream = zlib;
@@ -384,8 +1067,21 @@ void mz_stream_zlib_delete(void **stream) {
     if (stream == NULL)
         return;
     zlib = (mz_stream_zlib *)*stream;
-    if (zlib != NULL)
+    if (zlib != NULL) {
+#ifndef MZ_ZIP_NO_COMPRESSION
+        mz_stream_zlib_threads_stop(zlib);
+#endif
+        mz_stream_zlib_end(zlib);
+#ifdef HAVE_LIBDEFLATE
+        if (zlib->compressor != NULL)
+            libdeflate_free_compressor(zlib->compressor);
+        if (zlib->decompressor != NULL)
+            libdeflate_free_decompressor(zlib->decompressor);
+#endif
+        if (zlib->buffer != NULL)
+            MZ_FREE(zlib->buffer);
         MZ_FREE(zlib);
+    }
     *stream = NULL;
 }
 
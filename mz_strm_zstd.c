@@ -43,14 +43,19 @@ typedef struct mz_stream_zstd_s {
     ZSTD_inBuffer   in;
     int32_t         mode;
     int32_t         error;
-    uint8_t         buffer[INT16_MAX];
+    uint8_t         *buffer;
+    int32_t         buffer_size;
     int32_t         buffer_len;
     int64_t         total_in;
     int64_t         total_out;
     int64_t         max_total_in;
     int64_t         max_total_out;
+    int8_t          end_of_frame;
+    int8_t          read_all;
     int8_t          initialized;
     uint32_t        preset;
+    int32_t         thread_count;
+    int64_t         job_size;
 } mz_stream_zstd;
 
 /***************************************************************************/
@@ -60,20 +65,51 @@ int32_t mz_stream_zstd_open(void *stream, const char *path, int32_t mode) {
 
     MZ_UNUSED(path);
 
+    if (zstd->buffer == NULL) {
+        zstd->buffer = (uint8_t *)MZ_ALLOC(zstd->buffer_size);
+        if (zstd->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    zstd->buffer_len = 0;
+    zstd->total_in = 0;
+    zstd->total_out = 0;
+    zstd->end_of_frame = 0;
+    zstd->read_all = 0;
+
     if (mode & MZ_OPEN_MODE_WRITE) {
 #ifdef MZ_ZIP_NO_COMPRESSION
         return MZ_SUPPORT_ERROR;
 #else
-        zstd->zcstream = ZSTD_createCStream();
+        /* Reuse the context from the last time the stream was opened, resetting it to the defaults */
+        if (zstd->zcstream == NULL)
+            zstd->zcstream = ZSTD_createCStream();
+        else
+            ZSTD_CCtx_reset(zstd->zcstream, ZSTD_reset_session_and_parameters);
+
+        /* Multithreading is only available when zstd is built with it, otherwise compress on this thread */
+        if (zstd->zcstream != NULL && zstd->thread_count > 1) {
+            if (!ZSTD_isError(ZSTD_CCtx_setParameter(zstd->zcstream, ZSTD_c_nbWorkers, zstd->thread_count))) {
+                /* Job size is clamped by zstd to the range it supports */
+                if (zstd->job_size > INT32_MAX)
+                    ZSTD_CCtx_setParameter(zstd->zcstream, ZSTD_c_jobSize, INT32_MAX);
+                else if (zstd->job_size > 0)
+                    ZSTD_CCtx_setParameter(zstd->zcstream, ZSTD_c_jobSize, (int)zstd->job_size);
+            }
+        }
+
         zstd->out.dst = zstd->buffer;
-        zstd->out.size = sizeof(zstd->buffer);
+        zstd->out.size = (size_t)zstd->buffer_size;
         zstd->out.pos = 0;
 #endif
     } else if (mode & MZ_OPEN_MODE_READ) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
         return MZ_SUPPORT_ERROR;
 #else
-        zstd->zdstream = ZSTD_createDStream();
+        if (zstd->zdstream == NULL)
+            zstd->zdstream = ZSTD_createDStream();
+        else
+            ZSTD_DCtx_reset(zstd->zdstream, ZSTD_reset_session_and_parameters);
         memset(&zstd->out, 0, sizeof(ZSTD_outBuffer));
 #endif
     }
@@ -94,6 +130,55 @@ int32_t mz_stream_zstd_is_open(void *stream) {
     return MZ_OK;
 }
 
+#ifndef MZ_ZIP_NO_DECOMPRESSION
+static int32_t mz_stream_zstd_read_all(mz_stream_zstd *zstd, void *buf, int32_t size) {
+    uint8_t *input = zstd->buffer;
+    int32_t input_size = (int32_t)zstd->max_total_in;
+    int32_t input_len = 0;
+    int32_t read = 0;
+    int32_t err = MZ_OK;
+    size_t result = 0;
+
+    /* Read all compressed frames and decompress them straight into the caller's buffer */
+    if (input_size > zstd->buffer_size) {
+        input = (uint8_t *)MZ_ALLOC(input_size);
+        if (input == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    while (input_len < input_size) {
+        read = mz_stream_read(zstd->stream.base, input + input_len, input_size - input_len);
+        if (read <= 0)
+            break;
+        input_len += read;
+    }
+
+    if (read < 0) {
+        err = read;
+    } else {
+        result = ZSTD_decompressDCtx(zstd->zdstream, buf, (size_t)size, input, (size_t)input_len);
+        if (ZSTD_isError(result)) {
+            zstd->error = (int32_t)result;
+            err = MZ_DATA_ERROR;
+        } else {
+            zstd->total_in += input_len;
+            zstd->total_out += (int64_t)result;
+        }
+    }
+
+    zstd->in.src = (const void *)zstd->buffer;
+    zstd->in.pos = 0;
+    zstd->in.size = 0;
+
+    if (input != zstd->buffer)
+        MZ_FREE(input);
+
+    if (err != MZ_OK)
+        return err;
+    return (int32_t)result;
+}
+#endif
+
 int32_t mz_stream_zstd_read(void *stream, void *buf, int32_t size) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
     MZ_UNUSED(stream);
@@ -110,10 +195,20 @@ int32_t mz_stream_zstd_read(void *stream, void *buf, int32_t size) {
     int32_t total_out = 0;
     int32_t in_bytes = 0;
     int32_t out_bytes = 0;
-    int32_t bytes_to_read = sizeof(zstd->buffer);
+    int32_t bytes_to_read = zstd->buffer_size;
     int32_t read = 0;
     size_t result = 0;
 
+    /* Decode in one call when asked for the whole entry and both sizes are known, the compressed
+       size comes from the zip so it must not be larger than the uncompressed data could compress to */
+    if (zstd->read_all) {
+        zstd->read_all = 0;
+        if (zstd->total_in == 0 && zstd->total_out == 0 && zstd->max_total_in > 0 &&
+            zstd->max_total_in <= INT32_MAX && zstd->max_total_out >= 0 && size >= zstd->max_total_out &&
+            (uint64_t)zstd->max_total_in <= (uint64_t)ZSTD_compressBound((size_t)zstd->max_total_out))
+            return mz_stream_zstd_read_all(zstd, buf, size);
+    }
+
     zstd->out.dst = (void*)buf;
     zstd->out.size = (size_t)size;
     zstd->out.pos = 0;
@@ -188,7 +283,7 @@ static int32_t mz_stream_zstd_compress(void *stream, ZSTD_EndDirective flush) {
                 return err;
 
             zstd->out.dst = zstd->buffer;
-            zstd->out.size = sizeof(zstd->buffer);
+            zstd->out.size = (size_t)zstd->buffer_size;
             zstd->out.pos = 0;
 
             zstd->buffer_len = 0;
@@ -229,7 +324,15 @@ int32_t mz_stream_zstd_write(void *stream, const void *buf, int32_t size) {
     zstd->in.pos = 0;
     zstd->in.size = size;
 
-    err = mz_stream_zstd_compress(stream, ZSTD_e_continue);
+    /* End the frame in the same call when this is all the input there will be */
+    if (zstd->total_in == 0 && zstd->max_total_in > 0 && zstd->max_total_in == size) {
+        ZSTD_CCtx_setPledgedSrcSize(zstd->zcstream, (unsigned long long)size);
+        err = mz_stream_zstd_compress(stream, ZSTD_e_end);
+        zstd->end_of_frame = 1;
+    } else {
+        err = mz_stream_zstd_compress(stream, ZSTD_e_continue);
+        zstd->end_of_frame = 0;
+    }
     if (err != MZ_OK) {
         return err;
     }
@@ -260,18 +363,14 @@ int32_t mz_stream_zstd_close(void *stream) {
 #ifdef MZ_ZIP_NO_COMPRESSION
         return MZ_SUPPORT_ERROR;
 #else
-        mz_stream_zstd_compress(stream, ZSTD_e_end);
+        /* Contexts are kept until the stream is deleted so they can be reused */
+        if (!zstd->end_of_frame)
+            mz_stream_zstd_compress(stream, ZSTD_e_end);
         mz_stream_zstd_flush(stream);
-
-        ZSTD_freeCStream(zstd->zcstream);
-        zstd->zcstream = NULL;
 #endif
     } else if (zstd->mode & MZ_OPEN_MODE_READ) {
 #ifdef MZ_ZIP_NO_DECOMPRESSION
         return MZ_SUPPORT_ERROR;
-#else
-        ZSTD_freeDStream(zstd->zdstream);
-        zstd->zdstream = NULL;
 #endif
     }
     zstd->initialized = 0;
@@ -301,6 +400,9 @@ int32_t mz_stream_zstd_get_prop_int64(void *stream, int32_t prop, int64_t *value
     case MZ_STREAM_PROP_HEADER_SIZE:
         *value = 0;
         break;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        *value = zstd->buffer_size;
+        break;
     default:
         return MZ_EXIST_ERROR;
     }
@@ -319,6 +421,27 @@ int32_t mz_stream_zstd_set_prop_int64(void *stream, int32_t prop, int64_t value)
     case MZ_STREAM_PROP_TOTAL_IN_MAX:
         zstd->max_total_in = value;
         return MZ_OK;
+    case MZ_STREAM_PROP_TOTAL_OUT_MAX:
+        zstd->max_total_out = value;
+        return MZ_OK;
+    case MZ_STREAM_PROP_READ_ALL:
+        zstd->read_all = (int8_t)(value != 0);
+        return MZ_OK;
+    case MZ_STREAM_PROP_COMPRESS_THREADS:
+        zstd->thread_count = (int32_t)value;
+        return MZ_OK;
+    case MZ_STREAM_PROP_COMPRESS_JOB_SIZE:
+        zstd->job_size = value;
+        return MZ_OK;
+    case MZ_STREAM_PROP_BUFFER_SIZE:
+        if (value <= 0 || value > INT32_MAX || zstd->initialized)
+            return MZ_PARAM_ERROR;
+        if (zstd->buffer != NULL && zstd->buffer_size != (int32_t)value) {
+            MZ_FREE(zstd->buffer);
+            zstd->buffer = NULL;
+        }
+        zstd->buffer_size = (int32_t)value;
+        return MZ_OK;
     }
     return MZ_EXIST_ERROR;
 }
@@ -330,6 +453,7 @@ void *mz_stream_zstd_create(void **stream) {
         memset(zstd, 0, sizeof(mz_stream_zstd));
         zstd->stream.vtbl = &mz_stream_zstd_vtbl;
         zstd->max_total_out = -1;
+        zstd->buffer_size = INT16_MAX;
     }
     if (stream != NULL)
         *stream = zstd;
@@ -341,8 +465,15 @@ void mz_stream_zstd_delete(void **stream) {
     if (stream == NULL)
         return;
     zstd = (mz_stream_zstd *)*stream;
-    if (zstd != NULL)
+    if (zstd != NULL) {
+        if (zstd->zcstream != NULL)
+            ZSTD_freeCStream(zstd->zcstream);
+        if (zstd->zdstream != NULL)
+            ZSTD_freeDStream(zstd->zdstream);
+        if (zstd->buffer != NULL)
+            MZ_FREE(zstd->buffer);
         MZ_FREE(zstd);
+    }
     *stream = NULL;
 }
 
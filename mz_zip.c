@@ -79,6 +79,28 @@
 #define MZ_ZIP_EOCD_MAX_BACK            (1 << 20)
 #endif
 
+#define MZ_ZIP_CODEC_POOL_SIZE          (4)
+#define MZ_ZIP_METHOD_MAX               (16)
+
+/***************************************************************************/
+
+typedef struct mz_zip_name_slot_s {
+    uint32_t hash;                  /* hash of normalized, case-folded filename */
+    int64_t  cd_pos;                /* pos of the entry in the central dir, -1 if slot unused */
+} mz_zip_name_slot;
+
+typedef struct mz_zip_method_s {
+    uint16_t            compression_method;
+    mz_stream_create_cb create;     /* creates the compression stream, NULL if slot unused */
+    int32_t             flags;      /* MZ_COMPRESS_FLAG capabilities of the stream */
+} mz_zip_method;
+
+typedef struct mz_zip_codec_slot_s {
+    uint16_t method;                /* compression method of the stream */
+    mz_stream_create_cb create;     /* function that created the stream */
+    void     *stream;               /* closed compression stream, NULL if slot unused */
+} mz_zip_codec_slot;
+
 /***************************************************************************/
 
 typedef struct mz_zip_s {
@@ -89,6 +111,9 @@ typedef struct mz_zip_s {
     void *cd_stream;                /* pointer to the stream with the cd */
     void *cd_mem_stream;            /* memory stream for central directory */
     void *compress_stream;          /* compression stream */
+    uint16_t compress_method;       /* method of the compression stream, 0 if it can't be reused */
+    int32_t  compress_flags;        /* capabilities of the compression stream */
+    mz_stream_create_cb compress_create; /* function that created the compression stream */
     void *crypt_stream;             /* encryption stream */
     void *file_info_stream;         /* memory stream for storing file info */
     void *local_file_info_stream;   /* memory stream for storing local file info */
@@ -96,6 +121,11 @@ typedef struct mz_zip_s {
     int32_t  open_mode;
     uint8_t  recover;
     uint8_t  data_descriptor;
+    uint8_t  cd_index;              /* decode the central dir into an index when reading */
+    uint8_t  cd_in_memory;          /* load the central dir into memory when reading */
+    int32_t  compress_threads;      /* threads used to compress or decompress a single entry */
+    int64_t  compress_job_size;     /* amount of data compressed by each thread at a time */
+    int32_t  buffer_size;           /* size of compression and encryption stream buffers */
 
     uint32_t disk_number_with_cd;   /* number of the disk with the central dir */
     int64_t  disk_offset_shift;     /* correction for zips that have wrong offset start of cd */
@@ -111,8 +141,26 @@ typedef struct mz_zip_s {
     uint8_t  entry_raw;             /* entry opened with raw mode */
     uint32_t entry_crc32;           /* entry crc32  */
 
+    mz_zip_codec_slot codec_pool[MZ_ZIP_CODEC_POOL_SIZE]; /* compression streams kept for later entries */
+
     uint64_t number_entry;
 
+    mz_zip_name_slot *name_index;   /* hash table of entry positions by filename */
+    uint32_t name_index_size;       /* number of slots in the name index */
+    uint32_t name_index_count;      /* number of entries in the name index */
+    int64_t  name_index_pos;        /* pos of the first entry not yet in the name index */
+    uint8_t  name_index_done;       /* all entries in the central dir have been indexed */
+
+    mz_zip_file *cd_index_entries;  /* decoded central dir entries */
+    int64_t  *cd_index_pos;         /* pos of each decoded entry in the central dir */
+    void     *cd_index_stream;      /* memory stream for variable length data of decoded entries */
+    uint64_t cd_index_count;        /* number of decoded entries */
+    uint64_t cd_index_current;      /* index of the current decoded entry */
+    int64_t  cd_index_end_pos;      /* pos after the last decoded entry */
+    int32_t  cd_index_end_err;      /* error reading entry after the last decoded entry */
+    uint8_t  cd_index_loaded;       /* central dir has been decoded */
+    uint8_t  cd_shared;             /* central dir data belongs to another zip handle */
+
     uint16_t version_madeby;
     char     *comment;
 } mz_zip;
@@ -1081,6 +1129,39 @@ static int32_t mz_zip_read_cd(void *handle) {
     return err;
 }
 
+static int32_t mz_zip_read_cd_in_memory(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+    uint8_t *cd_buffer = NULL;
+    int32_t read = 0;
+    int32_t err = MZ_OK;
+
+    if ((zip->cd_size <= 0) || (zip->cd_size > INT32_MAX))
+        return MZ_SUPPORT_ERROR;
+
+    /* Allocate memory for the whole central dir and fill it with a single read */
+    mz_stream_mem_set_grow_size(zip->cd_mem_stream, (int32_t)zip->cd_size);
+    err = mz_stream_mem_open(zip->cd_mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+    if (err == MZ_OK)
+        err = mz_stream_mem_get_buffer(zip->cd_mem_stream, (const void **)&cd_buffer);
+    if (err == MZ_OK) {
+        mz_stream_set_prop_int64(zip->stream, MZ_STREAM_PROP_DISK_NUMBER, -1);
+        err = mz_stream_seek(zip->stream, zip->cd_offset, MZ_SEEK_SET);
+    }
+    if (err == MZ_OK) {
+        read = mz_stream_read(zip->stream, cd_buffer, (int32_t)zip->cd_size);
+        if (read != (int32_t)zip->cd_size)
+            err = MZ_READ_ERROR;
+    }
+    if (err == MZ_OK) {
+        mz_zip_print("Zip - Read cd in memory (size %" PRId64 ")\n", zip->cd_size);
+
+        mz_stream_mem_set_buffer_limit(zip->cd_mem_stream, read);
+        zip->cd_stream = zip->cd_mem_stream;
+        zip->cd_start_pos = 0;
+    }
+    return err;
+}
+
 static int32_t mz_zip_write_cd(void *handle) {
     mz_zip *zip = (mz_zip *)handle;
     int64_t zip64_eocd_pos_inzip = 0;
@@ -1385,6 +1466,456 @@ static int32_t mz_zip_recover_cd(void *handle) {
     return MZ_OK;
 }
 
+/***************************************************************************/
+
+static int32_t mz_zip_read_cd_entry(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+    int32_t err = MZ_OK;
+
+    mz_stream_set_prop_int64(zip->cd_stream, MZ_STREAM_PROP_DISK_NUMBER, -1);
+
+    err = mz_stream_seek(zip->cd_stream, zip->cd_current_pos, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = mz_zip_entry_read_header(zip->cd_stream, 0, &zip->file_info, zip->file_info_stream);
+    return err;
+}
+
+static void mz_zip_cd_index_reset(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+
+    if (!zip->cd_shared) {
+        if (zip->cd_index_entries != NULL)
+            MZ_FREE(zip->cd_index_entries);
+        if (zip->cd_index_pos != NULL)
+            MZ_FREE(zip->cd_index_pos);
+    }
+    if (zip->cd_index_stream != NULL) {
+        mz_stream_mem_close(zip->cd_index_stream);
+        mz_stream_mem_delete(&zip->cd_index_stream);
+    }
+
+    zip->cd_index_entries = NULL;
+    zip->cd_index_pos = NULL;
+    zip->cd_index_count = 0;
+    zip->cd_index_current = 0;
+    zip->cd_index_end_pos = 0;
+    zip->cd_index_end_err = MZ_OK;
+    zip->cd_index_loaded = 0;
+}
+
+static int32_t mz_zip_cd_index_grow(void *handle, uint64_t max_entries) {
+    mz_zip *zip = (mz_zip *)handle;
+    mz_zip_file *entries = NULL;
+    int64_t *pos = NULL;
+
+    if (max_entries > (uint64_t)(SIZE_MAX / sizeof(mz_zip_file)))
+        return MZ_MEM_ERROR;
+
+    entries = (mz_zip_file *)MZ_ALLOC((size_t)max_entries * sizeof(mz_zip_file));
+    pos = (int64_t *)MZ_ALLOC((size_t)max_entries * sizeof(int64_t));
+    if (entries == NULL || pos == NULL) {
+        if (entries != NULL)
+            MZ_FREE(entries);
+        if (pos != NULL)
+            MZ_FREE(pos);
+        return MZ_MEM_ERROR;
+    }
+
+    if (zip->cd_index_count > 0) {
+        memcpy(entries, zip->cd_index_entries, (size_t)zip->cd_index_count * sizeof(mz_zip_file));
+        memcpy(pos, zip->cd_index_pos, (size_t)zip->cd_index_count * sizeof(int64_t));
+    }
+    if (zip->cd_index_entries != NULL)
+        MZ_FREE(zip->cd_index_entries);
+    if (zip->cd_index_pos != NULL)
+        MZ_FREE(zip->cd_index_pos);
+
+    zip->cd_index_entries = entries;
+    zip->cd_index_pos = pos;
+    return MZ_OK;
+}
+
+static int32_t mz_zip_cd_index_write_string(void *stream, const char *value, int32_t size) {
+    if ((size > 0) && (mz_stream_mem_write(stream, value, size) != size))
+        return MZ_MEM_ERROR;
+    if (mz_stream_write_uint8(stream, 0) != MZ_OK)
+        return MZ_MEM_ERROR;
+    return MZ_OK;
+}
+
+static int32_t mz_zip_cd_index_build(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+    mz_zip_file *file_info = NULL;
+    uint64_t max_entries = 0;
+    uint64_t i = 0;
+    int64_t grow_size = 0;
+    int64_t cd_current_pos = zip->cd_current_pos;
+    int32_t err = MZ_OK;
+    const char *ptr = NULL;
+
+
+    mz_zip_cd_index_reset(handle);
+
+    /* Each record in the central dir is at least MZ_ZIP_SIZE_CD_ITEM bytes */
+    max_entries = zip->number_entry;
+    if (max_entries > (uint64_t)(zip->cd_size / MZ_ZIP_SIZE_CD_ITEM) + 1)
+        max_entries = (uint64_t)(zip->cd_size / MZ_ZIP_SIZE_CD_ITEM) + 1;
+    if (max_entries < 16)
+        max_entries = 16;
+
+    err = mz_zip_cd_index_grow(handle, max_entries);
+    if (err != MZ_OK)
+        return err;
+
+    /* Variable length data never takes more room than the central dir itself */
+    grow_size = zip->cd_size + 4 * (int64_t)max_entries;
+    if (grow_size > INT32_MAX)
+        grow_size = INT32_MAX;
+    if (grow_size < 4096)
+        grow_size = 4096;
+
+    mz_stream_mem_create(&zip->cd_index_stream);
+    mz_stream_mem_set_grow_size(zip->cd_index_stream, (int32_t)grow_size);
+    err = mz_stream_mem_open(zip->cd_index_stream, NULL, MZ_OPEN_MODE_CREATE);
+    if (err != MZ_OK)
+        err = MZ_MEM_ERROR;
+
+    /* Decode each entry in the central dir once */
+    zip->cd_current_pos = zip->cd_start_pos;
+    if (err == MZ_OK)
+        err = mz_zip_read_cd_entry(handle);
+
+    while (err == MZ_OK) {
+        if (zip->cd_index_count == max_entries) {
+            max_entries *= 2;
+            err = mz_zip_cd_index_grow(handle, max_entries);
+            if (err != MZ_OK)
+                break;
+        }
+
+        file_info = &zip->file_info;
+        err = mz_zip_cd_index_write_string(zip->cd_index_stream, file_info->filename, file_info->filename_size);
+        if (err == MZ_OK)
+            err = mz_zip_cd_index_write_string(zip->cd_index_stream, (const char *)file_info->extrafield,
+                file_info->extrafield_size);
+        if (err == MZ_OK)
+            err = mz_zip_cd_index_write_string(zip->cd_index_stream, file_info->comment, file_info->comment_size);
+        if (err == MZ_OK)
+            err = mz_zip_cd_index_write_string(zip->cd_index_stream, file_info->linkname,
+                (int32_t)strlen(file_info->linkname));
+        if (err != MZ_OK)
+            break;
+
+        zip->cd_index_entries[zip->cd_index_count] = *file_info;
+        zip->cd_index_pos[zip->cd_index_count] = zip->cd_current_pos;
+        zip->cd_index_count += 1;
+
+        zip->cd_current_pos += (int64_t)MZ_ZIP_SIZE_CD_ITEM + file_info->filename_size +
+            file_info->extrafield_size + file_info->comment_size;
+
+        err = mz_zip_read_cd_entry(handle);
+    }
+
+    if (err == MZ_MEM_ERROR) {
+        mz_zip_cd_index_reset(handle);
+        zip->cd_current_pos = cd_current_pos;
+        return err;
+    }
+
+    zip->cd_index_end_pos = zip->cd_current_pos;
+    zip->cd_index_end_err = err;
+
+    /* Point variable length data to their location in the memory stream */
+    mz_stream_mem_get_buffer(zip->cd_index_stream, (const void **)&ptr);
+    for (i = 0; i < zip->cd_index_count; i += 1) {
+        file_info = &zip->cd_index_entries[i];
+        file_info->filename = ptr;
+        ptr += file_info->filename_size + 1;
+        file_info->extrafield = (const uint8_t *)ptr;
+        ptr += file_info->extrafield_size + 1;
+        file_info->comment = ptr;
+        ptr += file_info->comment_size + 1;
+        file_info->linkname = ptr;
+        ptr += strlen(ptr) + 1;
+    }
+
+    mz_zip_print("Zip - Cd index - Built (entries %" PRIu64 " end err %" PRId32 ")\n",
+        zip->cd_index_count, zip->cd_index_end_err);
+
+    zip->cd_current_pos = cd_current_pos;
+    zip->cd_index_current = 0;
+    zip->cd_index_loaded = 1;
+    return MZ_OK;
+}
+
+static int32_t mz_zip_cd_index_goto(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+    uint64_t low = 0;
+    uint64_t high = zip->cd_index_count;
+    uint64_t mid = 0;
+    uint64_t next = zip->cd_index_current + 1;
+
+    if (zip->cd_current_pos == zip->cd_index_end_pos)
+        return zip->cd_index_end_err;
+
+    /* Entries are usually visited in order */
+    if ((next < zip->cd_index_count) && (zip->cd_index_pos[next] == zip->cd_current_pos)) {
+        low = next;
+    } else {
+        while (low < high) {
+            mid = low + (high - low) / 2;
+            if (zip->cd_index_pos[mid] < zip->cd_current_pos)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if ((low >= zip->cd_index_count) || (zip->cd_index_pos[low] != zip->cd_current_pos))
+            return MZ_EXIST_ERROR;
+    }
+
+    zip->cd_index_current = low;
+    zip->file_info = zip->cd_index_entries[low];
+    zip->entry_scanned = 1;
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
+static uint32_t mz_zip_name_hash(const char *filename) {
+    uint32_t hash = 2166136261U;
+    int32_t c = 0;
+
+    /* FNV-1a of the filename with the same normalization as mz_zip_path_compare */
+    while (*filename != 0) {
+        c = (uint8_t)*filename;
+        if (c == '\\')
+            c = '/';
+        hash ^= (uint32_t)tolower(c);
+        hash *= 16777619U;
+        filename += 1;
+    }
+    return hash;
+}
+
+static void mz_zip_name_index_reset(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+
+    if ((zip->name_index != NULL) && (!zip->cd_shared))
+        MZ_FREE(zip->name_index);
+
+    zip->name_index = NULL;
+    zip->name_index_size = 0;
+    zip->name_index_count = 0;
+    zip->name_index_pos = 0;
+    zip->name_index_done = 0;
+}
+
+static int32_t mz_zip_name_index_insert(void *handle, uint32_t hash, int64_t cd_pos) {
+    mz_zip *zip = (mz_zip *)handle;
+    mz_zip_name_slot *old_index = zip->name_index;
+    uint32_t old_size = zip->name_index_size;
+    uint32_t size = old_size;
+    uint32_t mask = 0;
+    uint32_t slot = 0;
+    uint32_t start = 0;
+    uint32_t i = 0;
+
+    /* Keep load factor at or below one half */
+    if ((zip->name_index_count + 1) * 2 > size) {
+        if (size == 0) {
+            size = 64;
+            while (size < zip->number_entry * 2 && size < (UINT16_MAX + 1) * 2)
+                size *= 2;
+        } else {
+            if (size > (UINT32_MAX >> 1))
+                return MZ_MEM_ERROR;
+            size *= 2;
+        }
+
+        zip->name_index = (mz_zip_name_slot *)MZ_ALLOC(size * sizeof(mz_zip_name_slot));
+        if (zip->name_index == NULL) {
+            zip->name_index = old_index;
+            return MZ_MEM_ERROR;
+        }
+        for (i = 0; i < size; i += 1)
+            zip->name_index[i].cd_pos = -1;
+
+        zip->name_index_size = size;
+        zip->name_index_count = 0;
+
+        /* Rehash starting after an unused slot so entries with the same name keep their order */
+        if (old_index != NULL) {
+            while (old_index[start].cd_pos >= 0)
+                start += 1;
+            for (i = 1; i <= old_size; i += 1) {
+                slot = (start + i) & (old_size - 1);
+                if (old_index[slot].cd_pos >= 0)
+                    mz_zip_name_index_insert(handle, old_index[slot].hash, old_index[slot].cd_pos);
+            }
+            MZ_FREE(old_index);
+        }
+    }
+
+    mask = zip->name_index_size - 1;
+    slot = hash & mask;
+    while (zip->name_index[slot].cd_pos >= 0)
+        slot = (slot + 1) & mask;
+
+    zip->name_index[slot].hash = hash;
+    zip->name_index[slot].cd_pos = cd_pos;
+    zip->name_index_count += 1;
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
+/* Built-in streams, the first one listed for a method is used */
+static const mz_zip_method mz_zip_builtin_methods[] = {
+#ifdef HAVE_ZLIB
+    { MZ_COMPRESS_METHOD_DEFLATE, mz_stream_zlib_create, MZ_COMPRESS_FLAG_ONE_SHOT | MZ_COMPRESS_FLAG_THREADS },
+#endif
+#ifdef HAVE_BZIP2
+    { MZ_COMPRESS_METHOD_BZIP2, mz_stream_bzip_create, 0 },
+#endif
+#ifdef HAVE_LIBCOMP
+    { MZ_COMPRESS_METHOD_DEFLATE, mz_stream_libcomp_create, 0 },
+    { MZ_COMPRESS_METHOD_XZ, mz_stream_libcomp_create, 0 },
+#endif
+#ifdef HAVE_LZMA
+    { MZ_COMPRESS_METHOD_LZMA, mz_stream_lzma_create, 0 },
+    { MZ_COMPRESS_METHOD_XZ, mz_stream_lzma_create, MZ_COMPRESS_FLAG_THREADS },
+#endif
+#ifdef HAVE_ZSTD
+    { MZ_COMPRESS_METHOD_ZSTD, mz_stream_zstd_create, MZ_COMPRESS_FLAG_ONE_SHOT | MZ_COMPRESS_FLAG_THREADS },
+#endif
+    { MZ_COMPRESS_METHOD_STORE, NULL, 0 }
+};
+
+/* Streams registered at runtime, these take precedence over built-in streams */
+static mz_zip_method mz_zip_methods[MZ_ZIP_METHOD_MAX];
+
+static const mz_zip_method *mz_zip_method_find(uint16_t compression_method) {
+    int32_t i = 0;
+
+    for (i = 0; i < MZ_ZIP_METHOD_MAX; i += 1) {
+        if (mz_zip_methods[i].create != NULL && mz_zip_methods[i].compression_method == compression_method)
+            return &mz_zip_methods[i];
+    }
+    for (i = 0; mz_zip_builtin_methods[i].create != NULL; i += 1) {
+        if (mz_zip_builtin_methods[i].compression_method == compression_method)
+            return &mz_zip_builtin_methods[i];
+    }
+    return NULL;
+}
+
+int32_t mz_zip_register_method(uint16_t compression_method, mz_stream_create_cb create, int32_t flags) {
+    int32_t slot = -1;
+    int32_t i = 0;
+
+    if (compression_method == MZ_COMPRESS_METHOD_STORE || compression_method == MZ_COMPRESS_METHOD_AES)
+        return MZ_PARAM_ERROR;
+
+    for (i = MZ_ZIP_METHOD_MAX - 1; i >= 0; i -= 1) {
+        if (mz_zip_methods[i].create != NULL && mz_zip_methods[i].compression_method == compression_method)
+            break;
+        if (mz_zip_methods[i].create == NULL)
+            slot = i;
+    }
+    if (i >= 0)
+        slot = i;
+
+    /* Unregister to fall back to the built-in stream */
+    if (create == NULL) {
+        if (i >= 0)
+            mz_zip_methods[i].create = NULL;
+        return MZ_OK;
+    }
+    if (slot < 0)
+        return MZ_MEM_ERROR;
+
+    mz_zip_methods[slot].compression_method = compression_method;
+    mz_zip_methods[slot].create = create;
+    mz_zip_methods[slot].flags = flags;
+    return MZ_OK;
+}
+
+int32_t mz_zip_get_method(uint16_t compression_method, mz_stream_create_cb *create, int32_t *flags) {
+    const mz_zip_method *method = NULL;
+
+    if (compression_method == MZ_COMPRESS_METHOD_STORE) {
+        if (create != NULL)
+            *create = mz_stream_raw_create;
+        if (flags != NULL)
+            *flags = 0;
+        return MZ_OK;
+    }
+
+    method = mz_zip_method_find(compression_method);
+    if (method == NULL)
+        return MZ_SUPPORT_ERROR;
+    if (create != NULL)
+        *create = method->create;
+    if (flags != NULL)
+        *flags = method->flags;
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
+static void mz_zip_codec_pool_reset(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+    int32_t i = 0;
+
+    for (i = 0; i < MZ_ZIP_CODEC_POOL_SIZE; i += 1) {
+        if (zip->codec_pool[i].stream != NULL)
+            mz_stream_delete(&zip->codec_pool[i].stream);
+        zip->codec_pool[i].stream = NULL;
+    }
+}
+
+static void *mz_zip_codec_pool_take(void *handle, uint16_t method, mz_stream_create_cb create) {
+    mz_zip *zip = (mz_zip *)handle;
+    void *stream = NULL;
+    int32_t i = 0;
+
+    for (i = 0; i < MZ_ZIP_CODEC_POOL_SIZE; i += 1) {
+        if (zip->codec_pool[i].stream == NULL || zip->codec_pool[i].method != method)
+            continue;
+
+        stream = zip->codec_pool[i].stream;
+        zip->codec_pool[i].stream = NULL;
+
+        /* Method was registered to another stream since this one was pooled */
+        if (zip->codec_pool[i].create != create) {
+            mz_stream_delete(&stream);
+            continue;
+        }
+
+        /* Clear limits set for the previous entry */
+        mz_stream_set_prop_int64(stream, MZ_STREAM_PROP_TOTAL_IN_MAX, 0);
+        mz_stream_set_prop_int64(stream, MZ_STREAM_PROP_TOTAL_OUT_MAX, -1);
+        break;
+    }
+    return stream;
+}
+
+static int32_t mz_zip_codec_pool_put(void *handle, uint16_t method, mz_stream_create_cb create, void *stream) {
+    mz_zip *zip = (mz_zip *)handle;
+    int32_t i = 0;
+
+    for (i = 0; i < MZ_ZIP_CODEC_POOL_SIZE; i += 1) {
+        if (zip->codec_pool[i].stream == NULL) {
+            zip->codec_pool[i].method = method;
+            zip->codec_pool[i].create = create;
+            zip->codec_pool[i].stream = stream;
+            return MZ_OK;
+        }
+    }
+    return MZ_MEM_ERROR;
+}
+
+/***************************************************************************/
+
 void *mz_zip_create(void **handle) {
     mz_zip *zip = NULL;
 
@@ -1405,6 +1936,7 @@ void mz_zip_delete(void **handle) {
         return;
     zip = (mz_zip *)*handle;
     if (zip != NULL) {
+        mz_zip_codec_pool_reset(zip);
         MZ_FREE(zip);
     }
     *handle = NULL;
@@ -1465,6 +1997,10 @@ int32_t mz_zip_open(void *handle, void *stream, int32_t mode) {
             }
         } else {
             zip->cd_start_pos = zip->cd_offset;
+
+            /* Keep reading from the main stream if the central dir can't be loaded */
+            if ((err == MZ_OK) && (zip->cd_in_memory) && (zip->cd_stream == zip->stream))
+                mz_zip_read_cd_in_memory(zip);
         }
     }
 
@@ -1515,10 +2051,16 @@ int32_t mz_zip_close(void *handle) {
     }
 
     if (zip->comment) {
-        MZ_FREE(zip->comment);
+        if (!zip->cd_shared)
+            MZ_FREE(zip->comment);
         zip->comment = NULL;
     }
 
+    mz_zip_name_index_reset(handle);
+    mz_zip_cd_index_reset(handle);
+    mz_zip_codec_pool_reset(handle);
+
+    zip->cd_shared = 0;
     zip->stream = NULL;
     zip->cd_stream = NULL;
 
@@ -1540,6 +2082,8 @@ int32_t mz_zip_set_comment(void *handle, const char *comment) {
     int32_t comment_size = 0;
     if (zip == NULL || comment == NULL)
         return MZ_PARAM_ERROR;
+    if (zip->cd_shared)
+        return MZ_SUPPORT_ERROR;
     if (zip->comment != NULL)
         MZ_FREE(zip->comment);
     comment_size = (int32_t)strlen(comment);
@@ -1577,6 +2121,22 @@ int32_t mz_zip_set_recover(void *handle, uint8_t recover) {
     return MZ_OK;
 }
 
+int32_t mz_zip_set_cd_index(void *handle, uint8_t cd_index) {
+    mz_zip *zip = (mz_zip *)handle;
+    if (zip == NULL)
+        return MZ_PARAM_ERROR;
+    zip->cd_index = cd_index;
+    return MZ_OK;
+}
+
+int32_t mz_zip_set_cd_in_memory(void *handle, uint8_t cd_in_memory) {
+    mz_zip *zip = (mz_zip *)handle;
+    if (zip == NULL)
+        return MZ_PARAM_ERROR;
+    zip->cd_in_memory = cd_in_memory;
+    return MZ_OK;
+}
+
 int32_t mz_zip_set_data_descriptor(void *handle, uint8_t data_descriptor) {
     mz_zip *zip = (mz_zip *)handle;
     if (zip == NULL)
@@ -1585,6 +2145,30 @@ int32_t mz_zip_set_data_descriptor(void *handle, uint8_t data_descriptor) {
     return MZ_OK;
 }
 
+int32_t mz_zip_set_compress_threads(void *handle, int32_t compress_threads) {
+    mz_zip *zip = (mz_zip *)handle;
+    if (zip == NULL || compress_threads < 0)
+        return MZ_PARAM_ERROR;
+    zip->compress_threads = compress_threads;
+    return MZ_OK;
+}
+
+int32_t mz_zip_set_compress_job_size(void *handle, int64_t compress_job_size) {
+    mz_zip *zip = (mz_zip *)handle;
+    if (zip == NULL || compress_job_size < 0)
+        return MZ_PARAM_ERROR;
+    zip->compress_job_size = compress_job_size;
+    return MZ_OK;
+}
+
+int32_t mz_zip_set_buffer_size(void *handle, int32_t buffer_size) {
+    mz_zip *zip = (mz_zip *)handle;
+    if (zip == NULL || buffer_size < 0)
+        return MZ_PARAM_ERROR;
+    zip->buffer_size = buffer_size;
+    return MZ_OK;
+}
+
 int32_t mz_zip_get_stream(void *handle, void **stream) {
     mz_zip *zip = (mz_zip *)handle;
     if (zip == NULL || stream == NULL)
@@ -1599,9 +2183,13 @@ int32_t mz_zip_set_cd_stream(void *handle, int64_t cd_start_pos, void *cd_stream
     mz_zip *zip = (mz_zip *)handle;
     if (zip == NULL || cd_stream == NULL)
         return MZ_PARAM_ERROR;
+    if (zip->cd_shared)
+        return MZ_SUPPORT_ERROR;
     zip->cd_offset = 0;
     zip->cd_stream = cd_stream;
     zip->cd_start_pos = cd_start_pos;
+    mz_zip_name_index_reset(handle);
+    mz_zip_cd_index_reset(handle);
     return MZ_OK;
 }
 
@@ -1653,9 +2241,16 @@ static int32_t mz_zip_entry_close_int(void *handle) {
     if (zip->crypt_stream != NULL)
         mz_stream_delete(&zip->crypt_stream);
     zip->crypt_stream = NULL;
-    if (zip->compress_stream != NULL)
-        mz_stream_delete(&zip->compress_stream);
+    if (zip->compress_stream != NULL) {
+        /* Keep the closed stream and its codec state for the next entry with the same method */
+        if (!zip->entry_opened || zip->compress_method == 0 ||
+            mz_zip_codec_pool_put(handle, zip->compress_method, zip->compress_create, zip->compress_stream) != MZ_OK)
+            mz_stream_delete(&zip->compress_stream);
+    }
     zip->compress_stream = NULL;
+    zip->compress_method = 0;
+    zip->compress_flags = 0;
+    zip->compress_create = NULL;
 
     zip->entry_opened = 0;
 
@@ -1664,6 +2259,7 @@ static int32_t mz_zip_entry_close_int(void *handle) {
 
 static int32_t mz_zip_entry_open_int(void *handle, uint8_t raw, int16_t compress_level, const char *password) {
     mz_zip *zip = (mz_zip *)handle;
+    const mz_zip_method *method = NULL;
     int64_t max_total_in = 0;
     int64_t header_size = 0;
     int64_t footer_size = 0;
@@ -1673,25 +2269,10 @@ static int32_t mz_zip_entry_open_int(void *handle, uint8_t raw, int16_t compress
     if (zip == NULL)
         return MZ_PARAM_ERROR;
 
-    switch (zip->file_info.compression_method) {
-    case MZ_COMPRESS_METHOD_STORE:
-    case MZ_COMPRESS_METHOD_DEFLATE:
-#ifdef HAVE_BZIP2
-    case MZ_COMPRESS_METHOD_BZIP2:
-#endif
-#ifdef HAVE_LZMA
-    case MZ_COMPRESS_METHOD_LZMA:
-#endif
-#if defined(HAVE_LZMA) || defined(HAVE_LIBCOMP)
-    case MZ_COMPRESS_METHOD_XZ:
-#endif
-#ifdef HAVE_ZSTD
-    case MZ_COMPRESS_METHOD_ZSTD:
-#endif
-        err = MZ_OK;
-        break;
-    default:
-        return MZ_SUPPORT_ERROR;
+    if (zip->file_info.compression_method != MZ_COMPRESS_METHOD_STORE) {
+        method = mz_zip_method_find(zip->file_info.compression_method);
+        if (method == NULL)
+            return MZ_SUPPORT_ERROR;
     }
 
 #ifndef HAVE_WZAES
@@ -1719,6 +2300,9 @@ static int32_t mz_zip_entry_open_int(void *handle, uint8_t raw, int16_t compress
             mz_stream_wzaes_create(&zip->crypt_stream);
             mz_stream_wzaes_set_password(zip->crypt_stream, password);
             mz_stream_wzaes_set_encryption_mode(zip->crypt_stream, zip->file_info.aes_encryption_mode);
+            /* Authenticate on a helper thread when more than one thread per entry is allowed */
+            if (zip->compress_threads > 1)
+                mz_stream_set_prop_int64(zip->crypt_stream, MZ_STREAM_PROP_HMAC_THREAD, 1);
         } else
 #endif
         {
@@ -1736,50 +2320,37 @@ static int32_t mz_zip_entry_open_int(void *handle, uint8_t raw, int16_t compress
     if (err == MZ_OK) {
         if (zip->crypt_stream == NULL)
             mz_stream_raw_create(&zip->crypt_stream);
+        if (zip->buffer_size > 0)
+            mz_stream_set_prop_int64(zip->crypt_stream, MZ_STREAM_PROP_BUFFER_SIZE, zip->buffer_size);
 
         mz_stream_set_base(zip->crypt_stream, zip->stream);
 
         err = mz_stream_open(zip->crypt_stream, NULL, zip->open_mode);
     }
 
-    if (err == MZ_OK) {
-        if (zip->entry_raw || zip->file_info.compression_method == MZ_COMPRESS_METHOD_STORE)
-            mz_stream_raw_create(&zip->compress_stream);
-#ifdef HAVE_ZLIB
-        else if (zip->file_info.compression_method == MZ_COMPRESS_METHOD_DEFLATE)
-            mz_stream_zlib_create(&zip->compress_stream);
-#endif
-#ifdef HAVE_BZIP2
-        else if (zip->file_info.compression_method == MZ_COMPRESS_METHOD_BZIP2)
-            mz_stream_bzip_create(&zip->compress_stream);
-#endif
-#ifdef HAVE_LIBCOMP
-        else if (zip->file_info.compression_method == MZ_COMPRESS_METHOD_DEFLATE ||
-                 zip->file_info.compression_method == MZ_COMPRESS_METHOD_XZ) {
-            mz_stream_libcomp_create(&zip->compress_stream);
-            mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_COMPRESS_METHOD,
-                zip->file_info.compression_method);
-        }
-#endif
-#ifdef HAVE_LZMA
-        else if (zip->file_info.compression_method == MZ_COMPRESS_METHOD_LZMA ||
-                 zip->file_info.compression_method == MZ_COMPRESS_METHOD_XZ) {
-            mz_stream_lzma_create(&zip->compress_stream);
-            mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_COMPRESS_METHOD,
-                zip->file_info.compression_method);
+    if (err == MZ_OK && !zip->entry_raw && method != NULL) {
+        zip->compress_method = zip->file_info.compression_method;
+        zip->compress_flags = method->flags;
+        zip->compress_create = method->create;
+        zip->compress_stream = mz_zip_codec_pool_take(handle, zip->compress_method, method->create);
+
+        if (zip->compress_stream == NULL) {
+            method->create(&zip->compress_stream);
+            if (zip->compress_stream == NULL)
+                err = MZ_MEM_ERROR;
+            else
+                mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_COMPRESS_METHOD,
+                    zip->compress_method);
         }
-#endif
-#ifdef HAVE_ZSTD
-        else if (zip->file_info.compression_method == MZ_COMPRESS_METHOD_ZSTD)
-            mz_stream_zstd_create(&zip->compress_stream);
-#endif
-        else
-            err = MZ_PARAM_ERROR;
     }
 
+    if (err == MZ_OK && zip->compress_stream == NULL)
+        mz_stream_raw_create(&zip->compress_stream);
+
     if (err == MZ_OK) {
         if (zip->open_mode & MZ_OPEN_MODE_WRITE) {
             mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_COMPRESS_LEVEL, compress_level);
+            mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_COMPRESS_JOB_SIZE, zip->compress_job_size);
         } else {
             int32_t set_end_of_stream = 0;
 
@@ -1816,6 +2387,11 @@ static int32_t mz_zip_entry_open_int(void *handle, uint8_t raw, int16_t compress
             }
         }
 
+        if (zip->compress_flags & MZ_COMPRESS_FLAG_THREADS)
+            mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_COMPRESS_THREADS, zip->compress_threads);
+        if (zip->buffer_size > 0)
+            mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_BUFFER_SIZE, zip->buffer_size);
+
         mz_stream_set_base(zip->compress_stream, zip->crypt_stream);
 
         err = mz_stream_open(zip->compress_stream, NULL, zip->open_mode);
@@ -2015,7 +2591,8 @@ int32_t mz_zip_entry_read(void *handle, void *buf, int32_t len) {
     /* Read entire entry even if uncompressed_size = 0, otherwise */
     /* aes encryption validation will fail if compressed_size > 0 */
     read = mz_stream_read(zip->compress_stream, buf, len);
-    if (read > 0)
+    /* Crc of raw data is never compared against the entry crc */
+    if (read > 0 && !zip->entry_raw)
         zip->entry_crc32 = mz_crypt_crc32_update(zip->entry_crc32, buf, read);
 
     mz_zip_print("Zip - Entry - Read - %" PRId32 " (max %" PRId32 ")\n", read, len);
@@ -2023,6 +2600,60 @@ int32_t mz_zip_entry_read(void *handle, void *buf, int32_t len) {
     return read;
 }
 
+int32_t mz_zip_entry_read_buffer(void *handle, void *buf, int64_t len) {
+    mz_zip *zip = (mz_zip *)handle;
+    int64_t total_in = 0;
+    int64_t max_total_in = 0;
+    int64_t header_size = 0;
+    int64_t footer_size = 0;
+    int64_t total = 0;
+    int32_t max_read = INT32_MAX;
+    int32_t read = 0;
+    uint8_t extra = 0;
+
+    if (zip == NULL || mz_zip_entry_is_open(handle) != MZ_OK || buf == NULL || len < 0)
+        return MZ_PARAM_ERROR;
+    if (UINT_MAX == UINT16_MAX) /* zlib limitation */
+        max_read = UINT16_MAX;
+
+    /* Let the compression stream decode the entire entry in one call if it can */
+    mz_stream_get_prop_int64(zip->compress_stream, MZ_STREAM_PROP_TOTAL_IN, &total_in);
+    if ((zip->compress_flags & MZ_COMPRESS_FLAG_ONE_SHOT) &&
+        total_in == 0 && len == zip->file_info.uncompressed_size && len <= max_read &&
+        zip->file_info.compressed_size > 0 && zip->file_info.compressed_size <= INT32_MAX) {
+        max_total_in = zip->file_info.compressed_size;
+        if (mz_stream_get_prop_int64(zip->crypt_stream, MZ_STREAM_PROP_HEADER_SIZE, &header_size) == MZ_OK)
+            max_total_in -= header_size;
+        if (mz_stream_get_prop_int64(zip->crypt_stream, MZ_STREAM_PROP_FOOTER_SIZE, &footer_size) == MZ_OK)
+            max_total_in -= footer_size;
+
+        mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_TOTAL_IN_MAX, max_total_in);
+        mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_TOTAL_OUT_MAX, len);
+        mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_READ_ALL, 1);
+    }
+
+    while (total < len) {
+        read = max_read;
+        if ((int64_t)read > len - total)
+            read = (int32_t)(len - total);
+        read = mz_zip_entry_read(handle, (uint8_t *)buf + total, read);
+        if (read < 0)
+            return read;
+        if (read == 0)
+            return MZ_DATA_ERROR;
+        total += read;
+    }
+
+    /* Entry must not have more data than fits in the buffer */
+    read = mz_zip_entry_read(handle, &extra, 1);
+    if (read < 0)
+        return read;
+    if (read > 0)
+        return MZ_BUF_ERROR;
+
+    return MZ_OK;
+}
+
 int32_t mz_zip_entry_write(void *handle, const void *buf, int32_t len) {
     mz_zip *zip = (mz_zip *)handle;
     int32_t written = 0;
@@ -2030,7 +2661,8 @@ int32_t mz_zip_entry_write(void *handle, const void *buf, int32_t len) {
     if (zip == NULL || mz_zip_entry_is_open(handle) != MZ_OK)
         return MZ_PARAM_ERROR;
     written = mz_stream_write(zip->compress_stream, buf, len);
-    if (written > 0)
+    /* Crc passed to mz_zip_entry_write_close is used for raw data instead */
+    if (written > 0 && !zip->entry_raw)
         zip->entry_crc32 = mz_crypt_crc32_update(zip->entry_crc32, buf, written);
 
     mz_zip_print("Zip - Entry - Write - %" PRId32 " (max %" PRId32 ")\n", written, len);
@@ -2038,6 +2670,38 @@ int32_t mz_zip_entry_write(void *handle, const void *buf, int32_t len) {
     return written;
 }
 
+int32_t mz_zip_entry_write_buffer(void *handle, const void *buf, int64_t len) {
+    mz_zip *zip = (mz_zip *)handle;
+    int64_t total_in = 0;
+    int64_t total = 0;
+    int32_t max_write = INT32_MAX;
+    int32_t written = 0;
+
+    if (zip == NULL || mz_zip_entry_is_open(handle) != MZ_OK || buf == NULL || len < 0)
+        return MZ_PARAM_ERROR;
+    if (UINT_MAX == UINT16_MAX) /* zlib limitation */
+        max_write = UINT16_MAX;
+
+    /* Let the compression stream encode the entire entry in one call if it can */
+    mz_stream_get_prop_int64(zip->compress_stream, MZ_STREAM_PROP_TOTAL_IN, &total_in);
+    if ((zip->compress_flags & MZ_COMPRESS_FLAG_ONE_SHOT) && total_in == 0 && len > 0 && len <= max_write)
+        mz_stream_set_prop_int64(zip->compress_stream, MZ_STREAM_PROP_TOTAL_IN_MAX, len);
+
+    while (total < len) {
+        written = max_write;
+        if ((int64_t)written > len - total)
+            written = (int32_t)(len - total);
+        written = mz_zip_entry_write(handle, (const uint8_t *)buf + total, written);
+        if (written < 0)
+            return written;
+        if (written == 0)
+            return MZ_WRITE_ERROR;
+        total += written;
+    }
+
+    return MZ_OK;
+}
+
 int32_t mz_zip_entry_read_close(void *handle, uint32_t *crc32, int64_t *compressed_size,
     int64_t *uncompressed_size) {
     mz_zip *zip = (mz_zip *)handle;
@@ -2337,11 +3001,22 @@ static int32_t mz_zip_goto_next_entry_int(void *handle) {
 
     zip->entry_scanned = 0;
 
-    mz_stream_set_prop_int64(zip->cd_stream, MZ_STREAM_PROP_DISK_NUMBER, -1);
+    if ((zip->cd_index) && (!zip->cd_index_loaded) && ((zip->open_mode & MZ_OPEN_MODE_WRITE) == 0)) {
+        /* Fallback to reading the central dir stream if the index can't be built */
+        if (mz_zip_cd_index_build(handle) != MZ_OK)
+            zip->cd_index = 0;
+    }
 
-    err = mz_stream_seek(zip->cd_stream, zip->cd_current_pos, MZ_SEEK_SET);
-    if (err == MZ_OK)
-        err = mz_zip_entry_read_header(zip->cd_stream, 0, &zip->file_info, zip->file_info_stream);
+    if (zip->cd_index_loaded) {
+        err = mz_zip_cd_index_goto(handle);
+        if (err != MZ_EXIST_ERROR)
+            return err;
+        /* Shared index has every entry so the position is not the start of an entry */
+        if (zip->cd_shared)
+            return MZ_FORMAT_ERROR;
+    }
+
+    err = mz_zip_read_cd_entry(handle);
     if (err == MZ_OK)
         zip->entry_scanned = 1;
     return err;
@@ -2393,6 +3068,73 @@ int32_t mz_zip_goto_next_entry(void *handle) {
     return mz_zip_goto_next_entry_int(handle);
 }
 
+static int32_t mz_zip_name_index_scan(void *handle, const char *filename, uint8_t ignore_case) {
+    mz_zip *zip = (mz_zip *)handle;
+    int64_t cd_pos = 0;
+    int32_t err = MZ_OK;
+
+    if (zip->name_index_done)
+        return MZ_END_OF_LIST;
+
+    if (zip->name_index == NULL)
+        zip->name_index_pos = zip->cd_start_pos;
+
+    zip->cd_current_pos = zip->name_index_pos;
+
+    /* Add entries to the index until one matches filename, or all entries if filename is NULL */
+    err = mz_zip_goto_next_entry_int(handle);
+    while (err == MZ_OK) {
+        cd_pos = zip->cd_current_pos;
+
+        err = mz_zip_name_index_insert(handle, mz_zip_name_hash(zip->file_info.filename), cd_pos);
+        if (err != MZ_OK)
+            return err;
+
+        zip->name_index_pos = cd_pos + MZ_ZIP_SIZE_CD_ITEM + zip->file_info.filename_size +
+            zip->file_info.extrafield_size + zip->file_info.comment_size;
+
+        if ((filename != NULL) && (mz_zip_path_compare(zip->file_info.filename, filename, ignore_case) == 0))
+            return MZ_OK;
+
+        err = mz_zip_goto_next_entry(handle);
+    }
+
+    if (err == MZ_END_OF_LIST)
+        zip->name_index_done = 1;
+    return err;
+}
+
+static int32_t mz_zip_locate_entry_indexed(void *handle, const char *filename, uint8_t ignore_case) {
+    mz_zip *zip = (mz_zip *)handle;
+    uint32_t hash = mz_zip_name_hash(filename);
+    uint32_t mask = 0;
+    uint32_t slot = 0;
+    int32_t err = MZ_OK;
+
+    /* Probe entries that have already been indexed */
+    if (zip->name_index != NULL) {
+        mask = zip->name_index_size - 1;
+        for (slot = hash & mask; zip->name_index[slot].cd_pos >= 0; slot = (slot + 1) & mask) {
+            if (zip->name_index[slot].hash != hash)
+                continue;
+            zip->cd_current_pos = zip->name_index[slot].cd_pos;
+            err = mz_zip_goto_next_entry_int(handle);
+            if (err != MZ_OK)
+                return err;
+            if (mz_zip_path_compare(zip->file_info.filename, filename, ignore_case) == 0)
+                return MZ_OK;
+        }
+    }
+
+    /* Continue scanning the remaining entries, adding each to the index */
+    err = mz_zip_name_index_scan(handle, filename, ignore_case);
+    if (err != MZ_END_OF_LIST)
+        return err;
+
+    zip->entry_scanned = 0;
+    return MZ_END_OF_LIST;
+}
+
 int32_t mz_zip_locate_entry(void *handle, const char *filename, uint8_t ignore_case) {
     mz_zip *zip = (mz_zip *)handle;
     int32_t err = MZ_OK;
@@ -2408,6 +3150,10 @@ int32_t mz_zip_locate_entry(void *handle, const char *filename, uint8_t ignore_c
             return MZ_OK;
     }
 
+    /* Central directory can't change while reading, so use the name index */
+    if ((zip->open_mode & MZ_OPEN_MODE_WRITE) == 0)
+        return mz_zip_locate_entry_indexed(handle, filename, ignore_case);
+
     /* Search all entries starting at the first */
     err = mz_zip_goto_first_entry(handle);
     while (err == MZ_OK) {
@@ -2458,6 +3204,93 @@ int32_t mz_zip_locate_next_entry(void *handle, void *userdata, mz_zip_locate_ent
 
 /***************************************************************************/
 
+static int32_t mz_zip_share(void *handle) {
+    mz_zip *zip = (mz_zip *)handle;
+    int64_t cd_current_pos = zip->cd_current_pos;
+    uint8_t entry_scanned = zip->entry_scanned;
+    int32_t err = MZ_OK;
+
+    if (zip->cd_shared || (zip->cd_index_loaded && zip->name_index_done))
+        return MZ_OK;
+
+    /* Decode every entry and name up front so the central dir is never modified while shared */
+    if (!zip->cd_index_loaded) {
+        err = mz_zip_cd_index_build(handle);
+        if (err != MZ_OK)
+            return err;
+    }
+
+    err = mz_zip_name_index_scan(handle, NULL, 0);
+    if (err == MZ_END_OF_LIST)
+        err = MZ_OK;
+
+    zip->cd_current_pos = cd_current_pos;
+    zip->entry_scanned = 0;
+    if ((err == MZ_OK) && (entry_scanned))
+        err = mz_zip_goto_next_entry_int(handle);
+    return err;
+}
+
+int32_t mz_zip_open_cursor(void *handle, void *shared_handle, void *stream) {
+    mz_zip *zip = (mz_zip *)handle;
+    mz_zip *shared = (mz_zip *)shared_handle;
+    int32_t err = MZ_OK;
+
+    if (zip == NULL || shared == NULL || stream == NULL)
+        return MZ_PARAM_ERROR;
+    if ((shared->stream == NULL) || (shared->open_mode & MZ_OPEN_MODE_WRITE))
+        return MZ_PARAM_ERROR;
+
+    mz_zip_print("Zip - Open cursor\n");
+
+    err = mz_zip_share(shared);
+    if (err != MZ_OK)
+        return err;
+
+    zip->stream = stream;
+    zip->cd_stream = stream;
+
+    zip->disk_number_with_cd = shared->disk_number_with_cd;
+    zip->disk_offset_shift = shared->disk_offset_shift;
+    zip->cd_start_pos = shared->cd_start_pos;
+    zip->cd_current_pos = shared->cd_start_pos;
+    zip->cd_offset = shared->cd_offset;
+    zip->cd_size = shared->cd_size;
+    zip->cd_signature = shared->cd_signature;
+    zip->number_entry = shared->number_entry;
+    zip->version_madeby = shared->version_madeby;
+    zip->comment = shared->comment;
+
+    /* Central dir data is read-only once shared so cursors don't need to lock */
+    zip->name_index = shared->name_index;
+    zip->name_index_size = shared->name_index_size;
+    zip->name_index_count = shared->name_index_count;
+    zip->name_index_pos = shared->name_index_pos;
+    zip->name_index_done = 1;
+
+    zip->cd_index = 1;
+    zip->cd_index_entries = shared->cd_index_entries;
+    zip->cd_index_pos = shared->cd_index_pos;
+    zip->cd_index_count = shared->cd_index_count;
+    zip->cd_index_current = 0;
+    zip->cd_index_end_pos = shared->cd_index_end_pos;
+    zip->cd_index_end_err = shared->cd_index_end_err;
+    zip->cd_index_loaded = 1;
+    zip->cd_shared = 1;
+
+    mz_stream_mem_create(&zip->file_info_stream);
+    mz_stream_mem_open(zip->file_info_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_stream_mem_create(&zip->local_file_info_stream);
+    mz_stream_mem_open(zip->local_file_info_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    zip->open_mode = MZ_OPEN_MODE_READ;
+
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
 int32_t mz_zip_attrib_is_dir(uint32_t attrib, int32_t version_madeby) {
     uint32_t posix_attrib = 0;
     uint8_t system = MZ_HOST_SYSTEM(version_madeby);
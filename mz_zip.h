@@ -71,6 +71,10 @@ int32_t mz_zip_open(void *handle, void *stream, int32_t mode);
 int32_t mz_zip_close(void *handle);
 /* Close the zip file */
 
+int32_t mz_zip_open_cursor(void *handle, void *shared_handle, void *stream);
+/* Open a cursor for reading entries of a zip file already opened for reading by another handle,
+   the shared handle must stay open until all of its cursors are closed */
+
 int32_t mz_zip_get_comment(void *handle, const char **comment);
 /* Get a pointer to the global comment */
 
@@ -86,9 +90,24 @@ int32_t mz_zip_set_version_madeby(void *handle, uint16_t version_madeby);
 int32_t mz_zip_set_recover(void *handle, uint8_t recover);
 /* Sets the ability to recover the central dir by reading local file headers */
 
+int32_t mz_zip_set_cd_index(void *handle, uint8_t cd_index);
+/* Sets the ability to decode the central dir into an index of entries when reading */
+
+int32_t mz_zip_set_cd_in_memory(void *handle, uint8_t cd_in_memory);
+/* Sets the ability to load the central dir into memory with a single read when reading */
+
 int32_t mz_zip_set_data_descriptor(void *handle, uint8_t data_descriptor);
 /* Sets the use of data descriptor flag when writing zip entries */
 
+int32_t mz_zip_set_compress_threads(void *handle, int32_t compress_threads);
+/* Sets the number of threads used to compress or decompress a single entry when supported by the method */
+
+int32_t mz_zip_set_compress_job_size(void *handle, int64_t compress_job_size);
+/* Sets the amount of data each thread compresses at a time when compressing with threads */
+
+int32_t mz_zip_set_buffer_size(void *handle, int32_t buffer_size);
+/* Sets the size of the buffers used by compression and encryption streams for each entry */
+
 int32_t mz_zip_get_stream(void *handle, void **stream);
 /* Get a pointer to the stream used to open */
 
@@ -121,6 +140,9 @@ int32_t mz_zip_entry_read_open(void *handle, uint8_t raw, const char *password);
 int32_t mz_zip_entry_read(void *handle, void *buf, int32_t len);
 /* Read bytes from the current file in the zip file */
 
+int32_t mz_zip_entry_read_buffer(void *handle, void *buf, int64_t len);
+/* Read the whole current file in the zip file into a buffer of its uncompressed size */
+
 int32_t mz_zip_entry_read_close(void *handle, uint32_t *crc32, int64_t *compressed_size,
     int64_t *uncompressed_size);
 /* Close the current file for reading and get data descriptor values */
@@ -132,6 +154,9 @@ int32_t mz_zip_entry_write_open(void *handle, const mz_zip_file *file_info,
 int32_t mz_zip_entry_write(void *handle, const void *buf, int32_t len);
 /* Write bytes from the current file in the zip file */
 
+int32_t mz_zip_entry_write_buffer(void *handle, const void *buf, int64_t len);
+/* Write the whole current file in the zip file from a buffer */
+
 int32_t mz_zip_entry_write_close(void *handle, uint32_t crc32, int64_t compressed_size,
     int64_t uncompressed_size);
 /* Close the current file for writing and set data descriptor values */
@@ -206,6 +231,14 @@ int32_t mz_zip_attrib_win32_to_posix(uint32_t win32_attrib, uint32_t *posix_attr
 
 /***************************************************************************/
 
+int32_t mz_zip_register_method(uint16_t compression_method, mz_stream_create_cb create, int32_t flags);
+/* Registers the stream used for a compression method, NULL restores the built-in stream */
+
+int32_t mz_zip_get_method(uint16_t compression_method, mz_stream_create_cb *create, int32_t *flags);
+/* Gets the stream and MZ_COMPRESS_FLAG capabilities used for a compression method */
+
+/***************************************************************************/
+
 int32_t mz_zip_extrafield_find(void *stream, uint16_t type, int32_t max_seek, uint16_t *length);
 /* Seeks to extra field by its type and returns its length */
 
@@ -12,8 +12,13 @@
 #include "mz_crypt.h"
 #include "mz_os.h"
 #include "mz_strm.h"
+#include "mz_strm_async.h"
 #include "mz_strm_buf.h"
+#ifndef _WIN32
+#  include "mz_strm_fd.h"
+#endif
 #include "mz_strm_mem.h"
+#include "mz_strm_mmap.h"
 #include "mz_strm_os.h"
 #include "mz_strm_split.h"
 #include "mz_strm_wzaes.h"
@@ -27,11 +32,15 @@
 
 #define MZ_ZIP_CD_FILENAME              ("__cdcd__")
 
+#define MZ_ZIP_WRITER_THREAD_MAX_SIZE   (16 * 1024 * 1024)
+#define MZ_ZIP_WRITER_COPY_MIN_SIZE     (256 * 1024)
+
 /***************************************************************************/
 
 typedef struct mz_zip_reader_s {
     void        *zip_handle;
     void        *file_stream;
+    void        *async_stream;
     void        *buffered_stream;
     void        *split_stream;
     void        *mem_stream;
@@ -56,17 +65,33 @@ typedef struct mz_zip_reader_s {
     mz_zip_reader_entry_cb
                 entry_cb;
     uint8_t     raw;
-    uint8_t     buffer[UINT16_MAX];
+    uint8_t     *buffer;
+    int32_t     buffer_size;
     int32_t     encoding;
     uint8_t     sign_required;
     uint8_t     cd_verified;
     uint8_t     cd_zipped;
     uint8_t     entry_verified;
     uint8_t     recover;
+    uint8_t     cd_index;
+    uint8_t     cd_in_memory;
+    uint8_t     mmap_file;
+    uint8_t     zero_copy;
+    uint8_t     zero_copy_verify;
+    uint32_t    zero_copy_crc32;
+    int32_t     thread_count;
 } mz_zip_reader;
 
 /***************************************************************************/
 
+static int32_t mz_zip_reader_get_chunk_size(mz_zip_reader *reader) {
+    if (reader->buffer_size > 0)
+        return reader->buffer_size;
+    return UINT16_MAX;
+}
+
+/***************************************************************************/
+
 int32_t mz_zip_reader_is_open(void *handle) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
     if (reader == NULL)
@@ -85,6 +110,8 @@ int32_t mz_zip_reader_open(void *handle, void *stream) {
 
     mz_zip_create(&reader->zip_handle);
     mz_zip_set_recover(reader->zip_handle, reader->recover);
+    mz_zip_set_cd_index(reader->zip_handle, reader->cd_index);
+    mz_zip_set_cd_in_memory(reader->zip_handle, reader->cd_in_memory);
 
     err = mz_zip_open(reader->zip_handle, stream, MZ_OPEN_MODE_READ);
 
@@ -104,12 +131,33 @@ int32_t mz_zip_reader_open_file(void *handle, const char *path) {
 
     mz_zip_reader_close(handle);
 
-    mz_stream_os_create(&reader->file_stream);
-    mz_stream_buffered_create(&reader->buffered_stream);
     mz_stream_split_create(&reader->split_stream);
 
-    mz_stream_set_base(reader->buffered_stream, reader->file_stream);
-    mz_stream_set_base(reader->split_stream, reader->buffered_stream);
+    if (reader->mmap_file) {
+        /* Reads are served from the mapping so no buffering is necessary */
+        mz_stream_mmap_create(&reader->file_stream);
+        mz_stream_set_base(reader->split_stream, reader->file_stream);
+    } else {
+#ifdef _WIN32
+        mz_stream_os_create(&reader->file_stream);
+#else
+        /* Positional reads avoid stdio buffering beneath the buffered stream */
+        mz_stream_fd_create(&reader->file_stream);
+#endif
+        mz_stream_buffered_create(&reader->buffered_stream);
+        if (reader->buffer_size > 0)
+            mz_stream_set_prop_int64(reader->buffered_stream, MZ_STREAM_PROP_BUFFER_SIZE, reader->buffer_size);
+
+        if (reader->thread_count > 1) {
+            /* File is read ahead on a thread while entries are decompressed */
+            mz_stream_async_create(&reader->async_stream);
+            mz_stream_set_base(reader->async_stream, reader->file_stream);
+            mz_stream_set_base(reader->buffered_stream, reader->async_stream);
+        } else {
+            mz_stream_set_base(reader->buffered_stream, reader->file_stream);
+        }
+        mz_stream_set_base(reader->split_stream, reader->buffered_stream);
+    }
 
     err = mz_stream_open(reader->split_stream, path, MZ_OPEN_MODE_READ);
     if (err == MZ_OK)
@@ -190,6 +238,73 @@ int32_t mz_zip_reader_open_buffer(void *handle, uint8_t *buf, int32_t len, uint8
     return err;
 }
 
+int32_t mz_zip_reader_open_cursor(void *handle, void *shared_handle) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    mz_zip_reader *shared = (mz_zip_reader *)shared_handle;
+    const void *buf = NULL;
+    void *stream = NULL;
+    uint32_t disk_number_with_cd = 0;
+    int32_t buf_length = 0;
+    int32_t err = MZ_OK;
+
+
+    if (reader == NULL || shared == NULL || shared->zip_handle == NULL || reader == shared)
+        return MZ_PARAM_ERROR;
+
+    mz_zip_reader_close(handle);
+
+    /* Cursors read through their own stream which can't switch between disks */
+    mz_zip_get_disk_number_with_cd(shared->zip_handle, &disk_number_with_cd);
+    if (disk_number_with_cd > 0)
+        return MZ_SUPPORT_ERROR;
+
+    if (shared->mem_stream != NULL) {
+        mz_stream_mem_get_buffer(shared->mem_stream, &buf);
+        mz_stream_mem_get_buffer_length(shared->mem_stream, &buf_length);
+
+        mz_stream_mem_create(&reader->mem_stream);
+        mz_stream_mem_open(reader->mem_stream, NULL, MZ_OPEN_MODE_READ);
+        mz_stream_mem_set_buffer(reader->mem_stream, (void *)buf, buf_length);
+        stream = reader->mem_stream;
+    } else if ((shared->file_stream != NULL) &&
+               (((mz_stream *)shared->file_stream)->vtbl == mz_stream_mmap_get_interface())) {
+        mz_stream_mmap_create(&reader->file_stream);
+        err = mz_stream_mmap_attach(reader->file_stream, shared->file_stream);
+        stream = reader->file_stream;
+#ifndef _WIN32
+    } else if ((shared->file_stream != NULL) &&
+               (((mz_stream *)shared->file_stream)->vtbl == mz_stream_fd_get_interface())) {
+        /* Positional reads let each cursor use the same file descriptor without locking */
+        mz_stream_fd_create(&reader->file_stream);
+        mz_stream_buffered_create(&reader->buffered_stream);
+        if (reader->buffer_size > 0)
+            mz_stream_set_prop_int64(reader->buffered_stream, MZ_STREAM_PROP_BUFFER_SIZE, reader->buffer_size);
+        mz_stream_set_base(reader->buffered_stream, reader->file_stream);
+
+        err = mz_stream_fd_attach(reader->file_stream, shared->file_stream);
+        stream = reader->buffered_stream;
+#endif
+    } else {
+        return MZ_SUPPORT_ERROR;
+    }
+
+    if (err == MZ_OK) {
+        reader->cd_verified = shared->cd_verified;
+        reader->cd_zipped = shared->cd_zipped;
+
+        mz_zip_create(&reader->zip_handle);
+        err = mz_zip_open_cursor(reader->zip_handle, shared->zip_handle, stream);
+    }
+
+    if (err != MZ_OK) {
+        mz_zip_reader_close(handle);
+        return err;
+    }
+
+    mz_zip_reader_goto_first_entry(handle);
+    return MZ_OK;
+}
+
 int32_t mz_zip_reader_close(void *handle) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
     int32_t err = MZ_OK;
@@ -204,17 +319,32 @@ int32_t mz_zip_reader_close(void *handle) {
         mz_stream_split_delete(&reader->split_stream);
     }
 
-    if (reader->buffered_stream != NULL)
+    if (reader->buffered_stream != NULL) {
+        mz_stream_buffered_close(reader->buffered_stream);
         mz_stream_buffered_delete(&reader->buffered_stream);
+    }
 
-    if (reader->file_stream != NULL)
-        mz_stream_os_delete(&reader->file_stream);
+    if (reader->async_stream != NULL) {
+        mz_stream_async_close(reader->async_stream);
+        mz_stream_async_delete(&reader->async_stream);
+    }
+
+    if (reader->file_stream != NULL) {
+        mz_stream_close(reader->file_stream);
+        mz_stream_delete(&reader->file_stream);
+    }
 
     if (reader->mem_stream != NULL) {
         mz_stream_close(reader->mem_stream);
         mz_stream_delete(&reader->mem_stream);
     }
 
+#ifndef MZ_ZIP_NO_CRYPTO
+    /* Entry may have been left open after an error */
+    if (reader->hash != NULL)
+        mz_crypt_sha_delete(&reader->hash);
+#endif
+
     return err;
 }
 
@@ -381,6 +511,10 @@ int32_t mz_zip_reader_entry_open(void *handle) {
         password = password_buf;
     }
 
+    /* Entries read directly by this reader can still be decompressed by multiple threads */
+    mz_zip_set_compress_threads(reader->zip_handle, reader->thread_count);
+    mz_zip_set_buffer_size(reader->zip_handle, reader->buffer_size);
+
     err = mz_zip_entry_read_open(reader->zip_handle, reader->raw, password);
 #ifndef MZ_ZIP_NO_CRYPTO
     if (err != MZ_OK)
@@ -612,8 +746,14 @@ int32_t mz_zip_reader_entry_save_process(void *handle, void *stream, mz_stream_w
     if (err != MZ_OK)
         return err;
 
+    if (reader->buffer == NULL) {
+        reader->buffer = (uint8_t *)MZ_ALLOC(mz_zip_reader_get_chunk_size(reader));
+        if (reader->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
     /* Unzip entry in zip file */
-    read = mz_zip_reader_entry_read(handle, reader->buffer, sizeof(reader->buffer));
+    read = mz_zip_reader_entry_read(handle, reader->buffer, mz_zip_reader_get_chunk_size(reader));
 
     if (read == 0) {
         /* If we are done close the entry */
@@ -680,6 +820,112 @@ int32_t mz_zip_reader_entry_save(void *handle, void *stream, mz_stream_write_cb
     return err;
 }
 
+#ifndef _WIN32
+static int32_t mz_zip_reader_entry_verify_cb(void *handle, const void *buf, int32_t size) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    reader->zero_copy_crc32 = mz_crypt_crc32_update(reader->zero_copy_crc32, (const uint8_t *)buf, size);
+#ifndef MZ_ZIP_NO_CRYPTO
+    if (reader->hash != NULL)
+        mz_crypt_sha_update(reader->hash, buf, size);
+#endif
+    return size;
+}
+
+static int32_t mz_zip_reader_entry_save_copy(void *handle, const char *path) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    void *zip_stream = NULL;
+    void *source_stream = NULL;
+    void *target_stream = NULL;
+    uint32_t disk_number_with_cd = 0;
+    int64_t data_pos = 0;
+    int64_t size = reader->file_info->compressed_size;
+    int32_t err = MZ_OK;
+    int32_t err_close = MZ_OK;
+    uint8_t verify = reader->zero_copy_verify || reader->sign_required;
+
+    /* Only unencrypted stored entries in a single zip file can be copied as is */
+    if (!reader->zero_copy || reader->file_stream == NULL ||
+        ((mz_stream *)reader->file_stream)->vtbl != mz_stream_fd_get_interface())
+        return MZ_SUPPORT_ERROR;
+    if ((reader->file_info->compression_method != MZ_COMPRESS_METHOD_STORE) ||
+        (reader->file_info->flag & MZ_ZIP_FLAG_ENCRYPTED) ||
+        (reader->file_info->compressed_size != reader->file_info->uncompressed_size))
+        return MZ_SUPPORT_ERROR;
+    mz_zip_get_disk_number_with_cd(reader->zip_handle, &disk_number_with_cd);
+    if ((disk_number_with_cd > 0) || (reader->file_info->disk_number > 0))
+        return MZ_SUPPORT_ERROR;
+    if (mz_zip_entry_is_open(reader->zip_handle) == MZ_OK)
+        return MZ_SUPPORT_ERROR;
+
+    /* Update the progress at the beginning */
+    if (reader->progress_cb != NULL)
+        reader->progress_cb(handle, reader->progress_userdata, reader->file_info, 0);
+
+    err = mz_zip_reader_entry_open(handle);
+    if (err != MZ_OK)
+        return err;
+
+    /* Entry data starts where reading the local header left the zip stream */
+    err = mz_zip_get_stream(reader->zip_handle, &zip_stream);
+    if (err == MZ_OK) {
+        data_pos = mz_stream_tell(zip_stream);
+        if (data_pos < 0)
+            err = MZ_TELL_ERROR;
+    }
+
+    mz_stream_fd_create(&target_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_open(target_stream, path, MZ_OPEN_MODE_CREATE);
+
+    /* Copy with a separate cursor so the position of the zip stream is left alone */
+    mz_stream_fd_create(&source_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_attach(source_stream, reader->file_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(source_stream, data_pos, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = mz_stream_fd_copy(target_stream, source_stream, size);
+
+    if (err == MZ_SUPPORT_ERROR) {
+        /* Kernel is unable to copy between the files so copy through the read buffer */
+        err = mz_zip_reader_entry_save(handle, target_stream, mz_stream_write);
+    } else {
+        if (err == MZ_OK && verify) {
+            /* Verify the data in the page cache through a mapping instead of reading it back */
+            reader->zero_copy_crc32 = 0;
+            err = mz_stream_fd_seek(source_stream, data_pos, MZ_SEEK_SET);
+            if (err == MZ_OK)
+                err = mz_stream_fd_map_process(source_stream, size, reader, mz_zip_reader_entry_verify_cb);
+            if (err == MZ_OK && reader->zero_copy_crc32 != reader->file_info->crc)
+                err = MZ_CRC_ERROR;
+        }
+#ifndef MZ_ZIP_NO_CRYPTO
+        else if (reader->hash != NULL) {
+            /* Hash was never computed so there is nothing to compare when closing */
+            mz_crypt_sha_delete(&reader->hash);
+        }
+#endif
+
+        err_close = mz_zip_reader_entry_close(handle);
+        if (err == MZ_OK)
+            err = err_close;
+
+        /* Update the progress at the end */
+        if (err == MZ_OK && reader->progress_cb != NULL)
+            reader->progress_cb(handle, reader->progress_userdata, reader->file_info, size);
+    }
+
+    mz_stream_fd_delete(&source_stream);
+
+    err_close = mz_stream_fd_close(target_stream);
+    if (err == MZ_OK)
+        err = err_close;
+    mz_stream_fd_delete(&target_stream);
+
+    return err;
+}
+#endif
+
 int32_t mz_zip_reader_entry_save_file(void *handle, const char *path) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
     void *stream = NULL;
@@ -743,15 +989,22 @@ int32_t mz_zip_reader_entry_save_file(void *handle, const char *path) {
         return err;
     }
 
-    /* Create the file on disk so we can save to it */
-    mz_stream_os_create(&stream);
-    err = mz_stream_os_open(stream, pathwfs, MZ_OPEN_MODE_CREATE);
+    err = MZ_SUPPORT_ERROR;
+#ifndef _WIN32
+    /* Stored entries can be copied from the zip file without leaving the kernel */
+    err = mz_zip_reader_entry_save_copy(handle, pathwfs);
+#endif
+    if (err == MZ_SUPPORT_ERROR) {
+        /* Create the file on disk so we can save to it */
+        mz_stream_os_create(&stream);
+        err = mz_stream_os_open(stream, pathwfs, MZ_OPEN_MODE_CREATE);
 
-    if (err == MZ_OK)
-        err = mz_zip_reader_entry_save(handle, stream, mz_stream_write);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save(handle, stream, mz_stream_write);
 
-    mz_stream_close(stream);
-    mz_stream_delete(&stream);
+        mz_stream_close(stream);
+        mz_stream_delete(&stream);
+    }
 
     if (err == MZ_OK) {
         /* Set the time of the file that has been created */
@@ -773,8 +1026,6 @@ int32_t mz_zip_reader_entry_save_file(void *handle, const char *path) {
 
 int32_t mz_zip_reader_entry_save_buffer(void *handle, void *buf, int32_t len) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    void *mem_stream = NULL;
-    int32_t err = MZ_OK;
 
     if (mz_zip_reader_is_open(reader) != MZ_OK)
         return MZ_PARAM_ERROR;
@@ -785,15 +1036,57 @@ int32_t mz_zip_reader_entry_save_buffer(void *handle, void *buf, int32_t len) {
     if (len != (int32_t)reader->file_info->uncompressed_size)
         return MZ_BUF_ERROR;
 
-    /* Create a memory stream backed by our buffer and save to it */
-    mz_stream_mem_create(&mem_stream);
-    mz_stream_mem_set_buffer(mem_stream, buf, len);
+    return mz_zip_reader_entry_save_buffer64(handle, buf, len);
+}
 
-    err = mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_READ);
-    if (err == MZ_OK)
-        err = mz_zip_reader_entry_save(handle, mem_stream, mz_stream_mem_write);
+int32_t mz_zip_reader_entry_save_buffer64(void *handle, void *buf, int64_t len) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    int32_t err = MZ_OK;
+#ifndef MZ_ZIP_NO_CRYPTO
+    int64_t hashed = 0;
+    int32_t chunk = 0;
+#endif
+
+    if (mz_zip_reader_is_open(reader) != MZ_OK)
+        return MZ_PARAM_ERROR;
+    if (reader->file_info == NULL || buf == NULL)
+        return MZ_PARAM_ERROR;
+    if (len != reader->file_info->uncompressed_size || (int64_t)(size_t)len != len)
+        return MZ_BUF_ERROR;
+
+    /* Update the progress at the beginning */
+    if (reader->progress_cb != NULL)
+        reader->progress_cb(handle, reader->progress_userdata, reader->file_info, 0);
+
+    /* If the entry isn't open for reading, open it */
+    if (mz_zip_entry_is_open(reader->zip_handle) != MZ_OK)
+        err = mz_zip_reader_entry_open(handle);
+    if (err != MZ_OK)
+        return err;
+
+    /* Decompress straight into the caller's buffer */
+    err = mz_zip_entry_read_buffer(reader->zip_handle, buf, len);
+    if (err != MZ_OK)
+        return err;
+
+#ifndef MZ_ZIP_NO_CRYPTO
+    if (reader->hash != NULL) {
+        while (hashed < len) {
+            chunk = INT32_MAX;
+            if ((int64_t)chunk > len - hashed)
+                chunk = (int32_t)(len - hashed);
+            mz_crypt_sha_update(reader->hash, (uint8_t *)buf + hashed, chunk);
+            hashed += chunk;
+        }
+    }
+#endif
+
+    err = mz_zip_reader_entry_close(handle);
+
+    /* Update the progress at the end */
+    if (err == MZ_OK && reader->progress_cb != NULL)
+        reader->progress_cb(handle, reader->progress_userdata, reader->file_info, len);
 
-    mz_stream_mem_delete(&mem_stream);
     return err;
 }
 
@@ -813,43 +1106,331 @@ int32_t mz_zip_reader_entry_save_buffer_length(void *handle) {
 
 /***************************************************************************/
 
-int32_t mz_zip_reader_save_all(void *handle, const char *destination_dir) {
+static int32_t mz_zip_reader_entry_path(void *handle, const char *destination_dir, char *path, int32_t max_path) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    int32_t err = MZ_OK;
     uint8_t *utf8_string = NULL;
-    char path[512];
+    int32_t err = MZ_OK;
     char utf8_name[256];
     char resolved_name[256];
 
-    err = mz_zip_reader_goto_first_entry(handle);
+    /* Construct output path */
+    path[0] = 0;
 
-    if (err == MZ_END_OF_LIST)
+    strncpy(utf8_name, reader->file_info->filename, sizeof(utf8_name) - 1);
+    utf8_name[sizeof(utf8_name) - 1] = 0;
+
+    if ((reader->encoding > 0) && (reader->file_info->flag & MZ_ZIP_FLAG_UTF8) == 0) {
+        utf8_string = mz_os_utf8_string_create(reader->file_info->filename, reader->encoding);
+        if (utf8_string) {
+            strncpy(utf8_name, (char *)utf8_string, sizeof(utf8_name) - 1);
+            utf8_name[sizeof(utf8_name) - 1] = 0;
+            mz_os_utf8_string_delete(&utf8_string);
+        }
+    }
+
+    err = mz_path_resolve(utf8_name, resolved_name, sizeof(resolved_name));
+    if (err != MZ_OK)
         return err;
 
-    while (err == MZ_OK) {
-        /* Construct output path */
-        path[0] = 0;
-
-        strncpy(utf8_name, reader->file_info->filename, sizeof(utf8_name) - 1);
-        utf8_name[sizeof(utf8_name) - 1] = 0;
-
-        if ((reader->encoding > 0) && (reader->file_info->flag & MZ_ZIP_FLAG_UTF8) == 0) {
-            utf8_string = mz_os_utf8_string_create(reader->file_info->filename, reader->encoding);
-            if (utf8_string) {
-                strncpy(utf8_name, (char *)utf8_string, sizeof(utf8_name) - 1);
-                utf8_name[sizeof(utf8_name) - 1] = 0;
-                mz_os_utf8_string_delete(&utf8_string);
-            }
+    if (destination_dir != NULL)
+        mz_path_combine(path, destination_dir, max_path);
+
+    mz_path_combine(path, resolved_name, max_path);
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
+typedef struct mz_zip_reader_pos_list_s {
+    int64_t     *pos;
+    int32_t     count;
+    int32_t     max;
+} mz_zip_reader_pos_list;
+
+typedef struct mz_zip_reader_save_job_s {
+    mz_zip_reader *reader;
+    const char  *destination_dir;
+    void        *mutex;
+    mz_zip_reader_pos_list
+                files;
+    int32_t     next_file;
+    int32_t     error;
+} mz_zip_reader_save_job;
+
+typedef struct mz_zip_reader_save_worker_s {
+    mz_zip_reader_save_job
+                *job;
+    void        *cursor;
+    void        *thread;
+} mz_zip_reader_save_worker;
+
+static int32_t mz_zip_reader_pos_list_add(mz_zip_reader_pos_list *list, int64_t pos) {
+    int64_t *new_pos = NULL;
+    int32_t new_max = 0;
+
+    if (list->count == list->max) {
+        if (list->max > INT32_MAX / 2)
+            return MZ_MEM_ERROR;
+        new_max = (list->max > 0) ? list->max * 2 : 256;
+        new_pos = (int64_t *)MZ_ALLOC(new_max * sizeof(int64_t));
+        if (new_pos == NULL)
+            return MZ_MEM_ERROR;
+        if (list->pos != NULL) {
+            memcpy(new_pos, list->pos, list->count * sizeof(int64_t));
+            MZ_FREE(list->pos);
         }
+        list->pos = new_pos;
+        list->max = new_max;
+    }
+
+    list->pos[list->count] = pos;
+    list->count += 1;
+    return MZ_OK;
+}
+
+/* Workers report to the callbacks of the shared reader one at a time */
+
+static int32_t mz_zip_reader_save_overwrite_cb(void *handle, void *userdata, mz_zip_file *file_info, const char *path) {
+    mz_zip_reader_save_job *job = (mz_zip_reader_save_job *)userdata;
+    int32_t err = MZ_OK;
+    MZ_UNUSED(handle);
+    mz_os_mutex_lock(job->mutex);
+    err = job->reader->overwrite_cb(job->reader, job->reader->overwrite_userdata, file_info, path);
+    mz_os_mutex_unlock(job->mutex);
+    return err;
+}
+
+static int32_t mz_zip_reader_save_password_cb(void *handle, void *userdata, mz_zip_file *file_info, char *password, int32_t max_password) {
+    mz_zip_reader_save_job *job = (mz_zip_reader_save_job *)userdata;
+    int32_t err = MZ_OK;
+    MZ_UNUSED(handle);
+    mz_os_mutex_lock(job->mutex);
+    err = job->reader->password_cb(job->reader, job->reader->password_userdata, file_info, password, max_password);
+    mz_os_mutex_unlock(job->mutex);
+    return err;
+}
 
-        err = mz_path_resolve(utf8_name, resolved_name, sizeof(resolved_name));
+static int32_t mz_zip_reader_save_progress_cb(void *handle, void *userdata, mz_zip_file *file_info, int64_t position) {
+    mz_zip_reader_save_job *job = (mz_zip_reader_save_job *)userdata;
+    int32_t err = MZ_OK;
+    MZ_UNUSED(handle);
+    mz_os_mutex_lock(job->mutex);
+    err = job->reader->progress_cb(job->reader, job->reader->progress_userdata, file_info, position);
+    mz_os_mutex_unlock(job->mutex);
+    return err;
+}
+
+static int32_t mz_zip_reader_save_entry_cb(void *handle, void *userdata, mz_zip_file *file_info, const char *path) {
+    mz_zip_reader_save_job *job = (mz_zip_reader_save_job *)userdata;
+    int32_t err = MZ_OK;
+    MZ_UNUSED(handle);
+    mz_os_mutex_lock(job->mutex);
+    err = job->reader->entry_cb(job->reader, job->reader->entry_userdata, file_info, path);
+    mz_os_mutex_unlock(job->mutex);
+    return err;
+}
+
+static void mz_zip_reader_save_worker_run(void *userdata) {
+    mz_zip_reader_save_worker *worker = (mz_zip_reader_save_worker *)userdata;
+    mz_zip_reader_save_job *job = worker->job;
+    mz_zip_reader *cursor = (mz_zip_reader *)worker->cursor;
+    int32_t index = 0;
+    int32_t err = MZ_OK;
+    char path[512];
+
+    for (;;) {
+        /* Take the next file, stop once any worker has failed */
+        mz_os_mutex_lock(job->mutex);
+        if ((job->error != MZ_OK) || (job->next_file >= job->files.count))
+            index = -1;
+        else
+            index = job->next_file++;
+        mz_os_mutex_unlock(job->mutex);
+
+        if (index < 0)
+            break;
+
+        err = mz_zip_goto_entry(cursor->zip_handle, job->files.pos[index]);
+        cursor->file_info = NULL;
+        if (err == MZ_OK)
+            err = mz_zip_entry_get_info(cursor->zip_handle, &cursor->file_info);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_path(cursor, job->destination_dir, path, sizeof(path));
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save_file(cursor, path);
+
+        if (err != MZ_OK) {
+            mz_os_mutex_lock(job->mutex);
+            if (job->error == MZ_OK)
+                job->error = err;
+            mz_os_mutex_unlock(job->mutex);
+        }
+    }
+}
+
+static int32_t mz_zip_reader_save_all_parallel(void *handle, const char *destination_dir, uint8_t *started) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    mz_zip_reader *cursor = NULL;
+    mz_zip_reader_save_job job;
+    mz_zip_reader_save_worker *workers = NULL;
+    mz_zip_reader_pos_list links;
+    int32_t worker_count = reader->thread_count;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+    char path[512];
+    char directory[512];
+    char last_directory[512];
+
+    memset(&job, 0, sizeof(job));
+    memset(&links, 0, sizeof(links));
+
+    job.reader = reader;
+    job.destination_dir = destination_dir;
+
+    err = mz_os_mutex_create(&job.mutex);
+    if (err != MZ_OK)
+        return MZ_SUPPORT_ERROR;
+
+    workers = (mz_zip_reader_save_worker *)MZ_ALLOC(worker_count * sizeof(mz_zip_reader_save_worker));
+    if (workers == NULL)
+        err = MZ_MEM_ERROR;
+    else
+        memset(workers, 0, worker_count * sizeof(mz_zip_reader_save_worker));
+
+    /* Each worker reads entries through its own cursor on the shared zip */
+    for (i = 0; (err == MZ_OK) && (i < worker_count); i += 1) {
+        workers[i].job = &job;
+        cursor = (mz_zip_reader *)mz_zip_reader_create(&workers[i].cursor);
+        if (cursor == NULL) {
+            err = MZ_MEM_ERROR;
+            break;
+        }
+
+        cursor->password = reader->password;
+        cursor->raw = reader->raw;
+        cursor->encoding = reader->encoding;
+        cursor->buffer_size = reader->buffer_size;
+        cursor->zero_copy = reader->zero_copy;
+        cursor->zero_copy_verify = reader->zero_copy_verify;
+        cursor->sign_required = reader->sign_required;
+        cursor->progress_cb_interval_ms = reader->progress_cb_interval_ms;
+
+        if (reader->overwrite_cb != NULL)
+            mz_zip_reader_set_overwrite_cb(cursor, &job, mz_zip_reader_save_overwrite_cb);
+        if (reader->password_cb != NULL)
+            mz_zip_reader_set_password_cb(cursor, &job, mz_zip_reader_save_password_cb);
+        if (reader->progress_cb != NULL)
+            mz_zip_reader_set_progress_cb(cursor, &job, mz_zip_reader_save_progress_cb);
+        if (reader->entry_cb != NULL)
+            mz_zip_reader_set_entry_cb(cursor, &job, mz_zip_reader_save_entry_cb);
+
+        err = mz_zip_reader_open_cursor(cursor, reader);
+    }
+
+    /* Files may be written from here on, so errors can no longer be retried serially */
+    if (err == MZ_OK)
+        *started = 1;
+
+    /* Create directories up front so workers only have to write files */
+    last_directory[0] = 0;
+
+    if (err == MZ_OK)
+        err = mz_zip_reader_goto_first_entry(handle);
+
+    while (err == MZ_OK) {
+        err = mz_zip_reader_entry_path(handle, destination_dir, path, sizeof(path));
         if (err != MZ_OK)
             break;
 
-        if (destination_dir != NULL)
-            mz_path_combine(path, destination_dir, sizeof(path));
+        if (mz_zip_entry_is_symlink(reader->zip_handle) == MZ_OK) {
+            /* Symbolic links may point at files that haven't been written yet */
+            err = mz_zip_reader_pos_list_add(&links, mz_zip_get_entry(reader->zip_handle));
+        } else if (mz_zip_entry_is_dir(reader->zip_handle) == MZ_OK) {
+            err = mz_zip_reader_entry_save_file(handle, path);
+        } else {
+            err = mz_zip_reader_pos_list_add(&job.files, mz_zip_get_entry(reader->zip_handle));
+
+            strncpy(directory, path, sizeof(directory) - 1);
+            directory[sizeof(directory) - 1] = 0;
+            mz_path_convert_slashes(directory, MZ_PATH_SLASH_UNIX);
+            mz_path_remove_filename(directory);
+
+            if ((err == MZ_OK) && (strcmp(directory, last_directory) != 0)) {
+                if (mz_os_is_dir(directory) != MZ_OK)
+                    err = mz_dir_make(directory);
+                strncpy(last_directory, directory, sizeof(last_directory));
+            }
+        }
+
+        if (err == MZ_OK)
+            err = mz_zip_reader_goto_next_entry(handle);
+    }
+
+    if (err == MZ_END_OF_LIST)
+        err = MZ_OK;
+
+    if (err == MZ_OK) {
+        /* The calling thread is the first worker so extraction continues if threads can't be started */
+        for (i = 1; i < worker_count && i < job.files.count; i += 1)
+            mz_os_thread_create(&workers[i].thread, mz_zip_reader_save_worker_run, &workers[i]);
+
+        mz_zip_reader_save_worker_run(&workers[0]);
+
+        for (i = 1; i < worker_count; i += 1) {
+            if (workers[i].thread != NULL)
+                mz_os_thread_join(&workers[i].thread);
+        }
+
+        err = job.error;
+    }
+
+    for (i = 0; (err == MZ_OK) && (i < links.count); i += 1) {
+        err = mz_zip_goto_entry(reader->zip_handle, links.pos[i]);
+        reader->file_info = NULL;
+        if (err == MZ_OK)
+            err = mz_zip_entry_get_info(reader->zip_handle, &reader->file_info);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_path(handle, destination_dir, path, sizeof(path));
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save_file(handle, path);
+    }
+
+    if (workers != NULL) {
+        for (i = 0; i < worker_count; i += 1)
+            mz_zip_reader_delete(&workers[i].cursor);
+        MZ_FREE(workers);
+    }
 
-        mz_path_combine(path, resolved_name, sizeof(path));
+    MZ_FREE(job.files.pos);
+    MZ_FREE(links.pos);
+    mz_os_mutex_delete(&job.mutex);
+    return err;
+}
+
+int32_t mz_zip_reader_save_all(void *handle, const char *destination_dir) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    int32_t err = MZ_OK;
+    uint8_t started = 0;
+    char path[512];
+
+    err = mz_zip_reader_goto_first_entry(handle);
+
+    if (err == MZ_END_OF_LIST)
+        return err;
+
+    if ((err == MZ_OK) && (reader->thread_count > 1)) {
+        /* Extract serially when the zip can't be shared between threads */
+        err = mz_zip_reader_save_all_parallel(handle, destination_dir, &started);
+        if (started || err != MZ_SUPPORT_ERROR)
+            return err;
+
+        err = mz_zip_reader_goto_first_entry(handle);
+    }
+
+    while (err == MZ_OK) {
+        err = mz_zip_reader_entry_path(handle, destination_dir, path, sizeof(path));
+        if (err != MZ_OK)
+            break;
 
         /* Save file to disk */
         err = mz_zip_reader_entry_save_file(handle, path);
@@ -872,46 +1453,100 @@ void mz_zip_reader_set_pattern(void *handle, const char *pattern, uint8_t ignore
     reader->pattern_ignore_case = ignore_case;
 }
 
-void mz_zip_reader_set_password(void *handle, const char *password) {
+void mz_zip_reader_set_password(void *handle, const char *password) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    reader->password = password;
+}
+
+void mz_zip_reader_set_raw(void *handle, uint8_t raw) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    reader->raw = raw;
+}
+
+int32_t mz_zip_reader_get_raw(void *handle, uint8_t *raw) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    if (raw == NULL)
+        return MZ_PARAM_ERROR;
+    *raw = reader->raw;
+    return MZ_OK;
+}
+
+int32_t mz_zip_reader_get_zip_cd(void *handle, uint8_t *zip_cd) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    if (zip_cd == NULL)
+        return MZ_PARAM_ERROR;
+    *zip_cd = reader->cd_zipped;
+    return MZ_OK;
+}
+
+int32_t mz_zip_reader_get_comment(void *handle, const char **comment) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    if (mz_zip_reader_is_open(reader) != MZ_OK)
+        return MZ_PARAM_ERROR;
+    if (comment == NULL)
+        return MZ_PARAM_ERROR;
+    return mz_zip_get_comment(reader->zip_handle, comment);
+}
+
+int32_t mz_zip_reader_set_recover(void *handle, uint8_t recover) {
+    mz_zip_reader *reader = (mz_zip_reader *)handle;
+    if (reader == NULL)
+        return MZ_PARAM_ERROR;
+    reader->recover = recover;
+    return MZ_OK;
+}
+
+int32_t mz_zip_reader_set_cd_index(void *handle, uint8_t cd_index) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    reader->password = password;
+    if (reader == NULL)
+        return MZ_PARAM_ERROR;
+    reader->cd_index = cd_index;
+    return MZ_OK;
 }
 
-void mz_zip_reader_set_raw(void *handle, uint8_t raw) {
+int32_t mz_zip_reader_set_cd_in_memory(void *handle, uint8_t cd_in_memory) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    reader->raw = raw;
+    if (reader == NULL)
+        return MZ_PARAM_ERROR;
+    reader->cd_in_memory = cd_in_memory;
+    return MZ_OK;
 }
 
-int32_t mz_zip_reader_get_raw(void *handle, uint8_t *raw) {
+int32_t mz_zip_reader_set_mmap(void *handle, uint8_t mmap_file) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    if (raw == NULL)
+    if (reader == NULL)
         return MZ_PARAM_ERROR;
-    *raw = reader->raw;
+    reader->mmap_file = mmap_file;
     return MZ_OK;
 }
 
-int32_t mz_zip_reader_get_zip_cd(void *handle, uint8_t *zip_cd) {
+int32_t mz_zip_reader_set_zero_copy(void *handle, uint8_t zero_copy, uint8_t verify) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    if (zip_cd == NULL)
+    if (reader == NULL)
         return MZ_PARAM_ERROR;
-    *zip_cd = reader->cd_zipped;
+    reader->zero_copy = zero_copy;
+    reader->zero_copy_verify = verify;
     return MZ_OK;
 }
 
-int32_t mz_zip_reader_get_comment(void *handle, const char **comment) {
+int32_t mz_zip_reader_set_buffer_size(void *handle, int32_t buffer_size) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    if (mz_zip_reader_is_open(reader) != MZ_OK)
-        return MZ_PARAM_ERROR;
-    if (comment == NULL)
+    if (reader == NULL || buffer_size < 0)
         return MZ_PARAM_ERROR;
-    return mz_zip_get_comment(reader->zip_handle, comment);
+    if (reader->buffer_size != buffer_size) {
+        if (reader->buffer != NULL)
+            MZ_FREE(reader->buffer);
+        reader->buffer = NULL;
+    }
+    reader->buffer_size = buffer_size;
+    return MZ_OK;
 }
 
-int32_t mz_zip_reader_set_recover(void *handle, uint8_t recover) {
+int32_t mz_zip_reader_set_thread_count(void *handle, int32_t thread_count) {
     mz_zip_reader *reader = (mz_zip_reader *)handle;
-    if (reader == NULL)
+    if (reader == NULL || thread_count < 0)
         return MZ_PARAM_ERROR;
-    reader->recover = recover;
+    reader->thread_count = thread_count;
     return MZ_OK;
 }
 
@@ -973,6 +1608,8 @@ void *mz_zip_reader_create(void **handle) {
     if (reader != NULL) {
         memset(reader, 0, sizeof(mz_zip_reader));
         reader->recover = 1;
+        reader->zero_copy = 1;
+        reader->zero_copy_verify = 1;
         reader->progress_cb_interval_ms = MZ_DEFAULT_PROGRESS_INTERVAL;
     }
     if (handle != NULL)
@@ -988,6 +1625,8 @@ void mz_zip_reader_delete(void **handle) {
     reader = (mz_zip_reader *)*handle;
     if (reader != NULL) {
         mz_zip_reader_close(reader);
+        if (reader->buffer != NULL)
+            MZ_FREE(reader->buffer);
         MZ_FREE(reader);
     }
     *handle = NULL;
@@ -998,6 +1637,7 @@ void mz_zip_reader_delete(void **handle) {
 typedef struct mz_zip_writer_s {
     void        *zip_handle;
     void        *file_stream;
+    void        *async_stream;
     void        *buffered_stream;
     void        *split_stream;
     void        *sha256;
@@ -1024,14 +1664,31 @@ typedef struct mz_zip_writer_s {
     const char  *cert_pwd;
     uint16_t    compress_method;
     int16_t     compress_level;
+    int64_t     compress_job_size;
     uint8_t     follow_links;
     uint8_t     store_links;
     uint8_t     zip_cd;
     uint8_t     aes;
     uint8_t     raw;
-    uint8_t     buffer[UINT16_MAX];
+    uint8_t     *buffer;
+    int32_t     buffer_size;
+    void        *cb_handle;
+    void        *cb_mutex;
+    int32_t     thread_count;
+    void        *threads;
 } mz_zip_writer;
 
+static int32_t mz_zip_writer_threads_flush(void *handle);
+static void    mz_zip_writer_threads_stop(void *handle);
+
+/***************************************************************************/
+
+static int32_t mz_zip_writer_get_chunk_size(mz_zip_writer *writer) {
+    if (writer->buffer_size > 0)
+        return writer->buffer_size;
+    return UINT16_MAX;
+}
+
 /***************************************************************************/
 
 int32_t mz_zip_writer_zip_cd(void *handle) {
@@ -1164,11 +1821,24 @@ int32_t mz_zip_writer_open_file(void *handle, const char *path, int64_t disk_siz
             mode |= MZ_OPEN_MODE_APPEND;
     }
 
+#ifdef _WIN32
     mz_stream_os_create(&writer->file_stream);
+#else
+    mz_stream_fd_create(&writer->file_stream);
+#endif
     mz_stream_buffered_create(&writer->buffered_stream);
+    if (writer->buffer_size > 0)
+        mz_stream_set_prop_int64(writer->buffered_stream, MZ_STREAM_PROP_BUFFER_SIZE, writer->buffer_size);
     mz_stream_split_create(&writer->split_stream);
 
-    mz_stream_set_base(writer->buffered_stream, writer->file_stream);
+    if (writer->thread_count > 1) {
+        /* File is written behind on a thread while entries are compressed */
+        mz_stream_async_create(&writer->async_stream);
+        mz_stream_set_base(writer->async_stream, writer->file_stream);
+        mz_stream_set_base(writer->buffered_stream, writer->async_stream);
+    } else {
+        mz_stream_set_base(writer->buffered_stream, writer->file_stream);
+    }
     mz_stream_set_base(writer->split_stream, writer->buffered_stream);
 
     mz_stream_split_set_prop_int64(writer->split_stream, MZ_STREAM_PROP_DISK_SIZE, disk_size);
@@ -1232,8 +1902,14 @@ int32_t mz_zip_writer_open_file_in_memory(void *handle, const char *path) {
 int32_t mz_zip_writer_close(void *handle) {
     mz_zip_writer *writer = (mz_zip_writer *)handle;
     int32_t err = MZ_OK;
+    int32_t err_close = MZ_OK;
 
 
+    if (writer->threads != NULL) {
+        err = mz_zip_writer_threads_flush(handle);
+        mz_zip_writer_threads_stop(handle);
+    }
+
     if (writer->zip_handle != NULL) {
         mz_zip_set_version_madeby(writer->zip_handle, MZ_VERSION_MADEBY);
         if (writer->comment)
@@ -1241,20 +1917,29 @@ int32_t mz_zip_writer_close(void *handle) {
         if (writer->zip_cd)
             mz_zip_writer_zip_cd(writer);
 
-        err = mz_zip_close(writer->zip_handle);
+        if (err == MZ_OK)
+            err = mz_zip_close(writer->zip_handle);
+        else
+            mz_zip_close(writer->zip_handle);
         mz_zip_delete(&writer->zip_handle);
     }
 
     if (writer->split_stream != NULL) {
-        mz_stream_split_close(writer->split_stream);
+        /* Data written behind is only known to have reached the file once it is closed */
+        err_close = mz_stream_split_close(writer->split_stream);
+        if (err == MZ_OK)
+            err = err_close;
         mz_stream_split_delete(&writer->split_stream);
     }
 
     if (writer->buffered_stream != NULL)
         mz_stream_buffered_delete(&writer->buffered_stream);
 
+    if (writer->async_stream != NULL)
+        mz_stream_async_delete(&writer->async_stream);
+
     if (writer->file_stream != NULL)
-        mz_stream_os_delete(&writer->file_stream);
+        mz_stream_delete(&writer->file_stream);
 
     if (writer->mem_stream != NULL) {
         mz_stream_mem_close(writer->mem_stream);
@@ -1272,19 +1957,31 @@ int32_t mz_zip_writer_entry_open(void *handle, mz_zip_file *file_info) {
     const char *password = NULL;
     char password_buf[120];
 
+    /* Write entries still being compressed by other threads first to keep them in order */
+    if (writer->threads != NULL) {
+        err = mz_zip_writer_threads_flush(handle);
+        if (err != MZ_OK)
+            return err;
+    }
+
     /* Copy file info to access data upon close */
     memcpy(&writer->file_info, file_info, sizeof(mz_zip_file));
 
-    if (writer->entry_cb != NULL)
-        writer->entry_cb(handle, writer->entry_userdata, &writer->file_info);
+    if (writer->entry_cb != NULL) {
+        mz_os_mutex_lock(writer->cb_mutex);
+        writer->entry_cb(writer->cb_handle, writer->entry_userdata, &writer->file_info);
+        mz_os_mutex_unlock(writer->cb_mutex);
+    }
 
     password = writer->password;
 
     /* Check if we need a password and ask for it if we need to */
     if ((writer->file_info.flag & MZ_ZIP_FLAG_ENCRYPTED) && (password == NULL) &&
         (writer->password_cb != NULL)) {
-        writer->password_cb(handle, writer->password_userdata, &writer->file_info,
+        mz_os_mutex_lock(writer->cb_mutex);
+        writer->password_cb(writer->cb_handle, writer->password_userdata, &writer->file_info,
             password_buf, sizeof(password_buf));
+        mz_os_mutex_unlock(writer->cb_mutex);
         password = password_buf;
     }
 
@@ -1297,6 +1994,11 @@ int32_t mz_zip_writer_entry_open(void *handle, mz_zip_file *file_info) {
     }
 #endif
 
+    /* Entries added directly by this writer can still be compressed by multiple threads */
+    mz_zip_set_compress_threads(writer->zip_handle, writer->thread_count);
+    mz_zip_set_compress_job_size(writer->zip_handle, writer->compress_job_size);
+    mz_zip_set_buffer_size(writer->zip_handle, writer->buffer_size);
+
     /* Open entry in zip */
     err = mz_zip_entry_write_open(writer->zip_handle, &writer->file_info, writer->compress_level,
         writer->raw, password);
@@ -1417,6 +2119,13 @@ int32_t mz_zip_writer_entry_write(void *handle, const void *buf, int32_t len) {
 }
 /***************************************************************************/
 
+static void mz_zip_writer_progress_update(void *handle, int64_t position) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_os_mutex_lock(writer->cb_mutex);
+    writer->progress_cb(writer->cb_handle, writer->progress_userdata, &writer->file_info, position);
+    mz_os_mutex_unlock(writer->cb_mutex);
+}
+
 int32_t mz_zip_writer_add_process(void *handle, void *stream, mz_stream_read_cb read_cb) {
     mz_zip_writer *writer = (mz_zip_writer *)handle;
     int32_t read = 0;
@@ -1431,7 +2140,13 @@ int32_t mz_zip_writer_add_process(void *handle, void *stream, mz_stream_read_cb
     if (read_cb == NULL)
         return MZ_PARAM_ERROR;
 
-    read = read_cb(stream, writer->buffer, sizeof(writer->buffer));
+    if (writer->buffer == NULL) {
+        writer->buffer = (uint8_t *)MZ_ALLOC(mz_zip_writer_get_chunk_size(writer));
+        if (writer->buffer == NULL)
+            return MZ_MEM_ERROR;
+    }
+
+    read = read_cb(stream, writer->buffer, mz_zip_writer_get_chunk_size(writer));
     if (read == 0)
         return MZ_END_OF_STREAM;
     if (read < 0) {
@@ -1457,7 +2172,7 @@ int32_t mz_zip_writer_add(void *handle, void *stream, mz_stream_read_cb read_cb)
 
     /* Update the progress at the beginning */
     if (writer->progress_cb != NULL)
-        writer->progress_cb(handle, writer->progress_userdata, &writer->file_info, current_pos);
+        mz_zip_writer_progress_update(handle, current_pos);
 
     /* Write data to stream until done */
     while (err == MZ_OK) {
@@ -1473,7 +2188,7 @@ int32_t mz_zip_writer_add(void *handle, void *stream, mz_stream_read_cb read_cb)
         current_time = mz_os_ms_time();
         if ((current_time - update_time) > writer->progress_cb_interval_ms) {
             if (writer->progress_cb != NULL)
-                writer->progress_cb(handle, writer->progress_userdata, &writer->file_info, current_pos);
+                mz_zip_writer_progress_update(handle, current_pos);
 
             update_pos = current_pos;
             update_time = current_time;
@@ -1482,7 +2197,7 @@ int32_t mz_zip_writer_add(void *handle, void *stream, mz_stream_read_cb read_cb)
 
     /* Update the progress at the end */
     if (writer->progress_cb != NULL && update_pos != current_pos)
-        writer->progress_cb(handle, writer->progress_userdata, &writer->file_info, current_pos);
+        mz_zip_writer_progress_update(handle, current_pos);
 
     return err;
 }
@@ -1516,28 +2231,454 @@ int32_t mz_zip_writer_add_info(void *handle, void *stream, mz_stream_read_cb rea
 }
 
 int32_t mz_zip_writer_add_buffer(void *handle, void *buf, int32_t len, mz_zip_file *file_info) {
-    void *mem_stream = NULL;
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
     int32_t err = MZ_OK;
 
     if (mz_zip_writer_is_open(handle) != MZ_OK)
         return MZ_PARAM_ERROR;
-    if (buf == NULL)
+    if (buf == NULL || len < 0 || file_info == NULL)
         return MZ_PARAM_ERROR;
 
-    /* Create a memory stream backed by our buffer and add from it */
-    mz_stream_mem_create(&mem_stream);
-    mz_stream_mem_set_buffer(mem_stream, buf, len);
+    err = mz_zip_writer_entry_open(handle, file_info);
+    if (err != MZ_OK)
+        return err;
+
+    if (mz_zip_attrib_is_dir(writer->file_info.external_fa, writer->file_info.version_madeby) != MZ_OK) {
+        if (writer->progress_cb != NULL)
+            mz_zip_writer_progress_update(handle, 0);
+
+        /* Compress straight from the caller's buffer, all at once */
+        err = mz_zip_entry_write_buffer(writer->zip_handle, buf, len);
+        if (err != MZ_OK)
+            return err;
+#ifndef MZ_ZIP_NO_CRYPTO
+        if (writer->sha256 != NULL)
+            mz_crypt_sha_update(writer->sha256, buf, len);
+#endif
+
+        if (writer->progress_cb != NULL)
+            mz_zip_writer_progress_update(handle, len);
+    }
+
+    return mz_zip_writer_entry_close(handle);
+}
+
+/***************************************************************************/
+
+#define MZ_ZIP_WRITER_JOB_QUEUED        (0)
+#define MZ_ZIP_WRITER_JOB_RUNNING       (1)
+#define MZ_ZIP_WRITER_JOB_DONE          (2)
+
+typedef struct mz_zip_writer_job_s {
+    char        *path;
+    char        *filename;
+    uint8_t     serial;
+    int32_t     state;
+    int32_t     error;
+    void        *mem_stream;
+} mz_zip_writer_job;
+
+typedef struct mz_zip_writer_worker_s {
+    void        *threads;
+    void        *writer;
+    void        *thread;
+} mz_zip_writer_worker;
+
+typedef struct mz_zip_writer_threads_s {
+    void        *mutex;
+    void        *cb_mutex;
+    void        *work_cond;
+    void        *done_cond;
+    mz_zip_writer_job
+                *jobs;
+    int32_t     max_jobs;
+    int64_t     head;
+    int64_t     tail;
+    mz_zip_writer_worker
+                *workers;
+    int32_t     worker_count;
+    uint8_t     stop;
+    uint8_t     serializing;
+    int32_t     error;
+} mz_zip_writer_threads;
+
+static char *mz_zip_writer_string_copy(const char *string) {
+    char *copy = NULL;
+    size_t length = 0;
+
+    if (string == NULL)
+        return NULL;
+
+    length = strlen(string) + 1;
+    copy = (char *)MZ_ALLOC(length);
+    if (copy != NULL)
+        memcpy(copy, string, length);
+    return copy;
+}
+
+static void mz_zip_writer_job_reset(mz_zip_writer_job *job) {
+    if (job->path != NULL)
+        MZ_FREE(job->path);
+    if (job->filename != NULL)
+        MZ_FREE(job->filename);
+    if (job->mem_stream != NULL)
+        mz_stream_mem_delete(&job->mem_stream);
+    memset(job, 0, sizeof(mz_zip_writer_job));
+}
+
+static void mz_zip_writer_job_compress(mz_zip_writer_worker *worker, mz_zip_writer_job *job) {
+    mz_zip_writer *writer = (mz_zip_writer *)worker->writer;
+    int64_t grow_size = mz_os_get_file_size(job->path);
+    int32_t err = MZ_OK;
+    int32_t err_close = MZ_OK;
+    uint8_t zip_cd = writer->zip_cd;
+
+    /* Compress the entry into its own zip in memory so it can be copied raw later */
+    if (grow_size < 0)
+        grow_size = 0;
+    grow_size += 4096;
+
+    mz_stream_mem_create(&job->mem_stream);
+    mz_stream_mem_set_grow_size(job->mem_stream, (int32_t)grow_size);
+    err = mz_stream_mem_open(job->mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    if (err == MZ_OK)
+        err = mz_zip_writer_open(writer, job->mem_stream, 0);
+    if (err == MZ_OK) {
+        err = mz_zip_writer_add_file(writer, job->path, job->filename);
+
+        /* Only the central directory of the shared zip is zipped */
+        writer->zip_cd = 0;
+        err_close = mz_zip_writer_close(writer);
+        writer->zip_cd = zip_cd;
+
+        if (err == MZ_OK)
+            err = err_close;
+    }
+
+    job->error = err;
+}
+
+static int32_t mz_zip_writer_job_copy(void *handle, mz_zip_writer_job *job) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_file *file_info = NULL;
+    void *zip_handle = NULL;
+    int64_t compressed_size = 0;
+    int64_t uncompressed_size = 0;
+    uint32_t crc32 = 0;
+    int32_t read = 0;
+    int32_t err = MZ_OK;
+
+    mz_zip_create(&zip_handle);
+    err = mz_zip_open(zip_handle, job->mem_stream, MZ_OPEN_MODE_READ);
+
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_entry_get_info(zip_handle, &file_info);
+    if (err == MZ_OK)
+        err = mz_zip_entry_read_open(zip_handle, 1, NULL);
+    if (err == MZ_OK)
+        err = mz_zip_entry_write_open(writer->zip_handle, file_info, writer->compress_level, 1, NULL);
+
+    if (err == MZ_OK && writer->buffer == NULL) {
+        writer->buffer = (uint8_t *)MZ_ALLOC(mz_zip_writer_get_chunk_size(writer));
+        if (writer->buffer == NULL)
+            err = MZ_MEM_ERROR;
+    }
+
+    /* Append the local header and compressed data as they are */
+    while (err == MZ_OK) {
+        read = mz_zip_entry_read(zip_handle, writer->buffer, mz_zip_writer_get_chunk_size(writer));
+        if (read == 0)
+            break;
+        if (read < 0)
+            err = read;
+        else if (mz_zip_entry_write(writer->zip_handle, writer->buffer, read) != read)
+            err = MZ_WRITE_ERROR;
+    }
 
-    err = mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_READ);
     if (err == MZ_OK)
-        err = mz_zip_writer_add_info(handle, mem_stream, mz_stream_mem_read, file_info);
+        err = mz_zip_entry_read_close(zip_handle, &crc32, &compressed_size, &uncompressed_size);
+    if (err == MZ_OK)
+        err = mz_zip_entry_write_close(writer->zip_handle, crc32, compressed_size, uncompressed_size);
+
+    if (mz_zip_entry_is_open(zip_handle) == MZ_OK)
+        mz_zip_entry_close(zip_handle);
+    if (mz_zip_entry_is_open(writer->zip_handle) == MZ_OK)
+        mz_zip_entry_close(writer->zip_handle);
 
-    mz_stream_mem_delete(&mem_stream);
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
     return err;
 }
 
+static void mz_zip_writer_worker_run(void *userdata) {
+    mz_zip_writer_worker *worker = (mz_zip_writer_worker *)userdata;
+    mz_zip_writer_threads *threads = (mz_zip_writer_threads *)worker->threads;
+    mz_zip_writer_job *job = NULL;
+    int64_t i = 0;
+
+    mz_os_mutex_lock(threads->mutex);
+    while (!threads->stop) {
+        /* Find the oldest entry nobody has started compressing */
+        job = NULL;
+        for (i = threads->head; i < threads->tail; i += 1) {
+            job = &threads->jobs[i % threads->max_jobs];
+            if (!job->serial && job->state == MZ_ZIP_WRITER_JOB_QUEUED)
+                break;
+            job = NULL;
+        }
+
+        if (job == NULL) {
+            mz_os_cond_wait(threads->work_cond, threads->mutex);
+            continue;
+        }
+
+        job->state = MZ_ZIP_WRITER_JOB_RUNNING;
+        mz_os_mutex_unlock(threads->mutex);
+
+        mz_zip_writer_job_compress(worker, job);
+
+        mz_os_mutex_lock(threads->mutex);
+        job->state = MZ_ZIP_WRITER_JOB_DONE;
+        mz_os_cond_broadcast(threads->done_cond);
+    }
+    mz_os_mutex_unlock(threads->mutex);
+}
+
+static int32_t mz_zip_writer_threads_start(void *handle) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_writer_threads *threads = NULL;
+    mz_zip_writer *worker_writer = NULL;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+
+    threads = (mz_zip_writer_threads *)MZ_ALLOC(sizeof(mz_zip_writer_threads));
+    if (threads == NULL)
+        return MZ_MEM_ERROR;
+    memset(threads, 0, sizeof(mz_zip_writer_threads));
+    writer->threads = threads;
+
+    err = mz_os_mutex_create(&threads->mutex);
+    if (err == MZ_OK)
+        err = mz_os_mutex_create(&threads->cb_mutex);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&threads->work_cond);
+    if (err == MZ_OK)
+        err = mz_os_cond_create(&threads->done_cond);
+
+    if (err != MZ_OK) {
+        mz_zip_writer_threads_stop(handle);
+        return MZ_SUPPORT_ERROR;
+    }
+
+    /* Keep a few entries queued for each thread so they don't wait on the calling thread */
+    threads->worker_count = writer->thread_count;
+    threads->max_jobs = writer->thread_count * 2;
+
+    threads->jobs = (mz_zip_writer_job *)MZ_ALLOC(threads->max_jobs * sizeof(mz_zip_writer_job));
+    threads->workers = (mz_zip_writer_worker *)MZ_ALLOC(threads->worker_count * sizeof(mz_zip_writer_worker));
+
+    if (threads->jobs == NULL || threads->workers == NULL) {
+        mz_zip_writer_threads_stop(handle);
+        return MZ_MEM_ERROR;
+    }
+
+    memset(threads->jobs, 0, threads->max_jobs * sizeof(mz_zip_writer_job));
+    memset(threads->workers, 0, threads->worker_count * sizeof(mz_zip_writer_worker));
+
+    /* Callbacks are called one at a time with the handle of this writer */
+    writer->cb_mutex = threads->cb_mutex;
+
+    for (i = 0; i < threads->worker_count; i += 1) {
+        threads->workers[i].threads = threads;
+
+        worker_writer = (mz_zip_writer *)mz_zip_writer_create(&threads->workers[i].writer);
+        if (worker_writer == NULL) {
+            mz_zip_writer_threads_stop(handle);
+            return MZ_MEM_ERROR;
+        }
+
+        worker_writer->password = writer->password;
+        worker_writer->compress_method = writer->compress_method;
+        worker_writer->compress_level = writer->compress_level;
+        worker_writer->buffer_size = writer->buffer_size;
+        worker_writer->follow_links = writer->follow_links;
+        worker_writer->store_links = writer->store_links;
+        worker_writer->zip_cd = writer->zip_cd;
+        worker_writer->aes = writer->aes;
+        worker_writer->cert_data = writer->cert_data;
+        worker_writer->cert_data_size = writer->cert_data_size;
+        worker_writer->cert_pwd = writer->cert_pwd;
+
+        worker_writer->password_cb = writer->password_cb;
+        worker_writer->password_userdata = writer->password_userdata;
+        worker_writer->progress_cb = writer->progress_cb;
+        worker_writer->progress_userdata = writer->progress_userdata;
+        worker_writer->progress_cb_interval_ms = writer->progress_cb_interval_ms;
+        worker_writer->entry_cb = writer->entry_cb;
+        worker_writer->entry_userdata = writer->entry_userdata;
+        worker_writer->cb_handle = writer;
+        worker_writer->cb_mutex = threads->cb_mutex;
+    }
+
+    /* The calling thread is the first worker so entries are still written if threads can't be started */
+    for (i = 1; i < threads->worker_count; i += 1)
+        mz_os_thread_create(&threads->workers[i].thread, mz_zip_writer_worker_run, &threads->workers[i]);
+
+    return MZ_OK;
+}
+
+static void mz_zip_writer_threads_stop(void *handle) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_writer_threads *threads = (mz_zip_writer_threads *)writer->threads;
+    mz_zip_writer *worker_writer = NULL;
+    int32_t i = 0;
+
+    if (threads == NULL)
+        return;
+
+    mz_os_mutex_lock(threads->mutex);
+    threads->stop = 1;
+    mz_os_cond_broadcast(threads->work_cond);
+    mz_os_mutex_unlock(threads->mutex);
+
+    if (threads->workers != NULL) {
+        for (i = 0; i < threads->worker_count; i += 1) {
+            if (threads->workers[i].thread != NULL)
+                mz_os_thread_join(&threads->workers[i].thread);
+
+            /* Certificate belongs to this writer */
+            worker_writer = (mz_zip_writer *)threads->workers[i].writer;
+            if (worker_writer != NULL)
+                worker_writer->cert_data = NULL;
+            mz_zip_writer_delete(&threads->workers[i].writer);
+        }
+        MZ_FREE(threads->workers);
+    }
+
+    if (threads->jobs != NULL) {
+        for (i = 0; i < threads->max_jobs; i += 1)
+            mz_zip_writer_job_reset(&threads->jobs[i]);
+        MZ_FREE(threads->jobs);
+    }
+
+    mz_os_cond_delete(&threads->done_cond);
+    mz_os_cond_delete(&threads->work_cond);
+    mz_os_mutex_delete(&threads->cb_mutex);
+    mz_os_mutex_delete(&threads->mutex);
+
+    writer->cb_mutex = NULL;
+    writer->threads = NULL;
+    MZ_FREE(threads);
+}
+
+static int32_t mz_zip_writer_threads_write_head(void *handle) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_writer_threads *threads = (mz_zip_writer_threads *)writer->threads;
+    mz_zip_writer_job *job = &threads->jobs[threads->head % threads->max_jobs];
+    int32_t err = MZ_OK;
+
+    if (!job->serial) {
+        mz_os_mutex_lock(threads->mutex);
+        if (job->state == MZ_ZIP_WRITER_JOB_QUEUED) {
+            /* Compress the entry on the calling thread instead of waiting for a free thread */
+            job->state = MZ_ZIP_WRITER_JOB_RUNNING;
+            mz_os_mutex_unlock(threads->mutex);
+
+            mz_zip_writer_job_compress(&threads->workers[0], job);
+
+            mz_os_mutex_lock(threads->mutex);
+            job->state = MZ_ZIP_WRITER_JOB_DONE;
+        }
+        while (job->state != MZ_ZIP_WRITER_JOB_DONE)
+            mz_os_cond_wait(threads->done_cond, threads->mutex);
+        mz_os_mutex_unlock(threads->mutex);
+    }
+
+    /* Entries after the first error are discarded */
+    if (threads->error == MZ_OK) {
+        if (job->serial) {
+            threads->serializing = 1;
+            err = mz_zip_writer_add_file(handle, job->path, job->filename);
+            threads->serializing = 0;
+        } else if (job->error != MZ_OK) {
+            err = job->error;
+        } else {
+            err = mz_zip_writer_job_copy(handle, job);
+        }
+
+        threads->error = err;
+    }
+
+    mz_os_mutex_lock(threads->mutex);
+    mz_zip_writer_job_reset(job);
+    threads->head += 1;
+    mz_os_mutex_unlock(threads->mutex);
+
+    return threads->error;
+}
+
+static int32_t mz_zip_writer_threads_flush(void *handle) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_writer_threads *threads = (mz_zip_writer_threads *)writer->threads;
+
+    if (threads->serializing)
+        return MZ_OK;
+
+    while (threads->head < threads->tail)
+        mz_zip_writer_threads_write_head(handle);
+
+    return threads->error;
+}
+
+static int32_t mz_zip_writer_threads_add_file(void *handle, const char *path, const char *filename_in_zip) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_writer_threads *threads = (mz_zip_writer_threads *)writer->threads;
+    mz_zip_writer_job *job = NULL;
+    int32_t err = MZ_OK;
+
+    if (threads->error != MZ_OK)
+        return threads->error;
+
+    /* Write the oldest entries until there is room in the queue */
+    while (threads->tail - threads->head >= threads->max_jobs) {
+        err = mz_zip_writer_threads_write_head(handle);
+        if (err != MZ_OK)
+            return err;
+    }
+
+    job = &threads->jobs[threads->tail % threads->max_jobs];
+
+    job->path = mz_zip_writer_string_copy(path);
+    job->filename = mz_zip_writer_string_copy(filename_in_zip);
+    if (job->path == NULL || (filename_in_zip != NULL && job->filename == NULL)) {
+        mz_zip_writer_job_reset(job);
+        return MZ_MEM_ERROR;
+    }
+
+    /* Directories, links and large files are added by the calling thread in order */
+    if (mz_os_is_dir(path) == MZ_OK)
+        job->serial = 1;
+    else if (writer->store_links && mz_os_is_symlink(path) == MZ_OK)
+        job->serial = 1;
+    else if (mz_os_get_file_size(path) > MZ_ZIP_WRITER_THREAD_MAX_SIZE)
+        job->serial = 1;
+
+    mz_os_mutex_lock(threads->mutex);
+    job->state = MZ_ZIP_WRITER_JOB_QUEUED;
+    threads->tail += 1;
+    if (!job->serial)
+        mz_os_cond_signal(threads->work_cond);
+    mz_os_mutex_unlock(threads->mutex);
+
+    return MZ_OK;
+}
+
 int32_t mz_zip_writer_add_file(void *handle, const char *path, const char *filename_in_zip) {
     mz_zip_writer *writer = (mz_zip_writer *)handle;
+    mz_zip_writer_threads *threads = NULL;
     mz_zip_file file_info;
     uint32_t target_attrib = 0;
     uint32_t src_attrib = 0;
@@ -1553,6 +2694,16 @@ int32_t mz_zip_writer_add_file(void *handle, const char *path, const char *filen
     if (path == NULL)
         return MZ_PARAM_ERROR;
 
+    if ((writer->thread_count > 1) && (writer->threads == NULL)) {
+        /* Add entries one at a time if threads can't be started */
+        if (mz_zip_writer_threads_start(handle) != MZ_OK)
+            writer->thread_count = 1;
+    }
+
+    threads = (mz_zip_writer_threads *)writer->threads;
+    if ((threads != NULL) && (!threads->serializing))
+        return mz_zip_writer_threads_add_file(handle, path, filename_in_zip);
+
     if (filename == NULL) {
         err = mz_path_get_filename(path, &filename);
         if (err != MZ_OK)
@@ -1698,6 +2849,86 @@ int32_t mz_zip_writer_add_path(void *handle, const char *path, const char *root_
     return err;
 }
 
+#ifndef _WIN32
+static int32_t mz_zip_writer_entry_copy_range(void *handle, mz_zip_reader *reader, mz_zip_file *file_info) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    void *reader_stream = NULL;
+    void *writer_stream = NULL;
+    void *source_stream = NULL;
+    void *target_stream = NULL;
+    uint32_t disk_number_with_cd = 0;
+    int64_t disk_size = 0;
+    int64_t source_pos = 0;
+    int64_t target_pos = 0;
+    int64_t size = file_info->compressed_size;
+    int32_t err = MZ_OK;
+
+    /* Only unencrypted entries between two unsplit zip files can be copied as is */
+    if (!reader->zero_copy || size < MZ_ZIP_WRITER_COPY_MIN_SIZE)
+        return MZ_SUPPORT_ERROR;
+    if (file_info->flag & MZ_ZIP_FLAG_ENCRYPTED)
+        return MZ_SUPPORT_ERROR;
+    if (reader->file_stream == NULL ||
+        ((mz_stream *)reader->file_stream)->vtbl != mz_stream_fd_get_interface())
+        return MZ_SUPPORT_ERROR;
+    if (writer->file_stream == NULL || writer->split_stream == NULL ||
+        ((mz_stream *)writer->file_stream)->vtbl != mz_stream_fd_get_interface())
+        return MZ_SUPPORT_ERROR;
+    mz_zip_get_disk_number_with_cd(reader->zip_handle, &disk_number_with_cd);
+    if ((disk_number_with_cd > 0) || (file_info->disk_number > 0))
+        return MZ_SUPPORT_ERROR;
+    mz_stream_get_prop_int64(writer->split_stream, MZ_STREAM_PROP_DISK_SIZE, &disk_size);
+    if (disk_size > 0)
+        return MZ_SUPPORT_ERROR;
+
+    /* Entry data starts where the local headers left both zip streams */
+    err = mz_zip_get_stream(reader->zip_handle, &reader_stream);
+    if (err == MZ_OK)
+        err = mz_zip_get_stream(writer->zip_handle, &writer_stream);
+    if (err == MZ_OK) {
+        source_pos = mz_stream_tell(reader_stream);
+        target_pos = mz_stream_tell(writer_stream);
+        if (source_pos < 0 || target_pos < 0)
+            err = MZ_TELL_ERROR;
+    }
+
+    /* Update the progress at the beginning */
+    if (err == MZ_OK && writer->progress_cb != NULL)
+        mz_zip_writer_progress_update(handle, 0);
+
+    /* Seeking past the entry data flushes the buffered local header to the file */
+    if (err == MZ_OK)
+        err = mz_stream_seek(writer_stream, target_pos + size, MZ_SEEK_SET);
+
+    /* Copy with separate cursors so the positions of the zip streams are left alone */
+    mz_stream_fd_create(&source_stream);
+    mz_stream_fd_create(&target_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_attach(source_stream, reader->file_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_attach(target_stream, writer->file_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(source_stream, source_pos, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(target_stream, target_pos, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = mz_stream_fd_copy(target_stream, source_stream, size);
+
+    /* Nothing was copied so put the zip stream back for the buffered copy */
+    if (err == MZ_SUPPORT_ERROR && mz_stream_seek(writer_stream, target_pos, MZ_SEEK_SET) != MZ_OK)
+        err = MZ_SEEK_ERROR;
+
+    mz_stream_fd_delete(&target_stream);
+    mz_stream_fd_delete(&source_stream);
+
+    /* Update the progress at the end */
+    if (err == MZ_OK && writer->progress_cb != NULL)
+        mz_zip_writer_progress_update(handle, size);
+
+    return err;
+}
+#endif
+
 int32_t mz_zip_writer_copy_from_reader(void *handle, void *reader) {
     mz_zip_writer *writer = (mz_zip_writer *)handle;
     mz_zip_file *file_info = NULL;
@@ -1706,6 +2937,7 @@ int32_t mz_zip_writer_copy_from_reader(void *handle, void *reader) {
     uint32_t crc32 = 0;
     int32_t err = MZ_OK;
     uint8_t original_raw = 0;
+    uint8_t copied = 0;
     void *reader_zip_handle = NULL;
     void *writer_zip_handle = NULL;
 
@@ -1733,12 +2965,30 @@ int32_t mz_zip_writer_copy_from_reader(void *handle, void *reader) {
 
         err = mz_zip_writer_entry_open(writer, file_info);
 
+#ifndef MZ_ZIP_NO_CRYPTO
+        /* Hash of the raw data is never stored since the writer entry isn't closed */
+        if (writer->sha256 != NULL)
+            mz_crypt_sha_delete(&writer->sha256);
+#endif
+
         if ((err == MZ_OK) &&
             (mz_zip_attrib_is_dir(writer->file_info.external_fa, writer->file_info.version_madeby) != MZ_OK)) {
-            err = mz_zip_writer_add(writer, reader_zip_handle, mz_zip_entry_read);
+#ifndef _WIN32
+            err = mz_zip_writer_entry_copy_range(handle, (mz_zip_reader *)reader, file_info);
+            if (err == MZ_OK)
+                copied = 1;
+            else if (err == MZ_SUPPORT_ERROR)
+#endif
+                err = mz_zip_writer_add(writer, reader_zip_handle, mz_zip_entry_read);
         }
 
-        if (err == MZ_OK) {
+        if (err == MZ_OK && copied) {
+            /* Reader stream never saw the data so take the values from the central directory */
+            err = mz_zip_entry_read_close(reader_zip_handle, NULL, NULL, NULL);
+            if (err == MZ_OK)
+                err = mz_zip_entry_write_close(writer_zip_handle, file_info->crc,
+                    file_info->compressed_size, file_info->uncompressed_size);
+        } else if (err == MZ_OK) {
             err = mz_zip_entry_read_close(reader_zip_handle, &crc32, &compressed_size, &uncompressed_size);
             if (err == MZ_OK)
                 err = mz_zip_entry_write_close(writer_zip_handle, crc32, compressed_size, uncompressed_size);
@@ -1796,6 +3046,11 @@ void mz_zip_writer_set_compress_level(void *handle, int16_t compress_level) {
     writer->compress_level = compress_level;
 }
 
+void mz_zip_writer_set_compress_job_size(void *handle, int64_t compress_job_size) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    writer->compress_job_size = compress_job_size;
+}
+
 void mz_zip_writer_set_follow_links(void *handle, uint8_t follow_links) {
     mz_zip_writer *writer = (mz_zip_writer *)handle;
     writer->follow_links = follow_links;
@@ -1806,6 +3061,31 @@ void mz_zip_writer_set_store_links(void *handle, uint8_t store_links) {
     writer->store_links = store_links;
 }
 
+int32_t mz_zip_writer_set_buffer_size(void *handle, int32_t buffer_size) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    if (writer == NULL || buffer_size < 0)
+        return MZ_PARAM_ERROR;
+    if (writer->threads != NULL)
+        return MZ_PARAM_ERROR;
+    if (writer->buffer_size != buffer_size) {
+        if (writer->buffer != NULL)
+            MZ_FREE(writer->buffer);
+        writer->buffer = NULL;
+    }
+    writer->buffer_size = buffer_size;
+    return MZ_OK;
+}
+
+int32_t mz_zip_writer_set_thread_count(void *handle, int32_t thread_count) {
+    mz_zip_writer *writer = (mz_zip_writer *)handle;
+    if (writer == NULL || thread_count < 0)
+        return MZ_PARAM_ERROR;
+    if (writer->threads != NULL)
+        return MZ_PARAM_ERROR;
+    writer->thread_count = thread_count;
+    return MZ_OK;
+}
+
 void mz_zip_writer_set_zip_cd(void *handle, uint8_t zip_cd) {
     mz_zip_writer *writer = (mz_zip_writer *)handle;
     writer->zip_cd = zip_cd;
@@ -1904,17 +3184,18 @@ void *mz_zip_writer_create(void **handle) {
 #if defined(HAVE_WZAES)
         writer->aes = 1;
 #endif
-#if defined(HAVE_ZLIB) || defined(HAVE_LIBCOMP)
-        writer->compress_method = MZ_COMPRESS_METHOD_DEFLATE;
-#elif defined(HAVE_BZIP2)
-        writer->compress_method = MZ_COMPRESS_METHOD_BZIP2;
-#elif defined(HAVE_LZMA)
-        writer->compress_method = MZ_COMPRESS_METHOD_LZMA;
-#else
-        writer->compress_method = MZ_COMPRESS_METHOD_STORE;
-#endif
+        /* Use the first of these methods with a built-in or registered stream */
+        if (mz_zip_get_method(MZ_COMPRESS_METHOD_DEFLATE, NULL, NULL) == MZ_OK)
+            writer->compress_method = MZ_COMPRESS_METHOD_DEFLATE;
+        else if (mz_zip_get_method(MZ_COMPRESS_METHOD_BZIP2, NULL, NULL) == MZ_OK)
+            writer->compress_method = MZ_COMPRESS_METHOD_BZIP2;
+        else if (mz_zip_get_method(MZ_COMPRESS_METHOD_LZMA, NULL, NULL) == MZ_OK)
+            writer->compress_method = MZ_COMPRESS_METHOD_LZMA;
+        else
+            writer->compress_method = MZ_COMPRESS_METHOD_STORE;
         writer->compress_level = MZ_COMPRESS_LEVEL_BEST;
         writer->progress_cb_interval_ms = MZ_DEFAULT_PROGRESS_INTERVAL;
+        writer->cb_handle = writer;
     }
     if (handle != NULL)
         *handle = writer;
@@ -1936,6 +3217,9 @@ void mz_zip_writer_delete(void **handle) {
         writer->cert_data = NULL;
         writer->cert_data_size = 0;
 
+        if (writer->buffer != NULL)
+            MZ_FREE(writer->buffer);
+
         MZ_FREE(writer);
     }
     *handle = NULL;
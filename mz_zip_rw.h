@@ -39,6 +39,9 @@ int32_t mz_zip_reader_open_file_in_memory(void *handle, const char *path);
 int32_t mz_zip_reader_open_buffer(void *handle, uint8_t *buf, int32_t len, uint8_t copy);
 /* Opens zip file from memory buffer */
 
+int32_t mz_zip_reader_open_cursor(void *handle, void *shared_handle);
+/* Opens a cursor on a zip file opened by another reader without reading the central dir again */
+
 int32_t mz_zip_reader_close(void *handle);
 /* Closes the zip file */
 
@@ -97,6 +100,9 @@ int32_t mz_zip_reader_entry_save_file(void *handle, const char *path);
 int32_t mz_zip_reader_entry_save_buffer(void *handle, void *buf, int32_t len);
 /* Save the current entry to a memory buffer */
 
+int32_t mz_zip_reader_entry_save_buffer64(void *handle, void *buf, int64_t len);
+/* Decompress the current entry directly into a memory buffer of its uncompressed size */
+
 int32_t mz_zip_reader_entry_save_buffer_length(void *handle);
 /* Gets the length of the buffer required to save */
 
@@ -128,6 +134,24 @@ int32_t mz_zip_reader_get_comment(void *handle, const char **comment);
 int32_t mz_zip_reader_set_recover(void *handle, uint8_t recover);
 /* Sets the ability to recover the central dir by reading local file headers */
 
+int32_t mz_zip_reader_set_cd_index(void *handle, uint8_t cd_index);
+/* Sets the ability to decode the central dir into an index of entries */
+
+int32_t mz_zip_reader_set_cd_in_memory(void *handle, uint8_t cd_in_memory);
+/* Sets the ability to load the central dir into memory with a single read */
+
+int32_t mz_zip_reader_set_mmap(void *handle, uint8_t mmap_file);
+/* Sets whether or not zip files opened from a path are memory mapped */
+
+int32_t mz_zip_reader_set_zero_copy(void *handle, uint8_t zero_copy, uint8_t verify);
+/* Sets whether stored entries are saved to files by the kernel and whether they are verified */
+
+int32_t mz_zip_reader_set_thread_count(void *handle, int32_t thread_count);
+/* Sets the number of threads used to save all entries */
+
+int32_t mz_zip_reader_set_buffer_size(void *handle, int32_t buffer_size);
+/* Sets the size of the buffers used to read the zip file and its entries, 0 for default */
+
 void    mz_zip_reader_set_encoding(void *handle, int32_t encoding);
 /* Sets whether or not it should support a special character encoding in zip file names. */
 
@@ -240,6 +264,9 @@ void    mz_zip_writer_set_compress_method(void *handle, uint16_t compress_method
 void    mz_zip_writer_set_compress_level(void *handle, int16_t compress_level);
 /* Sets the compression level when adding files in zip */
 
+void    mz_zip_writer_set_compress_job_size(void *handle, int64_t compress_job_size);
+/* Sets the amount of data each thread compresses at a time when adding large files in zip */
+
 void    mz_zip_writer_set_follow_links(void *handle, uint8_t follow_links);
 /* Follow symbolic links when traversing directories and files to add */
 
@@ -249,6 +276,12 @@ void    mz_zip_writer_set_store_links(void *handle, uint8_t store_links);
 void    mz_zip_writer_set_zip_cd(void *handle, uint8_t zip_cd);
 /* Sets whether or not central directory should be zipped */
 
+int32_t mz_zip_writer_set_thread_count(void *handle, int32_t thread_count);
+/* Sets the number of threads used to compress files added to the zip */
+
+int32_t mz_zip_writer_set_buffer_size(void *handle, int32_t buffer_size);
+/* Sets the size of the buffers used to write the zip file and its entries, 0 for default */
+
 int32_t mz_zip_writer_set_certificate(void *handle, const char *cert_path, const char *cert_pwd);
 /* Sets the certificate and timestamp url to use for signing when adding files in zip */
 
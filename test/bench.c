@@ -0,0 +1,376 @@
+/* bench.c - Compression benchmark
+   part of the minizip-ng project
+
+   Copyright (C) 2010-2021 Nathan Moinvaziri
+     https://github.com/zlib-ng/minizip-ng
+
+   This program is distributed under the terms of the same license as zlib.
+   See the accompanying LICENSE file for the full text of the license.
+*/
+
+#include "mz.h"
+#include "mz_os.h"
+#include "mz_strm.h"
+#include "mz_strm_mem.h"
+#include "mz_strm_os.h"
+#include "mz_zip.h"
+
+#include <stdio.h> /* printf */
+
+/***************************************************************************/
+
+typedef struct bench_opt_s {
+    uint16_t    compress_method;
+    int16_t     compress_level;
+    int32_t     thread_count;
+    int64_t     job_size;
+    int32_t     buffer_size;
+    uint8_t     buffer_sweep;
+    int32_t     data_size;
+    int32_t     iterations;
+} bench_opt;
+
+/***************************************************************************/
+
+int32_t bench_help(void)
+{
+    printf("Usage: bench [-0 to -9][-b|-m|-n|-t][-s 64][-j 8][-g 4096][-k 64][-u][-r 3] [file]\n\n" \
+           "  -1  Compress faster\n" \
+           "  -9  Compress better\n" \
+           "  -s  Size in MB of generated data when no file is given\n" \
+           "  -j  Maximum number of threads\n" \
+           "  -g  Job size in KB for each compress thread\n" \
+           "  -k  Buffer size in KB for each stream\n" \
+           "  -u  Double the buffer size each run from 4 KB to 1 MB\n" \
+           "  -r  Number of runs for each thread count\n" \
+           "  -b  BZIP2 compression\n" \
+           "  -m  LZMA compression\n" \
+           "  -n  XZ compression\n" \
+           "  -t  ZSTD compression\n\n");
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
+static uint8_t *bench_generate(int32_t size)
+{
+    uint8_t *data = NULL;
+    uint32_t seed = 1;
+    int32_t i = 0;
+
+    data = (uint8_t *)MZ_ALLOC(size);
+    if (data == NULL)
+        return NULL;
+
+    /* Text-like data that compresses about as well as source code or logs */
+    for (i = 0; i < size; i += 1)
+    {
+        if ((i % 64) == 0)
+            seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)('a' + ((seed >> 16) + (i % 13)) % 26);
+        if ((seed & 0x0f000000) == 0 && (i % 64) == 63)
+            data[i] = '\n';
+    }
+    return data;
+}
+
+static uint8_t *bench_load(const char *path, int32_t *size)
+{
+    void *stream = NULL;
+    uint8_t *data = NULL;
+    int64_t file_size = mz_os_get_file_size(path);
+
+    if (file_size <= 0 || file_size > INT32_MAX)
+        return NULL;
+
+    data = (uint8_t *)MZ_ALLOC((size_t)file_size);
+    if (data == NULL)
+        return NULL;
+
+    mz_stream_os_create(&stream);
+    if (mz_stream_os_open(stream, path, MZ_OPEN_MODE_READ) != MZ_OK ||
+        mz_stream_os_read(stream, data, (int32_t)file_size) != (int32_t)file_size)
+    {
+        MZ_FREE(data);
+        data = NULL;
+    }
+    mz_stream_os_close(stream);
+    mz_stream_os_delete(&stream);
+
+    *size = (int32_t)file_size;
+    return data;
+}
+
+static int32_t bench_compress(bench_opt *options, int32_t thread_count, const uint8_t *data,
+    void *mem_stream)
+{
+    mz_zip_file file_info;
+    void *zip_handle = NULL;
+    int32_t written = 0;
+    int32_t chunk = 0;
+    int32_t max_chunk = UINT16_MAX;
+    int32_t err = MZ_OK;
+
+    if (options->buffer_size > 0)
+        max_chunk = options->buffer_size;
+
+    memset(&file_info, 0, sizeof(file_info));
+    file_info.version_madeby = MZ_VERSION_MADEBY;
+    file_info.compression_method = options->compress_method;
+    file_info.filename = "bench.bin";
+    file_info.uncompressed_size = options->data_size;
+    file_info.modified_date = time(NULL);
+
+    mz_zip_create(&zip_handle);
+    mz_zip_set_compress_threads(zip_handle, thread_count);
+    mz_zip_set_compress_job_size(zip_handle, options->job_size);
+    mz_zip_set_buffer_size(zip_handle, options->buffer_size);
+
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    if (err == MZ_OK)
+        err = mz_zip_entry_write_open(zip_handle, &file_info, options->compress_level, 0, NULL);
+
+    /* Write in the same sized chunks as the zip writer */
+    while (err == MZ_OK && written < options->data_size)
+    {
+        chunk = options->data_size - written;
+        if (chunk > max_chunk)
+            chunk = max_chunk;
+        if (mz_zip_entry_write(zip_handle, data + written, chunk) != chunk)
+            err = MZ_WRITE_ERROR;
+        written += chunk;
+    }
+
+    if (err == MZ_OK)
+        err = mz_zip_entry_close(zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_close(zip_handle);
+
+    mz_zip_delete(&zip_handle);
+    return err;
+}
+
+static int32_t bench_decompress(bench_opt *options, int32_t thread_count, uint8_t *data,
+    void *mem_stream)
+{
+    void *zip_handle = NULL;
+    int32_t read = 0;
+    int32_t total = 0;
+    int32_t chunk = UINT16_MAX;
+    int32_t err = MZ_OK;
+
+    if (options->buffer_size > 0)
+        chunk = options->buffer_size;
+
+    mz_zip_create(&zip_handle);
+    mz_zip_set_compress_threads(zip_handle, thread_count);
+    mz_zip_set_buffer_size(zip_handle, options->buffer_size);
+
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_entry_read_open(zip_handle, 0, NULL);
+
+    /* Read in the same sized chunks as the data was written */
+    while (err == MZ_OK && total < options->data_size)
+    {
+        if (chunk > options->data_size - total)
+            chunk = options->data_size - total;
+        read = mz_zip_entry_read(zip_handle, data + total, chunk);
+        if (read <= 0)
+            err = (read < 0) ? read : MZ_DATA_ERROR;
+        else
+            total += read;
+    }
+
+    if (err == MZ_OK)
+        err = mz_zip_entry_close(zip_handle);
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    return err;
+}
+
+static int32_t bench_run(bench_opt *options, int32_t thread_count, const uint8_t *data)
+{
+    void *mem_stream = NULL;
+    uint8_t *verify = NULL;
+    int64_t compressed_size = 0;
+    uint64_t start_ms = 0;
+    uint64_t elapsed_ms = 0;
+    uint64_t best_ms = 0;
+    uint64_t best_read_ms = 0;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+
+    verify = (uint8_t *)MZ_ALLOC(options->data_size > 0 ? options->data_size : 1);
+    if (verify == NULL)
+        return MZ_MEM_ERROR;
+
+    /* Report the fastest run to reduce noise from other processes */
+    for (i = 0; err == MZ_OK && i < options->iterations; i += 1)
+    {
+        mz_stream_mem_create(&mem_stream);
+        mz_stream_mem_set_grow_size(mem_stream, 16 * 1024 * 1024);
+        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+        start_ms = mz_os_ms_time();
+        err = bench_compress(options, thread_count, data, mem_stream);
+        elapsed_ms = mz_os_ms_time() - start_ms;
+        if (i == 0 || elapsed_ms < best_ms)
+            best_ms = elapsed_ms;
+
+        mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_END);
+        compressed_size = mz_stream_mem_tell(mem_stream);
+
+        if (err == MZ_OK)
+        {
+            start_ms = mz_os_ms_time();
+            err = bench_decompress(options, thread_count, verify, mem_stream);
+            elapsed_ms = mz_os_ms_time() - start_ms;
+            if (i == 0 || elapsed_ms < best_read_ms)
+                best_read_ms = elapsed_ms;
+        }
+        if (err == MZ_OK && memcmp(verify, data, options->data_size) != 0)
+            err = MZ_DATA_ERROR;
+
+        mz_stream_mem_delete(&mem_stream);
+    }
+
+    MZ_FREE(verify);
+
+    if (err != MZ_OK)
+    {
+        printf("%8" PRId32 " threads %8" PRId32 " KB  failed (%" PRId32 ")\n",
+            thread_count, options->buffer_size / 1024, err);
+        return err;
+    }
+
+    if (best_ms == 0)
+        best_ms = 1;
+    if (best_read_ms == 0)
+        best_read_ms = 1;
+
+    printf("%8" PRId32 " threads %8" PRId32 " KB %10.1f MB/s %10.1f MB/s %12" PRId64 " bytes %6.2f%%\n",
+        thread_count, options->buffer_size / 1024,
+        (options->data_size / (1024.0 * 1024.0)) / (best_ms / 1000.0),
+        (options->data_size / (1024.0 * 1024.0)) / (best_read_ms / 1000.0),
+        compressed_size, (compressed_size * 100.0) / (options->data_size > 0 ? options->data_size : 1));
+    return MZ_OK;
+}
+
+/***************************************************************************/
+
+#if !defined(MZ_ZIP_NO_MAIN)
+int main(int argc, const char *argv[])
+{
+    bench_opt options;
+    uint8_t *data = NULL;
+    const char *path = NULL;
+    int32_t thread_count = 0;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+    char c = 0;
+
+
+    memset(&options, 0, sizeof(options));
+
+    options.compress_method = MZ_COMPRESS_METHOD_DEFLATE;
+    options.compress_level = MZ_COMPRESS_LEVEL_DEFAULT;
+    options.thread_count = 8;
+    options.data_size = 64 * 1024 * 1024;
+    options.iterations = 3;
+
+    /* Parse command line options */
+    for (i = 1; i < argc; i += 1)
+    {
+        if (argv[i][0] != '-')
+        {
+            path = argv[i];
+            continue;
+        }
+
+        c = argv[i][1];
+        if ((c >= '0') && (c <= '9'))
+        {
+            options.compress_level = (c - '0');
+            if (options.compress_level == 0)
+                options.compress_method = MZ_COMPRESS_METHOD_STORE;
+        }
+        else if ((c == 'b') || (c == 'B'))
+            options.compress_method = MZ_COMPRESS_METHOD_BZIP2;
+        else if ((c == 'm') || (c == 'M'))
+            options.compress_method = MZ_COMPRESS_METHOD_LZMA;
+        else if ((c == 'n') || (c == 'N'))
+            options.compress_method = MZ_COMPRESS_METHOD_XZ;
+        else if ((c == 't') || (c == 'T'))
+            options.compress_method = MZ_COMPRESS_METHOD_ZSTD;
+        else if (((c == 's') || (c == 'S')) && (i + 1 < argc))
+            options.data_size = (int32_t)atoi(argv[++i]) * 1024 * 1024;
+        else if (((c == 'j') || (c == 'J')) && (i + 1 < argc))
+            options.thread_count = (int32_t)atoi(argv[++i]);
+        else if (((c == 'g') || (c == 'G')) && (i + 1 < argc))
+            options.job_size = (int64_t)atoi(argv[++i]) * 1024;
+        else if (((c == 'k') || (c == 'K')) && (i + 1 < argc))
+            options.buffer_size = (int32_t)atoi(argv[++i]) * 1024;
+        else if ((c == 'u') || (c == 'U'))
+            options.buffer_sweep = 1;
+        else if (((c == 'r') || (c == 'R')) && (i + 1 < argc))
+            options.iterations = (int32_t)atoi(argv[++i]);
+        else
+        {
+            bench_help();
+            return 0;
+        }
+    }
+
+    if (options.thread_count < 1 || options.iterations < 1 || options.data_size < 0 ||
+        options.buffer_size < 0)
+    {
+        bench_help();
+        return 0;
+    }
+
+    if (path != NULL)
+        data = bench_load(path, &options.data_size);
+    else
+        data = bench_generate(options.data_size);
+
+    if (data == NULL)
+    {
+        printf("Error loading data\n");
+        return MZ_MEM_ERROR;
+    }
+
+    printf("Compressing %" PRId32 " bytes with method %" PRIu16 " level %" PRId16 "\n",
+        options.data_size, options.compress_method, options.compress_level);
+    printf("%16s %11s %15s %15s\n", "", "buffer", "compress", "decompress");
+
+    if (options.buffer_sweep)
+    {
+        /* Double the buffer size each run to show how throughput changes with it */
+        for (options.buffer_size = 4 * 1024; err == MZ_OK && options.buffer_size <= 1024 * 1024;
+             options.buffer_size *= 2)
+            err = bench_run(&options, options.thread_count, data);
+
+        MZ_FREE(data);
+        return err;
+    }
+
+    /* Double the threads each run to show how compression scales */
+    for (thread_count = 1; err == MZ_OK; thread_count *= 2)
+    {
+        if (thread_count > options.thread_count)
+            thread_count = options.thread_count;
+
+        err = bench_run(&options, thread_count, data);
+
+        if (thread_count == options.thread_count)
+            break;
+    }
+
+    MZ_FREE(data);
+    return err;
+}
+#endif
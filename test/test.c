@@ -15,13 +15,22 @@
 #include "mz_crypt.h"
 #include "mz_os.h"
 #include "mz_strm.h"
+#include "mz_strm_async.h"
+#include "mz_strm_buf.h"
 #ifdef HAVE_BZIP2
 #include "mz_strm_bzip.h"
 #endif
+#ifdef HAVE_LZMA
+#include "mz_strm_lzma.h"
+#endif
 #ifdef HAVE_PKCRYPT
 #include "mz_strm_pkcrypt.h"
 #endif
+#ifndef _WIN32
+#include "mz_strm_fd.h"
+#endif
 #include "mz_strm_mem.h"
+#include "mz_strm_mmap.h"
 #include "mz_strm_os.h"
 #ifdef HAVE_WZAES
 #include "mz_strm_wzaes.h"
@@ -30,6 +39,7 @@
 #include "mz_strm_zlib.h"
 #endif
 #include "mz_zip.h"
+#include "mz_zip_rw.h"
 
 #include <stdio.h> /* printf, snprintf */
 
@@ -323,6 +333,120 @@ int test_stream_wzaes(void)
 
     return test_encrypt("aes", mz_stream_wzaes_create, "hello");
 }
+
+static int32_t test_stream_wzaes_hmac_run(const uint8_t *data, int32_t data_size, int32_t write_thread,
+    int32_t read_thread, int32_t corrupt_pos)
+{
+    void *mem_stream = NULL;
+    void *wzaes_stream = NULL;
+    uint8_t *buf = NULL;
+    uint8_t *ptr = NULL;
+    int64_t total_out = 0;
+    int32_t chunk_size = 100000;
+    int32_t chunk = 0;
+    int32_t pos = 0;
+    int32_t err = MZ_OK;
+
+    buf = (uint8_t *)malloc(data_size);
+    if (buf == NULL)
+        return MZ_MEM_ERROR;
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_stream_wzaes_create(&wzaes_stream);
+    mz_stream_set_base(wzaes_stream, mem_stream);
+    mz_stream_set_prop_int64(wzaes_stream, MZ_STREAM_PROP_HMAC_THREAD, write_thread);
+
+    err = mz_stream_open(wzaes_stream, "hello", MZ_OPEN_MODE_WRITE);
+    for (pos = 0; err == MZ_OK && pos < data_size; pos += chunk)
+    {
+        chunk = data_size - pos;
+        if (chunk > chunk_size)
+            chunk = chunk_size;
+        if (mz_stream_write(wzaes_stream, data + pos, chunk) != chunk)
+            err = MZ_WRITE_ERROR;
+    }
+    if (err == MZ_OK)
+        err = mz_stream_close(wzaes_stream);
+    mz_stream_get_prop_int64(wzaes_stream, MZ_STREAM_PROP_TOTAL_OUT, &total_out);
+    mz_stream_wzaes_delete(&wzaes_stream);
+
+    if (err == MZ_OK && corrupt_pos >= 0)
+    {
+        /* Flip a bit in the ciphertext after the header */
+        mz_stream_mem_get_buffer(mem_stream, (const void **)&ptr);
+        ptr[MZ_AES_HEADER_SIZE(MZ_AES_ENCRYPTION_MODE_256) + corrupt_pos] ^= 1;
+    }
+
+    mz_stream_wzaes_create(&wzaes_stream);
+    mz_stream_set_base(wzaes_stream, mem_stream);
+    mz_stream_set_prop_int64(wzaes_stream, MZ_STREAM_PROP_HMAC_THREAD, read_thread);
+    mz_stream_set_prop_int64(wzaes_stream, MZ_STREAM_PROP_TOTAL_IN_MAX, total_out);
+
+    mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = mz_stream_open(wzaes_stream, "hello", MZ_OPEN_MODE_READ);
+    for (pos = 0; err == MZ_OK && pos < data_size; pos += chunk)
+    {
+        chunk = data_size - pos;
+        if (chunk > chunk_size)
+            chunk = chunk_size;
+        if (mz_stream_read(wzaes_stream, buf + pos, chunk) != chunk)
+            err = MZ_READ_ERROR;
+    }
+    if (err == MZ_OK)
+        err = mz_stream_close(wzaes_stream);
+    if (err == MZ_OK && corrupt_pos < 0 && memcmp(buf, data, data_size) != 0)
+        err = MZ_DATA_ERROR;
+
+    mz_stream_wzaes_delete(&wzaes_stream);
+    mz_stream_mem_delete(&mem_stream);
+    free(buf);
+    return err;
+}
+
+int32_t test_stream_wzaes_hmac_thread(void)
+{
+    uint8_t *data = NULL;
+    int32_t data_size = 3 * 1024 * 1024 + 17;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+    printf("Wzaes hmac thread.. ");
+
+    data = (uint8_t *)malloc(data_size);
+    if (data == NULL)
+        return MZ_MEM_ERROR;
+    for (i = 0; i < data_size; i += 1)
+        data[i] = (uint8_t)(i ^ (i >> 9));
+
+    /* Authentication codes must match whichever thread computed them */
+    err = test_stream_wzaes_hmac_run(data, data_size, 1, 0, -1);
+    if (err == MZ_OK)
+        err = test_stream_wzaes_hmac_run(data, data_size, 0, 1, -1);
+    if (err == MZ_OK)
+        err = test_stream_wzaes_hmac_run(data, data_size, 1, 1, -1);
+    if (err == MZ_OK)
+        err = test_stream_wzaes_hmac_run(data, 1000, 1, 1, -1);
+
+    /* Tampered ciphertext must fail on close, before and after the thread starts */
+    if (err == MZ_OK && test_stream_wzaes_hmac_run(data, data_size, 0, 1, 1000) != MZ_CRC_ERROR)
+        err = MZ_CRC_ERROR;
+    if (err == MZ_OK && test_stream_wzaes_hmac_run(data, data_size, 0, 1, data_size - 1) != MZ_CRC_ERROR)
+        err = MZ_CRC_ERROR;
+
+    free(data);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
 #endif
 #ifdef HAVE_ZLIB
 int32_t test_stream_zlib(void)
@@ -441,6 +565,233 @@ int32_t test_stream_zlib_mem(void)
 
     return err;
 }
+
+static int32_t test_stream_zlib_threads_run(const uint8_t *data, int32_t data_size, int32_t thread_count,
+    int64_t job_size)
+{
+    void *mem_stream = NULL;
+    void *zlib_stream = NULL;
+    uint8_t *uncompressed = NULL;
+    int64_t total_out = 0;
+    int32_t read = 0;
+    int32_t err = MZ_OK;
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    /* Compress in small writes so blocks are split across calls */
+    mz_stream_zlib_create(&zlib_stream);
+    mz_stream_set_base(zlib_stream, mem_stream);
+    mz_stream_set_prop_int64(zlib_stream, MZ_STREAM_PROP_COMPRESS_THREADS, thread_count);
+    mz_stream_set_prop_int64(zlib_stream, MZ_STREAM_PROP_COMPRESS_JOB_SIZE, job_size);
+
+    err = mz_stream_open(zlib_stream, NULL, MZ_OPEN_MODE_WRITE);
+    while (err == MZ_OK && read < data_size)
+    {
+        int32_t chunk = data_size - read;
+        if (chunk > 100000)
+            chunk = 100000;
+        if (mz_stream_write(zlib_stream, data + read, chunk) != chunk)
+            err = MZ_WRITE_ERROR;
+        read += chunk;
+    }
+    if (mz_stream_close(zlib_stream) != MZ_OK && err == MZ_OK)
+        err = MZ_CLOSE_ERROR;
+
+    mz_stream_get_prop_int64(zlib_stream, MZ_STREAM_PROP_TOTAL_OUT, &total_out);
+    mz_stream_delete(&zlib_stream);
+
+    /* Decompress as a single deflate stream */
+    uncompressed = (uint8_t *)MZ_ALLOC(data_size + 1);
+    if (err == MZ_OK && uncompressed == NULL)
+        err = MZ_MEM_ERROR;
+
+    if (err == MZ_OK)
+    {
+        mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_SET);
+
+        mz_stream_zlib_create(&zlib_stream);
+        mz_stream_set_base(zlib_stream, mem_stream);
+        mz_stream_set_prop_int64(zlib_stream, MZ_STREAM_PROP_TOTAL_IN_MAX, total_out);
+
+        err = mz_stream_open(zlib_stream, NULL, MZ_OPEN_MODE_READ);
+        if (err == MZ_OK)
+        {
+            read = mz_stream_read(zlib_stream, uncompressed, data_size + 1);
+            if (read != data_size || memcmp(uncompressed, data, data_size) != 0)
+                err = MZ_DATA_ERROR;
+            mz_stream_close(zlib_stream);
+        }
+        mz_stream_delete(&zlib_stream);
+    }
+
+    if (uncompressed != NULL)
+        MZ_FREE(uncompressed);
+    mz_stream_mem_delete(&mem_stream);
+    return err;
+}
+
+int32_t test_stream_zlib_threads(void)
+{
+    uint8_t *data = NULL;
+    int32_t data_size = 3 * 1024 * 1024 + 12345;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+    uint32_t seed = 1;
+
+
+    printf("Zlib stream threads.. ");
+
+    data = (uint8_t *)MZ_ALLOC(data_size);
+    if (data == NULL)
+        return MZ_MEM_ERROR;
+
+    /* Repetitive data with matches that cross block boundaries */
+    for (i = 0; i < data_size; i += 1)
+    {
+        if ((i % 4096) == 0)
+            seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)('a' + ((seed >> 16) + (i % 61)) % 26);
+    }
+
+    err = test_stream_zlib_threads_run(data, data_size, 4, 0);
+    if (err == MZ_OK)
+        err = test_stream_zlib_threads_run(data, 1024 * 1024, 4, 0);
+    if (err == MZ_OK)
+        err = test_stream_zlib_threads_run(data, 1000, 4, 0);
+    if (err == MZ_OK)
+        err = test_stream_zlib_threads_run(data, 0, 4, 0);
+    /* Blocks smaller than the deflate window */
+    if (err == MZ_OK)
+        err = test_stream_zlib_threads_run(data, data_size, 3, 20000);
+
+    MZ_FREE(data);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+#endif
+
+#ifdef HAVE_LZMA
+static int32_t test_stream_lzma_threads_run(const uint8_t *data, int32_t data_size, int32_t thread_count,
+    int64_t job_size, int64_t memory_limit)
+{
+    void *mem_stream = NULL;
+    void *lzma_stream = NULL;
+    uint8_t *uncompressed = NULL;
+    int64_t total_out = 0;
+    int32_t read = 0;
+    int32_t err = MZ_OK;
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_stream_lzma_create(&lzma_stream);
+    mz_stream_set_base(lzma_stream, mem_stream);
+    mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_COMPRESS_METHOD, MZ_COMPRESS_METHOD_XZ);
+    mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_COMPRESS_LEVEL, 1);
+    mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_COMPRESS_THREADS, thread_count);
+    mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_COMPRESS_JOB_SIZE, job_size);
+    mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_MEMORY_LIMIT, memory_limit);
+
+    err = mz_stream_open(lzma_stream, NULL, MZ_OPEN_MODE_WRITE);
+    while (err == MZ_OK && read < data_size)
+    {
+        int32_t chunk = data_size - read;
+        if (chunk > 100000)
+            chunk = 100000;
+        if (mz_stream_write(lzma_stream, data + read, chunk) != chunk)
+            err = MZ_WRITE_ERROR;
+        read += chunk;
+    }
+    if (mz_stream_close(lzma_stream) != MZ_OK && err == MZ_OK)
+        err = MZ_CLOSE_ERROR;
+
+    mz_stream_get_prop_int64(lzma_stream, MZ_STREAM_PROP_TOTAL_OUT, &total_out);
+    mz_stream_delete(&lzma_stream);
+
+    /* Decompress with the same number of threads */
+    uncompressed = (uint8_t *)MZ_ALLOC(data_size + 1);
+    if (err == MZ_OK && uncompressed == NULL)
+        err = MZ_MEM_ERROR;
+
+    if (err == MZ_OK)
+    {
+        mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_SET);
+
+        mz_stream_lzma_create(&lzma_stream);
+        mz_stream_set_base(lzma_stream, mem_stream);
+        mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_COMPRESS_METHOD, MZ_COMPRESS_METHOD_XZ);
+        mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_COMPRESS_THREADS, thread_count);
+        mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_MEMORY_LIMIT, memory_limit);
+        mz_stream_set_prop_int64(lzma_stream, MZ_STREAM_PROP_TOTAL_IN_MAX, total_out);
+
+        err = mz_stream_open(lzma_stream, NULL, MZ_OPEN_MODE_READ);
+        if (err == MZ_OK)
+        {
+            read = mz_stream_read(lzma_stream, uncompressed, data_size + 1);
+            if (read != data_size || memcmp(uncompressed, data, data_size) != 0)
+                err = MZ_DATA_ERROR;
+            mz_stream_close(lzma_stream);
+        }
+        mz_stream_delete(&lzma_stream);
+    }
+
+    if (uncompressed != NULL)
+        MZ_FREE(uncompressed);
+    mz_stream_mem_delete(&mem_stream);
+    return err;
+}
+
+int32_t test_stream_lzma_threads(void)
+{
+    uint8_t *data = NULL;
+    int32_t data_size = 2 * 1024 * 1024 + 12345;
+    int32_t err = MZ_OK;
+    int32_t i = 0;
+    uint32_t seed = 1;
+
+
+    printf("Lzma stream threads.. ");
+
+    data = (uint8_t *)MZ_ALLOC(data_size);
+    if (data == NULL)
+        return MZ_MEM_ERROR;
+
+    for (i = 0; i < data_size; i += 1)
+    {
+        if ((i % 4096) == 0)
+            seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)('a' + ((seed >> 16) + (i % 61)) % 26);
+    }
+
+    /* Small blocks so the stream is split between threads */
+    err = test_stream_lzma_threads_run(data, data_size, 4, 256 * 1024, 0);
+    if (err == MZ_OK)
+        err = test_stream_lzma_threads_run(data, 1000, 4, 256 * 1024, 0);
+    if (err == MZ_OK)
+        err = test_stream_lzma_threads_run(data, 0, 4, 0, 0);
+    /* Memory limit too low for more than one thread */
+    if (err == MZ_OK)
+        err = test_stream_lzma_threads_run(data, data_size, 4, 256 * 1024, 1);
+
+    MZ_FREE(data);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
 #endif
 
 /***************************************************************************/
@@ -459,145 +810,2576 @@ int32_t test_stream_find_run(char *name, int32_t count, const uint8_t *find, int
     if (find == NULL || find_size == 0 || find_cb == NULL)
         return MZ_PARAM_ERROR;
 
-    for (i = 0; i < count; i += 1)
+    for (i = 0; i < count; i += 1)
+    {
+#if 1
+        mz_stream_mem_create(&mem_stream);
+        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+        for (x = 0; x < find_size; x += 1)
+            mz_stream_write_uint8(mem_stream, find[x]);
+        for (x = 0; x < i; x += 1)
+            mz_stream_write_uint8(mem_stream, 0);
+
+        if (find_cb == mz_stream_find)
+            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+
+        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size, &position);
+        last_pos = mz_stream_tell(mem_stream);
+        mz_stream_mem_delete(&mem_stream);
+
+#ifdef TEST_VERBOSE
+        printf("Find postzero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
+            name, find_size, position, (position == 0));
+#endif
+
+        if (position != 0 || last_pos != position)
+            break;
+#endif
+        mz_stream_mem_create(&mem_stream);
+        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+        for (x = 0; x < i; x += 1)
+            mz_stream_write_uint8(mem_stream, 0);
+        for (x = 0; x < find_size; x += 1)
+            mz_stream_write_uint8(mem_stream, find[x]);
+
+        if (find_cb == mz_stream_find)
+            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+
+        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size, &position);
+        last_pos = mz_stream_tell(mem_stream);
+        mz_stream_mem_delete(&mem_stream);
+
+#ifdef TEST_VERBOSE
+        printf("Find prezero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
+            name, find_size, position, (position == i));
+#endif
+
+        if (position != i || last_pos != position)
+            break;
+
+        mz_stream_mem_create(&mem_stream);
+        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+        for (x = 0; x < i; x += 1)
+            mz_stream_write_uint8(mem_stream, 0);
+        for (x = 0; x < find_size; x += 1)
+            mz_stream_write_uint8(mem_stream, find[x]);
+        for (x = 0; x < i; x += 1)
+            mz_stream_write_uint8(mem_stream, 0);
+
+        if (find_cb == mz_stream_find)
+            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+
+        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size + i, &position);
+        last_pos = mz_stream_tell(mem_stream);
+        mz_stream_mem_delete(&mem_stream);
+
+#ifdef TEST_VERBOSE
+        printf("Find equalzero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
+            name, find_size, position, (position == i));
+#endif
+
+        if (position != i || last_pos != position)
+            break;
+
+        mz_stream_mem_create(&mem_stream);
+        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+        for (x = 0; x < i; x += 1)
+            mz_stream_write_uint8(mem_stream, 0);
+        for (x = 0; x < find_size; x += 1)
+            mz_stream_write_uint8(mem_stream, find[x]);
+        for (x = 0; x < i; x += 1)
+            mz_stream_write_uint8(mem_stream, 0);
+        mz_stream_write_uint8(mem_stream, 0);
+
+        if (find_cb == mz_stream_find)
+            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+
+        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size + i + 1, &position);
+        last_pos = mz_stream_tell(mem_stream);
+        mz_stream_mem_delete(&mem_stream);
+
+#ifdef TEST_VERBOSE
+        printf("Find unequalzero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
+            name, find_size, position, (position == i));
+#endif
+
+        if (position != i || last_pos != position)
+            break;
+    }
+
+    return err;
+}
+
+int32_t test_stream_find(void)
+{
+    int32_t c = 1;
+    int32_t err = MZ_OK;
+    char *find = "0123456789";
+
+    printf("Find stream.. ");
+    for (c = 1; c < (int32_t)strlen(find); c += 1)
+    {
+        err = test_stream_find_run("forward", 2096, (uint8_t *)find, c, mz_stream_find);
+        if (err != MZ_OK)
+            return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+int32_t test_stream_find_reverse(void)
+{
+    int32_t c = 1;
+    int32_t err = MZ_OK;
+    char *find = "0123456789";
+
+    printf("Find reverse stream.. ");
+    for (c = 1; c < (int32_t)strlen(find); c += 1)
+    {
+        err = test_stream_find_run("backward", 2096, (uint8_t *)find, c, mz_stream_find_reverse);
+        if (err != MZ_OK)
+            return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+int32_t test_stream_mmap(void)
+{
+    void *os_stream = NULL;
+    void *mmap_stream = NULL;
+    const void *mapped = NULL;
+    const char *path = "test_mmap.bin";
+    const uint8_t find[4] = { 0x50, 0x4b, 0x05, 0x06 };
+    uint8_t buf[256];
+    int64_t position = 0;
+    int32_t size = 70000;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+    printf("Mmap stream.. ");
+
+    mz_stream_os_create(&os_stream);
+    err = mz_stream_os_open(os_stream, path, MZ_OPEN_MODE_CREATE | MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < size; i += 1)
+    {
+        if (i >= 65000 && i < 65000 + (int32_t)sizeof(find))
+            err = mz_stream_write_uint8(os_stream, find[i - 65000]);
+        else
+            err = mz_stream_write_uint8(os_stream, (uint8_t)i);
+    }
+    mz_stream_os_close(os_stream);
+    mz_stream_os_delete(&os_stream);
+
+    mz_stream_mmap_create(&mmap_stream);
+    if (err == MZ_OK && mz_stream_mmap_open(mmap_stream, path, MZ_OPEN_MODE_WRITE) != MZ_OPEN_ERROR)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = mz_stream_mmap_open(mmap_stream, path, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK && mz_stream_mmap_read(mmap_stream, buf, sizeof(buf)) != sizeof(buf))
+        err = MZ_READ_ERROR;
+    if (err == MZ_OK && (buf[0] != 0 || buf[255] != 255 || mz_stream_mmap_tell(mmap_stream) != sizeof(buf)))
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = mz_stream_find(mmap_stream, find, sizeof(find), size, &position);
+    if (err == MZ_OK && position != 65000)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = mz_stream_mmap_seek(mmap_stream, 0, MZ_SEEK_END);
+    if (err == MZ_OK && mz_stream_mmap_tell(mmap_stream) != size)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && mz_stream_mmap_read(mmap_stream, buf, sizeof(buf)) != 0)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && mz_stream_mmap_seek(mmap_stream, 1, MZ_SEEK_CUR) != MZ_SEEK_ERROR)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = mz_stream_find_reverse(mmap_stream, find, sizeof(find), size, &position);
+    if (err == MZ_OK && position != 65000)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = mz_stream_mmap_get_buffer(mmap_stream, &mapped);
+    if (err == MZ_OK && memcmp((const uint8_t *)mapped + 65000, find, sizeof(find)) != 0)
+        err = MZ_INTERNAL_ERROR;
+    mz_stream_mmap_close(mmap_stream);
+    mz_stream_mmap_delete(&mmap_stream);
+
+    mz_os_unlink(path);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+#ifndef _WIN32
+int32_t test_stream_fd(void)
+{
+    void *fd_stream = NULL;
+    void *cursor1 = NULL;
+    void *cursor2 = NULL;
+    const char *path = "test_fd.bin";
+    uint8_t buf[4096];
+    uint8_t value1 = 0;
+    uint8_t value2 = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+    printf("Fd stream.. ");
+
+    for (i = 0; i < (int32_t)sizeof(buf); i += 1)
+        buf[i] = (uint8_t)(i * 7);
+
+    mz_stream_fd_create(&fd_stream);
+    err = mz_stream_fd_open(fd_stream, path, MZ_OPEN_MODE_CREATE | MZ_OPEN_MODE_WRITE);
+    if (err == MZ_OK && mz_stream_fd_write(fd_stream, buf, sizeof(buf)) != sizeof(buf))
+        err = MZ_WRITE_ERROR;
+    mz_stream_fd_close(fd_stream);
+
+    /* Append to the end of the existing file */
+    if (err == MZ_OK)
+        err = mz_stream_fd_open(fd_stream, path, MZ_OPEN_MODE_APPEND | MZ_OPEN_MODE_WRITE);
+    if (err == MZ_OK && mz_stream_fd_tell(fd_stream) != sizeof(buf))
+        err = MZ_TELL_ERROR;
+    if (err == MZ_OK)
+        err = mz_stream_write_uint8(fd_stream, 0xaa);
+    mz_stream_fd_close(fd_stream);
+
+    if (err == MZ_OK)
+        err = mz_stream_fd_open(fd_stream, path, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(fd_stream, 0, MZ_SEEK_END);
+    if (err == MZ_OK && mz_stream_fd_tell(fd_stream) != sizeof(buf) + 1)
+        err = MZ_TELL_ERROR;
+
+    /* Cursors on the same descriptor keep their own positions */
+    mz_stream_fd_create(&cursor1);
+    mz_stream_fd_create(&cursor2);
+    if (err == MZ_OK)
+        err = mz_stream_fd_attach(cursor1, fd_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_attach(cursor2, fd_stream);
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(cursor2, 100, MZ_SEEK_SET);
+    for (i = 0; err == MZ_OK && i < 100; i += 1)
+    {
+        err = mz_stream_read_uint8(cursor1, &value1);
+        if (err == MZ_OK)
+            err = mz_stream_read_uint8(cursor2, &value2);
+        if (err == MZ_OK && (value1 != buf[i] || value2 != buf[i + 100]))
+            err = MZ_INTERNAL_ERROR;
+    }
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(cursor1, -1, MZ_SEEK_END);
+    if (err == MZ_OK)
+        err = mz_stream_read_uint8(cursor1, &value1);
+    if (err == MZ_OK && (value1 != 0xaa || mz_stream_fd_read(cursor1, buf, 1) != 0))
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && mz_stream_fd_tell(fd_stream) != sizeof(buf) + 1)
+        err = MZ_TELL_ERROR;
+
+    mz_stream_fd_delete(&cursor1);
+    mz_stream_fd_delete(&cursor2);
+
+    /* Descriptor remains open after cursors are deleted */
+    if (err == MZ_OK)
+        err = mz_stream_fd_seek(fd_stream, 0, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = mz_stream_read_uint8(fd_stream, &value1);
+    if (err == MZ_OK && value1 != buf[0])
+        err = MZ_INTERNAL_ERROR;
+
+    mz_stream_fd_close(fd_stream);
+    mz_stream_fd_delete(&fd_stream);
+
+    mz_os_unlink(path);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+#endif
+
+static int32_t test_stream_read_check(void *buf_stream, const uint8_t *data, int32_t data_size,
+    uint8_t *buf, int32_t size)
+{
+    int64_t position = mz_stream_tell(buf_stream);
+    int32_t expected = size;
+    int32_t read = 0;
+
+    if (position < 0 || position > data_size)
+        return MZ_TELL_ERROR;
+    if (expected > data_size - position)
+        expected = data_size - (int32_t)position;
+
+    read = mz_stream_read(buf_stream, buf, size);
+    if (read != expected)
+        return MZ_READ_ERROR;
+    if (memcmp(buf, data + position, read) != 0)
+        return MZ_DATA_ERROR;
+    if (mz_stream_tell(buf_stream) != position + read)
+        return MZ_TELL_ERROR;
+    return MZ_OK;
+}
+
+int32_t test_stream_buffered(void)
+{
+    /* Reads smaller than, equal to and larger than the buffer */
+    static const int32_t sizes[] = { 1, 17, 999, 1000, 1001, 4096, 3, 2500, 60, 12000, 5 };
+    int32_t size_count = (int32_t)(sizeof(sizes) / sizeof(sizes[0]));
+    void *mem_stream = NULL;
+    void *buf_stream = NULL;
+    uint8_t *data = NULL;
+    uint8_t *buf = NULL;
+    int32_t data_size = 100000;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+
+    printf("Buffered stream.. ");
+
+    data = (uint8_t *)MZ_ALLOC(data_size);
+    buf = (uint8_t *)MZ_ALLOC(data_size);
+    if (data == NULL || buf == NULL)
+        err = MZ_MEM_ERROR;
+
+    for (i = 0; err == MZ_OK && i < data_size; i += 1)
+        data[i] = (uint8_t)((i * 7) ^ (i >> 8));
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_set_buffer(mem_stream, data, data_size);
+    mz_stream_buffered_create(&buf_stream);
+    mz_stream_set_base(buf_stream, mem_stream);
+
+    if (err == MZ_OK)
+        err = mz_stream_set_prop_int64(buf_stream, MZ_STREAM_PROP_BUFFER_SIZE, 1000);
+    if (err == MZ_OK)
+        err = mz_stream_open(buf_stream, NULL, MZ_OPEN_MODE_READ);
+
+    /* Read sequentially so the read ahead grows and large reads bypass the buffer */
+    for (i = 0; err == MZ_OK && i < size_count * 4; i += 1)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, sizes[i % size_count]);
+
+    /* Seek back into data that is still buffered and to data that is not */
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, mz_stream_tell(buf_stream) - 2, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, 10);
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, 123, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, 30);
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, 5000, MZ_SEEK_CUR);
+    if (err == MZ_OK)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, 2000);
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, 20, MZ_SEEK_CUR);
+    if (err == MZ_OK)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, 700);
+
+    /* Read past the end of the stream with a buffered and a direct read */
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, data_size - 10, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, 100);
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, data_size - 3000, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(buf_stream, data, data_size, buf, 5000);
+    if (err == MZ_OK && mz_stream_read(buf_stream, buf, 1) != 0)
+        err = MZ_READ_ERROR;
+
+    mz_stream_close(buf_stream);
+    mz_stream_delete(&buf_stream);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (data != NULL)
+        MZ_FREE(data);
+    if (buf != NULL)
+        MZ_FREE(buf);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_stream_async_zip(void *stream, const uint8_t *data, int32_t data_size)
+{
+    mz_zip_file file_info;
+    void *zip_handle = NULL;
+    uint8_t *buf = NULL;
+    int32_t size = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+    buf = (uint8_t *)MZ_ALLOC(data_size);
+    if (buf == NULL)
+        return MZ_MEM_ERROR;
+
+    /* Closing each entry seeks back to update its local header */
+    mz_zip_create(&zip_handle);
+    mz_zip_set_data_descriptor(zip_handle, 0);
+    err = mz_zip_open(zip_handle, stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 10; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%" PRId32 ".bin", i);
+        size = (i * 9973) % data_size;
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = MZ_COMPRESS_METHOD_STORE;
+        file_info.filename = filename;
+        file_info.uncompressed_size = size;
+
+        err = mz_zip_entry_write_open(zip_handle, &file_info, 0, 0, NULL);
+        if (err == MZ_OK && mz_zip_entry_write(zip_handle, data + i, size) != size)
+            err = MZ_WRITE_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = (i * 9973) % data_size;
+
+        err = mz_zip_entry_read_open(zip_handle, 0, NULL);
+        if (err == MZ_OK && mz_zip_entry_read(zip_handle, buf, data_size) != size)
+            err = MZ_READ_ERROR;
+        if (err == MZ_OK && memcmp(buf, data + i, size) != 0)
+            err = MZ_DATA_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST && i == 10)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    MZ_FREE(buf);
+    return err;
+}
+
+int32_t test_stream_async(void)
+{
+    static const int32_t sizes[] = { 1, 17, 999, 1000, 1001, 4096, 3, 2500, 60, 12000, 5 };
+    int32_t size_count = (int32_t)(sizeof(sizes) / sizeof(sizes[0]));
+    void *mem_stream = NULL;
+    void *async_stream = NULL;
+    void *buf_stream = NULL;
+    uint8_t *data = NULL;
+    uint8_t *buf = NULL;
+    int32_t data_size = 100000;
+    int32_t written = 0;
+    int32_t size = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+
+    printf("Async stream.. ");
+
+    data = (uint8_t *)MZ_ALLOC(data_size);
+    buf = (uint8_t *)MZ_ALLOC(data_size);
+    if (data == NULL || buf == NULL)
+        err = MZ_MEM_ERROR;
+
+    for (i = 0; err == MZ_OK && i < data_size; i += 1)
+        data[i] = (uint8_t)((i * 13) ^ (i >> 9));
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_async_create(&async_stream);
+    mz_stream_set_base(async_stream, mem_stream);
+
+    /* Small blocks so reads and writes span many of them */
+    if (err == MZ_OK)
+        err = mz_stream_set_prop_int64(async_stream, MZ_STREAM_PROP_BUFFER_SIZE, 1000);
+    if (err == MZ_OK)
+        err = mz_stream_open(async_stream, NULL, MZ_OPEN_MODE_CREATE | MZ_OPEN_MODE_WRITE);
+
+    for (i = 0; err == MZ_OK && written < data_size; i += 1)
+    {
+        size = sizes[i % size_count];
+        if (size > data_size - written)
+            size = data_size - written;
+        if (mz_stream_write(async_stream, data + written, size) != size)
+            err = MZ_WRITE_ERROR;
+        written += size;
+        if (err == MZ_OK && mz_stream_tell(async_stream) != written)
+            err = MZ_TELL_ERROR;
+    }
+
+    /* Overwrite data that has already been written and then read it back */
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 500, MZ_SEEK_SET);
+    if (err == MZ_OK && mz_stream_write(async_stream, data + 2000, 1500) != 1500)
+        err = MZ_WRITE_ERROR;
+    if (err == MZ_OK)
+        memmove(data + 500, data + 2000, 1500);
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 0, MZ_SEEK_END);
+    if (err == MZ_OK && mz_stream_tell(async_stream) != data_size)
+        err = MZ_TELL_ERROR;
+
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 0, MZ_SEEK_SET);
+    for (i = 0; err == MZ_OK && i < size_count * 4; i += 1)
+        err = test_stream_read_check(async_stream, data, data_size, buf, sizes[i % size_count]);
+
+    /* Seek within the block being read, to blocks read ahead and to the end */
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, -2, MZ_SEEK_CUR);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 10);
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 1500, MZ_SEEK_CUR);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 3000);
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 123, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 30);
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, -10, MZ_SEEK_END);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 100);
+    if (err == MZ_OK && mz_stream_read(async_stream, buf, 1) != 0)
+        err = MZ_READ_ERROR;
+
+    /* Switch from reading to writing in the middle of the stream */
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 40000, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 10);
+    if (err == MZ_OK && mz_stream_write(async_stream, data, 100) != 100)
+        err = MZ_WRITE_ERROR;
+    if (err == MZ_OK)
+        memmove(data + 40010, data, 100);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 50);
+    if (err == MZ_OK)
+        err = mz_stream_seek(async_stream, 39000, MZ_SEEK_SET);
+    if (err == MZ_OK)
+        err = test_stream_read_check(async_stream, data, data_size, buf, 5000);
+
+    if (mz_stream_close(async_stream) != MZ_OK && err == MZ_OK)
+        err = MZ_CLOSE_ERROR;
+
+    /* Zip written and read through a buffered stream on top of the async stream */
+    mz_stream_mem_delete(&mem_stream);
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_set_base(async_stream, mem_stream);
+
+    mz_stream_buffered_create(&buf_stream);
+    mz_stream_set_base(buf_stream, async_stream);
+    if (err == MZ_OK)
+        err = mz_stream_open(buf_stream, NULL, MZ_OPEN_MODE_CREATE | MZ_OPEN_MODE_WRITE);
+    if (err == MZ_OK)
+        err = test_stream_async_zip(buf_stream, data, data_size);
+    mz_stream_close(buf_stream);
+    mz_stream_delete(&buf_stream);
+
+    mz_stream_async_delete(&async_stream);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (data != NULL)
+        MZ_FREE(data);
+    if (buf != NULL)
+        MZ_FREE(buf);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+#if !defined(MZ_ZIP_NO_COMPRESSION) && !defined(MZ_ZIP_NO_DECOMPRESSION)
+static int32_t test_zip_locate_add(void *zip_handle, const char *filename, int32_t size)
+{
+    mz_zip_file file_info;
+    int32_t err = MZ_OK;
+
+    memset(&file_info, 0, sizeof(file_info));
+    file_info.version_madeby = MZ_VERSION_MADEBY;
+    file_info.compression_method = MZ_COMPRESS_METHOD_STORE;
+    file_info.filename = filename;
+    file_info.uncompressed_size = size;
+
+    err = mz_zip_entry_write_open(zip_handle, &file_info, 0, 0, NULL);
+    if (err == MZ_OK)
+    {
+        if (mz_zip_entry_write(zip_handle, "0123456789", size) != size)
+            err = MZ_WRITE_ERROR;
+        mz_zip_entry_close(zip_handle);
+    }
+    return err;
+}
+
+static int32_t test_zip_locate_run(void *zip_handle, const char *filename, uint8_t ignore_case,
+    int32_t expected_err, int64_t expected_size)
+{
+    mz_zip_file *file_info = NULL;
+    int32_t err = MZ_OK;
+
+    err = mz_zip_locate_entry(zip_handle, filename, ignore_case);
+    if (err != expected_err)
+    {
+        printf("failed locating %s (%" PRId32 ")\n", filename, err);
+        return MZ_INTERNAL_ERROR;
+    }
+    if (err != MZ_OK)
+        return MZ_OK;
+
+    err = mz_zip_entry_get_info(zip_handle, &file_info);
+    if (err == MZ_OK && mz_zip_path_compare(file_info->filename, filename, ignore_case) != 0)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && file_info->uncompressed_size != expected_size)
+        err = MZ_INTERNAL_ERROR;
+    if (err != MZ_OK)
+        printf("unexpected entry located for %s\n", filename);
+    return err;
+}
+
+int32_t test_zip_locate(void)
+{
+    void *mem_stream = NULL;
+    void *zip_handle = NULL;
+    int64_t entry_pos = 0;
+    int32_t entry_count = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    uint8_t read_mode = 0;
+    char filename[32];
+
+
+    printf("Locate entry.. ");
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_set_grow_size(mem_stream, 128 * 1024);
+    mz_stream_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_create(&zip_handle);
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 300; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        err = test_zip_locate_add(zip_handle, filename, 1);
+    }
+    if (err == MZ_OK)
+        err = test_zip_locate_add(zip_handle, "Dir\\Mixed.txt", 2);
+    /* Duplicate name should never be located over the first one */
+    if (err == MZ_OK)
+        err = test_zip_locate_add(zip_handle, "entry005.txt", 3);
+    mz_zip_close(zip_handle);
+
+    /* Read with and without the decoded central directory index and in memory central directory */
+    for (read_mode = 0; err == MZ_OK && read_mode <= 3; read_mode += 1)
+    {
+        mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_SET);
+        mz_zip_set_cd_index(zip_handle, read_mode & 1);
+        mz_zip_set_cd_in_memory(zip_handle, (read_mode >> 1) & 1);
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+        if (err != MZ_OK)
+            break;
+
+        entry_count = 0;
+        err = mz_zip_goto_first_entry(zip_handle);
+        while (err == MZ_OK)
+        {
+            entry_count += 1;
+            if (entry_count == 150)
+                entry_pos = mz_zip_get_entry(zip_handle);
+            err = mz_zip_goto_next_entry(zip_handle);
+        }
+        if (err == MZ_END_OF_LIST && entry_count == 302)
+            err = mz_zip_goto_entry(zip_handle, entry_pos);
+        if (err == MZ_OK)
+            err = test_zip_locate_run(zip_handle, "entry149.txt", 0, MZ_OK, 1);
+        if (err != MZ_OK)
+        {
+            printf("failed enumerating entries (%" PRId32 ")\n", err);
+            err = MZ_INTERNAL_ERROR;
+        }
+
+        err |= test_zip_locate_run(zip_handle, "entry150.txt", 0, MZ_OK, 1);
+        err |= test_zip_locate_run(zip_handle, "ENTRY150.TXT", 0, MZ_END_OF_LIST, 0);
+        err |= test_zip_locate_run(zip_handle, "ENTRY150.TXT", 1, MZ_OK, 1);
+        err |= test_zip_locate_run(zip_handle, "dir/mixed.txt", 1, MZ_OK, 2);
+        err |= test_zip_locate_run(zip_handle, "Dir/Mixed.txt", 0, MZ_OK, 2);
+        err |= test_zip_locate_run(zip_handle, "missing.txt", 0, MZ_END_OF_LIST, 0);
+        err |= test_zip_locate_run(zip_handle, "entry005.txt", 0, MZ_OK, 1);
+        err |= test_zip_locate_run(zip_handle, "entry299.txt", 1, MZ_OK, 1);
+        err |= test_zip_locate_run(zip_handle, "entry000.txt", 0, MZ_OK, 1);
+        mz_zip_close(zip_handle);
+    }
+
+    mz_zip_delete(&zip_handle);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (err != MZ_OK)
+    {
+        printf("failed\n");
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_zip_cursor_read(void *reader, const char *filename, int32_t offset, int32_t size)
+{
+    char buf[10];
+
+    if (mz_zip_reader_entry_read(reader, buf, size) != size)
+        return MZ_READ_ERROR;
+    if (memcmp(buf, "0123456789" + offset, size) != 0)
+    {
+        printf("unexpected data read for %s\n", filename);
+        return MZ_INTERNAL_ERROR;
+    }
+    return MZ_OK;
+}
+
+static int32_t test_zip_codec_reuse_data(uint8_t *data, int32_t entry)
+{
+    int32_t size = (entry * 9973) % 100000;
+    uint32_t seed = (uint32_t)entry;
+    int32_t i = 0;
+
+    /* Partly random so larger entries don't fit in a single stream buffer once compressed */
+    for (i = 0; i < size; i += 1)
+    {
+        seed = seed * 1103515245 + 12345;
+        if ((i % 3) == 0)
+            data[i] = (uint8_t)(seed >> 16);
+        else
+            data[i] = (uint8_t)('a' + ((i / (entry + 1)) + entry) % 26);
+    }
+    return size;
+}
+
+int32_t test_zip_codec_reuse(void)
+{
+    static const uint16_t methods[] = {
+        MZ_COMPRESS_METHOD_DEFLATE,
+        MZ_COMPRESS_METHOD_STORE,
+#ifdef HAVE_BZIP2
+        MZ_COMPRESS_METHOD_BZIP2,
+#endif
+#ifdef HAVE_LZMA
+        MZ_COMPRESS_METHOD_LZMA,
+        MZ_COMPRESS_METHOD_XZ,
+#endif
+#ifdef HAVE_ZSTD
+        MZ_COMPRESS_METHOD_ZSTD,
+#endif
+        MZ_COMPRESS_METHOD_DEFLATE
+    };
+    static const int16_t levels[] = { 1, 9, MZ_COMPRESS_LEVEL_DEFAULT };
+    int32_t method_count = (int32_t)(sizeof(methods) / sizeof(methods[0]));
+    mz_zip_file file_info;
+    void *mem_stream = NULL;
+    void *zip_handle = NULL;
+    uint8_t *expected = NULL;
+    uint8_t *buf = NULL;
+    int32_t size = 0;
+    int32_t read = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+
+    printf("Zip codec reuse.. ");
+
+    expected = (uint8_t *)MZ_ALLOC(100000);
+    buf = (uint8_t *)MZ_ALLOC(100000);
+    if (expected == NULL || buf == NULL)
+        err = MZ_MEM_ERROR;
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    /* Change method and level between entries so pooled streams are reset and reinitialized */
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 40; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        size = test_zip_codec_reuse_data(expected, i);
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = methods[i % method_count];
+        file_info.filename = filename;
+        file_info.uncompressed_size = size;
+
+        err = mz_zip_entry_write_open(zip_handle, &file_info, levels[i % 3], 0, NULL);
+        if (err == MZ_OK && mz_zip_entry_write(zip_handle, expected, size) != size)
+            err = MZ_WRITE_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    /* Read every third entry partially so some streams are closed before the end of their data */
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = test_zip_codec_reuse_data(expected, i);
+
+        err = mz_zip_entry_read_open(zip_handle, 0, NULL);
+        if (err == MZ_OK && (i % 3) == 2)
+        {
+            read = mz_zip_entry_read(zip_handle, buf, size / 2);
+            if (read != size / 2 || memcmp(buf, expected, read) != 0)
+                err = MZ_DATA_ERROR;
+            mz_zip_entry_close(zip_handle);
+        }
+        else if (err == MZ_OK)
+        {
+            read = mz_zip_entry_read(zip_handle, buf, 100000);
+            if (read != size || memcmp(buf, expected, size) != 0)
+                err = MZ_DATA_ERROR;
+            if (err == MZ_OK)
+                err = mz_zip_entry_close(zip_handle);
+        }
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST && i == 40)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (expected != NULL)
+        MZ_FREE(expected);
+    if (buf != NULL)
+        MZ_FREE(buf);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_zip_codec_reuse_level_run(const char *path, const int16_t *levels, int32_t count,
+    const uint8_t *data, int32_t size, int64_t *compressed_size)
+{
+    mz_zip_file file_info;
+    mz_zip_file *entry_info = NULL;
+    void *writer = NULL;
+    void *reader = NULL;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+    /* Writer opens the file for reading and writing, so pooled streams are opened in that mode */
+    mz_zip_writer_create(&writer);
+    err = mz_zip_writer_open_file(writer, path, 0, 0);
+    for (i = 0; err == MZ_OK && i < count; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%" PRId32 ".txt", i);
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = MZ_COMPRESS_METHOD_DEFLATE;
+        file_info.filename = filename;
+
+        mz_zip_writer_set_compress_level(writer, levels[i]);
+        err = mz_zip_writer_add_buffer(writer, (void *)data, size, &file_info);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_writer_close(writer);
+    else
+        mz_zip_writer_close(writer);
+    mz_zip_writer_delete(&writer);
+
+    /* Return the compressed size of the last entry */
+    mz_zip_reader_create(&reader);
+    if (err == MZ_OK)
+        err = mz_zip_reader_open_file(reader, path);
+    if (err == MZ_OK)
+        err = mz_zip_reader_locate_entry(reader, filename, 0);
+    if (err == MZ_OK)
+        err = mz_zip_reader_entry_get_info(reader, &entry_info);
+    if (err == MZ_OK)
+        *compressed_size = entry_info->compressed_size;
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    mz_os_unlink(path);
+    return err;
+}
+
+int32_t test_zip_codec_reuse_level(void)
+{
+    static const char *words[] = { "alpha ", "bravo ", "charlie ", "delta ", "echo ", "foxtrot ",
+        "golf ", "hotel ", "india ", "juliett ", "kilo ", "lima ", "mike ", "november ", "oscar ", "papa " };
+    static const int16_t levels[] = { 1, 9 };
+    const char *path = "test_codec_level.zip";
+    uint8_t *data = NULL;
+    int64_t reused_size = 0;
+    int64_t single_size = 0;
+    int32_t size = 200000;
+    int32_t len = 0;
+    int32_t i = 0;
+    uint32_t seed = 1;
+    int32_t err = MZ_OK;
+
+
+    printf("Zip codec reuse level.. ");
+
+    data = (uint8_t *)MZ_ALLOC(size);
+    if (data == NULL)
+        return MZ_MEM_ERROR;
+    while (i < size)
+    {
+        seed = seed * 1103515245 + 12345;
+        len = (int32_t)strlen(words[(seed >> 16) % 16]);
+        if (len > size - i)
+            len = size - i;
+        memcpy(data + i, words[(seed >> 16) % 16], len);
+        i += len;
+    }
+
+    /* Entry written after one at another level must match the entry written on its own */
+    err = test_zip_codec_reuse_level_run(path, levels, 2, data, size, &reused_size);
+    if (err == MZ_OK)
+        err = test_zip_codec_reuse_level_run(path, levels + 1, 1, data, size, &single_size);
+    if (err == MZ_OK && reused_size != single_size)
+    {
+        printf("level ignored (%" PRId64 " != %" PRId64 ") ", reused_size, single_size);
+        err = MZ_INTERNAL_ERROR;
+    }
+
+    MZ_FREE(data);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_zip_buffer_size_run(int32_t write_buffer_size, int32_t read_buffer_size)
+{
+    static const uint16_t methods[] = {
+        MZ_COMPRESS_METHOD_DEFLATE,
+        MZ_COMPRESS_METHOD_STORE,
+#ifdef HAVE_BZIP2
+        MZ_COMPRESS_METHOD_BZIP2,
+#endif
+#ifdef HAVE_LZMA
+        MZ_COMPRESS_METHOD_LZMA,
+        MZ_COMPRESS_METHOD_XZ,
+#endif
+#ifdef HAVE_ZSTD
+        MZ_COMPRESS_METHOD_ZSTD,
+#endif
+    };
+    int32_t method_count = (int32_t)(sizeof(methods) / sizeof(methods[0]));
+    mz_zip_file file_info;
+    void *mem_stream = NULL;
+    void *buf_stream = NULL;
+    void *zip_handle = NULL;
+    uint8_t *expected = NULL;
+    uint8_t *buf = NULL;
+    const char *password = NULL;
+    int32_t size = 0;
+    int32_t read = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+    expected = (uint8_t *)MZ_ALLOC(100000);
+    buf = (uint8_t *)MZ_ALLOC(100000);
+    if (expected == NULL || buf == NULL)
+        err = MZ_MEM_ERROR;
+
+    /* Zip file is written and read through a buffered stream of the same size as the entry streams */
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+    mz_stream_buffered_create(&buf_stream);
+    mz_stream_set_base(buf_stream, mem_stream);
+    if (err == MZ_OK)
+        err = mz_stream_set_prop_int64(buf_stream, MZ_STREAM_PROP_BUFFER_SIZE, write_buffer_size);
+    if (err == MZ_OK)
+        err = mz_stream_open(buf_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_set_buffer_size(zip_handle, write_buffer_size);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, buf_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < method_count * 3; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        size = test_zip_codec_reuse_data(expected, i * 7 + 3);
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = methods[i % method_count];
+        file_info.filename = filename;
+        file_info.uncompressed_size = size;
+
+        /* Entries alternate between no encryption, traditional encryption and aes encryption */
+        password = NULL;
+#ifdef HAVE_PKCRYPT
+        if ((i % 3) == 1)
+        {
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+            password = "buffer";
+        }
+#endif
+#ifdef HAVE_WZAES
+        if ((i % 3) == 2)
+        {
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+            file_info.aes_version = MZ_AES_VERSION;
+            password = "buffer";
+        }
+#endif
+
+        err = mz_zip_entry_write_open(zip_handle, &file_info, MZ_COMPRESS_LEVEL_DEFAULT, 0, password);
+        if (err == MZ_OK && mz_zip_entry_write(zip_handle, expected, size) != size)
+            err = MZ_WRITE_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    mz_stream_close(buf_stream);
+
+    if (err == MZ_OK)
+        err = mz_stream_set_prop_int64(buf_stream, MZ_STREAM_PROP_BUFFER_SIZE, read_buffer_size);
+    /* Memory stream is left open in create mode so it still owns its buffer */
+    if (err == MZ_OK)
+        err = mz_stream_seek(buf_stream, 0, MZ_SEEK_SET);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_set_buffer_size(zip_handle, read_buffer_size);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, buf_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = test_zip_codec_reuse_data(expected, i * 7 + 3);
+
+        err = mz_zip_entry_read_open(zip_handle, 0, "buffer");
+        if (err == MZ_OK)
+        {
+            read = mz_zip_entry_read(zip_handle, buf, 100000);
+            if (read != size || memcmp(buf, expected, size) != 0)
+                err = MZ_DATA_ERROR;
+        }
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST && i == method_count * 3)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    mz_stream_close(buf_stream);
+    mz_stream_delete(&buf_stream);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (expected != NULL)
+        MZ_FREE(expected);
+    if (buf != NULL)
+        MZ_FREE(buf);
+
+    return err;
+}
+
+int32_t test_zip_buffer_size(void)
+{
+    int32_t err = MZ_OK;
+
+
+    printf("Zip buffer size.. ");
+
+    /* Buffers much smaller and much larger than the default, different for reading and writing */
+    err = test_zip_buffer_size_run(512, 4096);
+    if (err == MZ_OK)
+        err = test_zip_buffer_size_run(1024 * 1024, 700);
+    if (err == MZ_OK)
+        err = test_zip_buffer_size_run(4096, 256 * 1024);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+int32_t test_zip_read_buffer(void)
+{
+    static const uint16_t methods[] = {
+        MZ_COMPRESS_METHOD_DEFLATE,
+        MZ_COMPRESS_METHOD_STORE,
+#ifdef HAVE_BZIP2
+        MZ_COMPRESS_METHOD_BZIP2,
+#endif
+#ifdef HAVE_LZMA
+        MZ_COMPRESS_METHOD_LZMA,
+        MZ_COMPRESS_METHOD_XZ,
+#endif
+#ifdef HAVE_ZSTD
+        MZ_COMPRESS_METHOD_ZSTD,
+#endif
+        MZ_COMPRESS_METHOD_DEFLATE
+    };
+    int32_t method_count = (int32_t)(sizeof(methods) / sizeof(methods[0]));
+    mz_zip_file file_info;
+    mz_zip_file *entry_info = NULL;
+    const char *password = NULL;
+    void *mem_stream = NULL;
+    void *zip_handle = NULL;
+    void *reader = NULL;
+    uint8_t *expected = NULL;
+    uint8_t *buf = NULL;
+    int32_t entry_count = method_count * 3;
+    int32_t size = 0;
+    int32_t read = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+
+    printf("Zip read buffer.. ");
+
+    expected = (uint8_t *)MZ_ALLOC(100000);
+    buf = (uint8_t *)MZ_ALLOC(100001);
+    if (expected == NULL || buf == NULL)
+        err = MZ_MEM_ERROR;
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < entry_count; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        size = test_zip_codec_reuse_data(expected, i * 11 + 5);
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = methods[i % method_count];
+        file_info.filename = filename;
+        file_info.uncompressed_size = size;
+
+        /* Each method is stored without encryption, with traditional encryption and with aes encryption */
+        password = NULL;
+#ifdef HAVE_PKCRYPT
+        if ((i / method_count) == 1)
+        {
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+            password = "buffer";
+        }
+#endif
+#ifdef HAVE_WZAES
+        if ((i / method_count) == 2)
+        {
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+            file_info.aes_version = MZ_AES_VERSION;
+            password = "buffer";
+        }
+#endif
+
+        err = mz_zip_entry_write_open(zip_handle, &file_info, MZ_COMPRESS_LEVEL_DEFAULT, 0, password);
+        if (err == MZ_OK && mz_zip_entry_write(zip_handle, expected, size) != size)
+            err = MZ_WRITE_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    /* Whole entries, entries with a partial read first and buffers that are too small or too large */
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = test_zip_codec_reuse_data(expected, i * 11 + 5);
+
+        err = mz_zip_entry_read_open(zip_handle, 0, "buffer");
+        if (err == MZ_OK)
+        {
+            memset(buf, 0, size);
+            read = 0;
+            if ((i % 4) == 1)
+            {
+                read = mz_zip_entry_read(zip_handle, buf, size / 3);
+                if (read != size / 3)
+                    err = MZ_DATA_ERROR;
+            }
+            if (err == MZ_OK)
+                err = mz_zip_entry_read_buffer(zip_handle, buf + read, size - read);
+            if (err == MZ_OK && memcmp(buf, expected, size) != 0)
+                err = MZ_DATA_ERROR;
+            if (err == MZ_OK)
+                err = mz_zip_entry_close(zip_handle);
+        }
+        if (err == MZ_OK && size > 0)
+        {
+            err = mz_zip_entry_read_open(zip_handle, 0, "buffer");
+            if (err == MZ_OK && mz_zip_entry_read_buffer(zip_handle, buf, size - 1) != MZ_BUF_ERROR)
+                err = MZ_INTERNAL_ERROR;
+            mz_zip_entry_close(zip_handle);
+        }
+        if (err == MZ_OK)
+        {
+            err = mz_zip_entry_read_open(zip_handle, 0, "buffer");
+            if (err == MZ_OK && mz_zip_entry_read_buffer(zip_handle, buf, size + 1) != MZ_DATA_ERROR)
+                err = MZ_INTERNAL_ERROR;
+            mz_zip_entry_close(zip_handle);
+        }
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST && i == entry_count)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    /* Reader saves every entry to a buffer of its uncompressed size */
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_password(reader, "buffer");
+    if (err == MZ_OK)
+        err = mz_zip_reader_open(reader, mem_stream);
+    if (err == MZ_OK)
+        err = mz_zip_reader_goto_first_entry(reader);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = test_zip_codec_reuse_data(expected, i * 11 + 5);
+
+        err = mz_zip_reader_entry_get_info(reader, &entry_info);
+        if (err == MZ_OK && mz_zip_reader_entry_save_buffer64(reader, buf, size + 1) != MZ_BUF_ERROR)
+            err = MZ_INTERNAL_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save_buffer64(reader, buf, entry_info->uncompressed_size);
+        if (err == MZ_OK && memcmp(buf, expected, size) != 0)
+            err = MZ_DATA_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_reader_goto_next_entry(reader);
+    }
+    if (err == MZ_END_OF_LIST && i == entry_count)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (expected != NULL)
+        MZ_FREE(expected);
+    if (buf != NULL)
+        MZ_FREE(buf);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+int32_t test_zip_write_buffer(void)
+{
+    static const uint16_t methods[] = {
+        MZ_COMPRESS_METHOD_DEFLATE,
+        MZ_COMPRESS_METHOD_STORE,
+#ifdef HAVE_BZIP2
+        MZ_COMPRESS_METHOD_BZIP2,
+#endif
+#ifdef HAVE_LZMA
+        MZ_COMPRESS_METHOD_LZMA,
+        MZ_COMPRESS_METHOD_XZ,
+#endif
+#ifdef HAVE_ZSTD
+        MZ_COMPRESS_METHOD_ZSTD,
+#endif
+        MZ_COMPRESS_METHOD_DEFLATE
+    };
+    int32_t method_count = (int32_t)(sizeof(methods) / sizeof(methods[0]));
+    mz_zip_file file_info;
+    const char *password = NULL;
+    void *mem_stream = NULL;
+    void *zip_handle = NULL;
+    void *writer = NULL;
+    uint8_t *expected = NULL;
+    uint8_t *buf = NULL;
+    int32_t entry_count = method_count * 3;
+    int32_t size = 0;
+    int32_t written = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+
+    printf("Zip write buffer.. ");
+
+    expected = (uint8_t *)MZ_ALLOC(100000);
+    buf = (uint8_t *)MZ_ALLOC(100000);
+    if (expected == NULL || buf == NULL)
+        err = MZ_MEM_ERROR;
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    /* Whole entries in one call and entries that were partly written before */
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < entry_count; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        size = test_zip_codec_reuse_data(expected, i * 13 + 1);
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = methods[i % method_count];
+        file_info.filename = filename;
+
+        password = NULL;
+#ifdef HAVE_PKCRYPT
+        if ((i / method_count) == 1)
+        {
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+            password = "buffer";
+        }
+#endif
+#ifdef HAVE_WZAES
+        if ((i / method_count) == 2)
+        {
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+            file_info.aes_version = MZ_AES_VERSION;
+            password = "buffer";
+        }
+#endif
+
+        err = mz_zip_entry_write_open(zip_handle, &file_info, MZ_COMPRESS_LEVEL_DEFAULT, 0, password);
+        written = 0;
+        if (err == MZ_OK && (i % 4) == 3)
+        {
+            written = mz_zip_entry_write(zip_handle, expected, size / 4);
+            if (written != size / 4)
+                err = MZ_WRITE_ERROR;
+        }
+        if (err == MZ_OK)
+            err = mz_zip_entry_write_buffer(zip_handle, expected + written, size - written);
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = test_zip_codec_reuse_data(expected, i * 13 + 1);
+
+        err = mz_zip_entry_read_open(zip_handle, 0, "buffer");
+        if (err == MZ_OK)
+            err = mz_zip_entry_read_buffer(zip_handle, buf, size);
+        if (err == MZ_OK && memcmp(buf, expected, size) != 0)
+            err = MZ_DATA_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST && i == entry_count)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    mz_stream_mem_delete(&mem_stream);
+
+    /* Writer adds buffers with and without multiple compression threads */
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_writer_create(&writer);
+    mz_zip_writer_set_password(writer, "buffer");
+    if (err == MZ_OK)
+        err = mz_zip_writer_open(writer, mem_stream, 0);
+    for (i = 0; err == MZ_OK && i < entry_count; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        size = test_zip_codec_reuse_data(expected, i * 13 + 1);
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = methods[i % method_count];
+        file_info.filename = filename;
+        if ((i / method_count) == 1)
+            file_info.flag |= MZ_ZIP_FLAG_ENCRYPTED;
+
+        mz_zip_writer_set_thread_count(writer, (i % 2) + 1);
+        err = mz_zip_writer_add_buffer(writer, expected, size, &file_info);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_writer_close(writer);
+    else
+        mz_zip_writer_close(writer);
+    mz_zip_writer_delete(&writer);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    for (i = 0; err == MZ_OK; i += 1)
+    {
+        size = test_zip_codec_reuse_data(expected, i * 13 + 1);
+
+        err = mz_zip_entry_read_open(zip_handle, 0, "buffer");
+        if (err == MZ_OK)
+            err = mz_zip_entry_read_buffer(zip_handle, buf, size);
+        if (err == MZ_OK && memcmp(buf, expected, size) != 0)
+            err = MZ_DATA_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST && i == entry_count)
+        err = MZ_OK;
+    else if (err == MZ_END_OF_LIST)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    mz_stream_mem_delete(&mem_stream);
+
+    if (expected != NULL)
+        MZ_FREE(expected);
+    if (buf != NULL)
+        MZ_FREE(buf);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+#ifdef HAVE_ZLIB
+static int32_t test_zip_method_create_count = 0;
+
+static void *test_zip_method_create(void **stream)
+{
+    test_zip_method_create_count += 1;
+    return mz_stream_zlib_create(stream);
+}
+
+static int32_t test_zip_method_run(uint16_t compression_method, const uint8_t *data, int32_t size)
+{
+    mz_zip_file file_info;
+    mz_zip_file *entry_info = NULL;
+    void *mem_stream = NULL;
+    void *zip_handle = NULL;
+    uint8_t buf[4096];
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
+
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_create(&zip_handle);
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 3; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%" PRId32 ".txt", i);
+
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = compression_method;
+        file_info.filename = filename;
+
+        err = mz_zip_entry_write_open(zip_handle, &file_info, MZ_COMPRESS_LEVEL_DEFAULT, 0, NULL);
+        if (err == MZ_OK)
+            err = mz_zip_entry_write_buffer(zip_handle, data, size);
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+    }
+    if (mz_zip_close(zip_handle) != MZ_OK && err == MZ_OK)
+        err = MZ_CLOSE_ERROR;
+    mz_zip_delete(&zip_handle);
+
+    mz_zip_create(&zip_handle);
+    if (err == MZ_OK)
+        err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_READ);
+    if (err == MZ_OK)
+        err = mz_zip_goto_first_entry(zip_handle);
+    while (err == MZ_OK)
+    {
+        err = mz_zip_entry_get_info(zip_handle, &entry_info);
+        if (err == MZ_OK && entry_info->compression_method != compression_method)
+            err = MZ_FORMAT_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_read_open(zip_handle, 0, NULL);
+        if (err == MZ_OK)
+            err = mz_zip_entry_read_buffer(zip_handle, buf, size);
+        if (err == MZ_OK && memcmp(buf, data, size) != 0)
+            err = MZ_DATA_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_entry_close(zip_handle);
+        if (err == MZ_OK)
+            err = mz_zip_goto_next_entry(zip_handle);
+    }
+    if (err == MZ_END_OF_LIST)
+        err = MZ_OK;
+
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+    mz_stream_mem_delete(&mem_stream);
+    return err;
+}
+
+int32_t test_zip_method_registry(void)
+{
+    mz_stream_create_cb create = NULL;
+    uint16_t custom_method = 0x4c34;
+    uint8_t data[4096];
+    int32_t flags = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+
+    printf("Zip method registry.. ");
+
+    for (i = 0; i < (int32_t)sizeof(data); i += 1)
+        data[i] = (uint8_t)('a' + (i / 5) % 26);
+
+    /* Unknown methods can't be read or written until they are registered */
+    if (mz_zip_get_method(custom_method, NULL, NULL) != MZ_SUPPORT_ERROR)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && test_zip_method_run(custom_method, data, sizeof(data)) != MZ_SUPPORT_ERROR)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && mz_zip_register_method(MZ_COMPRESS_METHOD_STORE, test_zip_method_create, 0) != MZ_PARAM_ERROR)
+        err = MZ_INTERNAL_ERROR;
+
+    if (err == MZ_OK)
+        err = mz_zip_register_method(custom_method, test_zip_method_create, MZ_COMPRESS_FLAG_ONE_SHOT);
+    if (err == MZ_OK)
+        err = mz_zip_get_method(custom_method, &create, &flags);
+    if (err == MZ_OK && (create != test_zip_method_create || flags != MZ_COMPRESS_FLAG_ONE_SHOT))
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = test_zip_method_run(custom_method, data, sizeof(data));
+
+    /* Registered streams replace built-in streams and are pooled between entries */
+    test_zip_method_create_count = 0;
+    if (err == MZ_OK)
+        err = mz_zip_register_method(MZ_COMPRESS_METHOD_DEFLATE, test_zip_method_create, 0);
+    if (err == MZ_OK)
+        err = test_zip_method_run(MZ_COMPRESS_METHOD_DEFLATE, data, sizeof(data));
+    if (err == MZ_OK && test_zip_method_create_count != 2)
+        err = MZ_INTERNAL_ERROR;
+
+    mz_zip_register_method(custom_method, NULL, 0);
+    mz_zip_register_method(MZ_COMPRESS_METHOD_DEFLATE, NULL, 0);
+
+    test_zip_method_create_count = 0;
+    if (err == MZ_OK && mz_zip_get_method(custom_method, NULL, NULL) != MZ_SUPPORT_ERROR)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = mz_zip_get_method(MZ_COMPRESS_METHOD_DEFLATE, &create, &flags);
+    if (err == MZ_OK && (create != mz_stream_zlib_create || !(flags & MZ_COMPRESS_FLAG_ONE_SHOT)))
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK)
+        err = test_zip_method_run(MZ_COMPRESS_METHOD_DEFLATE, data, sizeof(data));
+    if (err == MZ_OK && test_zip_method_create_count != 0)
+        err = MZ_INTERNAL_ERROR;
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+#endif
+
+int32_t test_zip_cursor(void)
+{
+    void *mem_stream = NULL;
+    void *file_stream = NULL;
+    void *zip_handle = NULL;
+    void *shared = NULL;
+    void *cursor1 = NULL;
+    void *cursor2 = NULL;
+    const char *path = "test_cursor.zip";
+    const void *buf = NULL;
+    mz_zip_file *file_info = NULL;
+    int32_t buf_length = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    uint8_t open_mode = 0;
+    char filename[32];
+
+
+    printf("Zip cursor.. ");
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_create(&zip_handle);
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 50; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%03" PRId32 ".txt", i);
+        err = test_zip_locate_add(zip_handle, filename, 10);
+    }
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    mz_stream_mem_get_buffer(mem_stream, &buf);
+    mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_END);
+    buf_length = (int32_t)mz_stream_mem_tell(mem_stream);
+
+    mz_stream_os_create(&file_stream);
+    if (err == MZ_OK)
+        err = mz_stream_os_open(file_stream, path, MZ_OPEN_MODE_CREATE | MZ_OPEN_MODE_WRITE);
+    if (err == MZ_OK && mz_stream_os_write(file_stream, buf, buf_length) != buf_length)
+        err = MZ_WRITE_ERROR;
+    mz_stream_os_close(file_stream);
+    mz_stream_os_delete(&file_stream);
+
+    mz_zip_reader_create(&shared);
+    mz_zip_reader_create(&cursor1);
+    mz_zip_reader_create(&cursor2);
+
+    /* Open cursors on a shared buffer, file and memory mapped file */
+    for (open_mode = 0; err == MZ_OK && open_mode <= 2; open_mode += 1)
+    {
+#ifdef _WIN32
+        /* Windows file stream doesn't support positional reads */
+        if (open_mode == 1)
+            continue;
+#endif
+        mz_zip_reader_set_mmap(shared, open_mode == 2);
+        if (open_mode == 0)
+            err = mz_zip_reader_open_buffer(shared, (uint8_t *)buf, buf_length, 0);
+        else
+            err = mz_zip_reader_open_file(shared, path);
+        if (err == MZ_OK)
+            err = mz_zip_reader_open_cursor(cursor1, shared);
+        if (err == MZ_OK)
+            err = mz_zip_reader_open_cursor(cursor2, shared);
+
+        /* Each cursor reads its own entry */
+        if (err == MZ_OK)
+            err = mz_zip_reader_locate_entry(cursor1, "entry010.txt", 0);
+        if (err == MZ_OK)
+            err = mz_zip_reader_locate_entry(cursor2, "ENTRY042.TXT", 1);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_open(cursor1);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_open(cursor2);
+        if (err == MZ_OK)
+            err = test_zip_cursor_read(cursor1, "entry010.txt", 0, 3);
+        if (err == MZ_OK)
+            err = test_zip_cursor_read(cursor2, "entry042.txt", 0, 5);
+        if (err == MZ_OK)
+            err = test_zip_cursor_read(cursor1, "entry010.txt", 3, 7);
+        if (err == MZ_OK)
+            err = test_zip_cursor_read(cursor2, "entry042.txt", 5, 5);
+        mz_zip_reader_entry_close(cursor1);
+        mz_zip_reader_entry_close(cursor2);
+
+        /* Shared reader is unaffected by its cursors */
+        if (err == MZ_OK)
+            err = mz_zip_reader_goto_next_entry(shared);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_get_info(shared, &file_info);
+        if (err == MZ_OK && strcmp(file_info->filename, "entry001.txt") != 0)
+            err = MZ_INTERNAL_ERROR;
+        if (err == MZ_OK && mz_zip_reader_locate_entry(cursor1, "missing.txt", 0) != MZ_END_OF_LIST)
+            err = MZ_INTERNAL_ERROR;
+
+        mz_zip_reader_close(cursor1);
+        mz_zip_reader_close(cursor2);
+        mz_zip_reader_close(shared);
+
+        if (err != MZ_OK)
+            printf("failed with open mode %" PRId32 " ", (int32_t)open_mode);
+    }
+
+    mz_zip_reader_delete(&cursor1);
+    mz_zip_reader_delete(&cursor2);
+    mz_zip_reader_delete(&shared);
+
+    mz_stream_mem_delete(&mem_stream);
+    mz_os_unlink(path);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_zip_save_all_entry_cb(void *handle, void *userdata, mz_zip_file *file_info, const char *path)
+{
+    int32_t *entry_count = (int32_t *)userdata;
+
+    MZ_UNUSED(handle);
+    MZ_UNUSED(file_info);
+    MZ_UNUSED(path);
+
+    *entry_count += 1;
+    return MZ_OK;
+}
+
+int32_t test_zip_save_all_threads(void)
+{
+    void *mem_stream = NULL;
+    void *file_stream = NULL;
+    void *zip_handle = NULL;
+    void *reader = NULL;
+    const char *destination = "test_save_all";
+    const void *buf = NULL;
+    int32_t buf_length = 0;
+    int32_t entry_count = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[64];
+    char path[128];
+    char data[10];
+
+
+    printf("Zip save all threads.. ");
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    /* Spread entries across a few directories with different sizes */
+    mz_zip_create(&zip_handle);
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 40; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "dir%" PRId32 "/entry%03" PRId32 ".txt", i % 4, i);
+        err = test_zip_locate_add(zip_handle, filename, i % 11);
+    }
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    mz_stream_mem_get_buffer(mem_stream, &buf);
+    mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_END);
+    buf_length = (int32_t)mz_stream_mem_tell(mem_stream);
+
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_thread_count(reader, 4);
+    mz_zip_reader_set_entry_cb(reader, &entry_count, test_zip_save_all_entry_cb);
+
+    if (err == MZ_OK)
+        err = mz_zip_reader_open_buffer(reader, (uint8_t *)buf, buf_length, 0);
+    if (err == MZ_OK)
+        err = mz_zip_reader_save_all(reader, destination);
+    if (err == MZ_OK && entry_count != 40)
+    {
+        printf("unexpected entry count %" PRId32 " ", entry_count);
+        err = MZ_INTERNAL_ERROR;
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+    mz_stream_mem_delete(&mem_stream);
+
+    /* Verify the contents of each extracted file and clean up */
+    for (i = 0; i < 40; i += 1)
+    {
+        snprintf(path, sizeof(path), "%s/dir%" PRId32 "/entry%03" PRId32 ".txt", destination, i % 4, i);
+
+        mz_stream_os_create(&file_stream);
+        if (err == MZ_OK)
+            err = mz_stream_os_open(file_stream, path, MZ_OPEN_MODE_READ);
+        if (err == MZ_OK && mz_stream_os_read(file_stream, data, sizeof(data)) != i % 11)
+            err = MZ_READ_ERROR;
+        if (err == MZ_OK && memcmp(data, "0123456789", i % 11) != 0)
+            err = MZ_INTERNAL_ERROR;
+        if (err != MZ_OK)
+            printf("failed verifying %s ", path);
+        mz_stream_os_close(file_stream);
+        mz_stream_os_delete(&file_stream);
+
+        mz_os_unlink(path);
+    }
+    for (i = 0; i < 4; i += 1)
+    {
+        snprintf(path, sizeof(path), "%s/dir%" PRId32, destination, i);
+        remove(path);
+    }
+    remove(destination);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_zip_save_all_overwrite_cb(void *handle, void *userdata, mz_zip_file *file_info, const char *path)
+{
+    int32_t *overwrite_count = (int32_t *)userdata;
+    MZ_UNUSED(handle);
+    MZ_UNUSED(file_info);
+    MZ_UNUSED(path);
+    *overwrite_count += 1;
+    return MZ_OK;
+}
+
+int32_t test_zip_save_all_threads_error(void)
+{
+    void *mem_stream = NULL;
+    void *zip_handle = NULL;
+    void *reader = NULL;
+    const char *destination = "test_save_all_error";
+    const void *buf = NULL;
+    uint8_t *zip_buf = NULL;
+    int32_t buf_length = 0;
+    int32_t overwrite_count = 0;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[64];
+    char path[128];
+
+
+    printf("Zip save all threads error.. ");
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    /* Last entry uses a compression method that can't be read */
+    mz_zip_create(&zip_handle);
+    err = mz_zip_open(zip_handle, mem_stream, MZ_OPEN_MODE_WRITE);
+    for (i = 0; err == MZ_OK && i < 8; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%" PRId32 ".txt", i);
+        err = test_zip_locate_add(zip_handle, filename, 10);
+    }
+    if (err == MZ_OK)
+        err = test_zip_locate_add(zip_handle, "unknown.bin", 10);
+    mz_zip_close(zip_handle);
+    mz_zip_delete(&zip_handle);
+
+    mz_stream_mem_get_buffer(mem_stream, &buf);
+    mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_END);
+    buf_length = (int32_t)mz_stream_mem_tell(mem_stream);
+
+    /* Change the method of the last entry in its local and central headers */
+    zip_buf = (uint8_t *)buf;
+    for (i = 0; err == MZ_OK && i < buf_length - 46 - 11; i += 1)
+    {
+        if (memcmp(zip_buf + i, "PK\3\4", 4) == 0 && memcmp(zip_buf + i + 30, "unknown.bin", 11) == 0)
+            memset(zip_buf + i + 8, 0x7f, 2);
+        else if (memcmp(zip_buf + i, "PK\1\2", 4) == 0 && memcmp(zip_buf + i + 46, "unknown.bin", 11) == 0)
+            memset(zip_buf + i + 10, 0x7f, 2);
+    }
+
+    /* Failing entry is reported without extracting the other entries a second time */
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_thread_count(reader, 2);
+    mz_zip_reader_set_overwrite_cb(reader, &overwrite_count, test_zip_save_all_overwrite_cb);
+
+    if (err == MZ_OK)
+        err = mz_zip_reader_open_buffer(reader, (uint8_t *)buf, buf_length, 0);
+    if (err == MZ_OK)
+    {
+        err = mz_zip_reader_save_all(reader, destination);
+        if (err == MZ_SUPPORT_ERROR && overwrite_count == 0)
+            err = MZ_OK;
+        else
+        {
+            printf("unexpected result %" PRId32 " with %" PRId32 " overwrites ", err, overwrite_count);
+            err = MZ_INTERNAL_ERROR;
+        }
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+    mz_stream_mem_delete(&mem_stream);
+
+    for (i = 0; i < 8; i += 1)
+    {
+        snprintf(path, sizeof(path), "%s/entry%" PRId32 ".txt", destination, i);
+        mz_os_unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/unknown.bin", destination);
+    mz_os_unlink(path);
+    remove(destination);
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+int32_t test_zip_writer_threads(void)
+{
+    void *mem_stream = NULL;
+    void *file_stream = NULL;
+    void *writer = NULL;
+    void *reader = NULL;
+    mz_zip_file *file_info = NULL;
+    int32_t entry_count = 0;
+    int32_t i = 0;
+    int32_t j = 0;
+    int32_t err = MZ_OK;
+    char filename[64];
+    char path[128];
+    char data[4096];
+    char expected[4096];
+
+
+    printf("Zip writer threads.. ");
+
+    /* Create source files of different sizes */
+    for (i = 0; err == MZ_OK && i < 40; i += 1)
+    {
+        snprintf(path, sizeof(path), "test_writer_threads_%03" PRId32 ".txt", i);
+        for (j = 0; j < i * 100; j += 1)
+            expected[j] = (char)('a' + ((i + j / 7) % 26));
+
+        mz_stream_os_create(&file_stream);
+        err = mz_stream_os_open(file_stream, path, MZ_OPEN_MODE_CREATE | MZ_OPEN_MODE_WRITE);
+        if (err == MZ_OK && mz_stream_os_write(file_stream, expected, i * 100) != i * 100)
+            err = MZ_WRITE_ERROR;
+        mz_stream_os_close(file_stream);
+        mz_stream_os_delete(&file_stream);
+    }
+
+    mz_stream_mem_create(&mem_stream);
+    mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+
+    mz_zip_writer_create(&writer);
+    mz_zip_writer_set_thread_count(writer, 4);
+    if (err == MZ_OK)
+        err = mz_zip_writer_open(writer, mem_stream, 0);
+    for (i = 0; err == MZ_OK && i < 40; i += 1)
+    {
+        snprintf(path, sizeof(path), "test_writer_threads_%03" PRId32 ".txt", i);
+        snprintf(filename, sizeof(filename), "dir%" PRId32 "/entry%03" PRId32 ".txt", i % 4, i);
+        err = mz_zip_writer_add_file(writer, path, filename);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_writer_close(writer);
+    else
+        mz_zip_writer_close(writer);
+    mz_zip_writer_delete(&writer);
+
+    /* Entries must be stored in the order they were added */
+    mz_zip_reader_create(&reader);
+    if (err == MZ_OK)
+    {
+        mz_stream_mem_seek(mem_stream, 0, MZ_SEEK_SET);
+        err = mz_zip_reader_open(reader, mem_stream);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_reader_goto_first_entry(reader);
+    while (err == MZ_OK)
+    {
+        snprintf(filename, sizeof(filename), "dir%" PRId32 "/entry%03" PRId32 ".txt", entry_count % 4, entry_count);
+        for (j = 0; j < entry_count * 100; j += 1)
+            expected[j] = (char)('a' + ((entry_count + j / 7) % 26));
+
+        err = mz_zip_reader_entry_get_info(reader, &file_info);
+        if (err == MZ_OK && strcmp(file_info->filename, filename) != 0)
+        {
+            printf("unexpected entry %s ", file_info->filename);
+            err = MZ_INTERNAL_ERROR;
+        }
+        if (err == MZ_OK && mz_zip_reader_entry_save_buffer_length(reader) != entry_count * 100)
+            err = MZ_FORMAT_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save_buffer(reader, data, entry_count * 100);
+        if (err == MZ_OK && memcmp(data, expected, entry_count * 100) != 0)
+            err = MZ_CRC_ERROR;
+
+        entry_count += 1;
+        if (err == MZ_OK)
+            err = mz_zip_reader_goto_next_entry(reader);
+    }
+    if (err == MZ_END_OF_LIST)
+        err = MZ_OK;
+    if (err == MZ_OK && entry_count != 40)
+    {
+        printf("unexpected entry count %" PRId32 " ", entry_count);
+        err = MZ_INTERNAL_ERROR;
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+    mz_stream_mem_delete(&mem_stream);
+
+    for (i = 0; i < 40; i += 1)
+    {
+        snprintf(path, sizeof(path), "test_writer_threads_%03" PRId32 ".txt", i);
+        mz_os_unlink(path);
+    }
+
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
+
+    printf("OK\n");
+    return MZ_OK;
+}
+
+static int32_t test_zip_zero_copy_save(const char *zip_path, uint8_t zero_copy, uint8_t verify_crc,
+    const uint8_t *expected, int32_t expected_size)
+{
+    void *reader = NULL;
+    void *file_stream = NULL;
+    uint8_t *buf = NULL;
+    const char *path = "test_zero_copy.bin";
+    int32_t err = MZ_OK;
+
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_zero_copy(reader, zero_copy, verify_crc);
+
+    err = mz_zip_reader_open_file(reader, zip_path);
+    if (err == MZ_OK)
+        err = mz_zip_reader_locate_entry(reader, "large.bin", 0);
+    if (err == MZ_OK)
+        err = mz_zip_reader_entry_save_file(reader, path);
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    /* Saved file must match byte for byte */
+    if (err == MZ_OK)
+    {
+        buf = (uint8_t *)MZ_ALLOC(expected_size + 1);
+        mz_stream_os_create(&file_stream);
+        err = mz_stream_os_open(file_stream, path, MZ_OPEN_MODE_READ);
+        if (err == MZ_OK && mz_stream_os_read(file_stream, buf, expected_size + 1) != expected_size)
+            err = MZ_READ_ERROR;
+        if (err == MZ_OK && memcmp(buf, expected, expected_size) != 0)
+            err = MZ_DATA_ERROR;
+        mz_stream_os_close(file_stream);
+        mz_stream_os_delete(&file_stream);
+        MZ_FREE(buf);
+    }
+
+    mz_os_unlink(path);
+    return err;
+}
+
+int32_t test_zip_zero_copy(void)
+{
+    void *writer = NULL;
+    void *reader = NULL;
+    void *file_stream = NULL;
+    mz_zip_file file_info;
+    uint8_t *data = NULL;
+    uint8_t *zip_buf = NULL;
+    const char *zip_path = "test_zero_copy.zip";
+    const char *destination = "test_zero_copy";
+    const char *filenames[] = { "empty.bin", "small.bin", "large.bin" };
+    int32_t sizes[] = { 0, 100, 300000 };
+    int64_t zip_size = 0;
+    uint32_t seed = 1;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char path[128];
+
+
+    printf("Zip zero copy.. ");
+
+    data = (uint8_t *)MZ_ALLOC(sizes[2]);
+    if (data == NULL)
+        return MZ_MEM_ERROR;
+    for (i = 0; i < sizes[2]; i += 1)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+
+    /* Stored entries are candidates for being copied by the kernel */
+    mz_zip_writer_create(&writer);
+    err = mz_zip_writer_open_file(writer, zip_path, 0, 0);
+    for (i = 0; err == MZ_OK && i < 3; i += 1)
+    {
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = MZ_COMPRESS_METHOD_STORE;
+        file_info.filename = filenames[i];
+        err = mz_zip_writer_add_buffer(writer, data, sizes[i], &file_info);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_writer_close(writer);
+    else
+        mz_zip_writer_close(writer);
+    mz_zip_writer_delete(&writer);
+
+    if (err == MZ_OK)
+        err = test_zip_zero_copy_save(zip_path, 1, 1, data, sizes[2]);
+    if (err == MZ_OK)
+        err = test_zip_zero_copy_save(zip_path, 0, 1, data, sizes[2]);
+
+    /* Every entry is extracted intact by multiple threads */
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_thread_count(reader, 2);
+    if (err == MZ_OK)
+        err = mz_zip_reader_open_file(reader, zip_path);
+    if (err == MZ_OK)
+        err = mz_zip_reader_save_all(reader, destination);
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    for (i = 0; i < 3; i += 1)
+    {
+        snprintf(path, sizeof(path), "%s/%s", destination, filenames[i]);
+        if (err == MZ_OK && mz_os_get_file_size(path) != sizes[i])
+        {
+            printf("unexpected size of %s ", path);
+            err = MZ_INTERNAL_ERROR;
+        }
+        mz_os_unlink(path);
+    }
+    remove(destination);
+
+    /* Corrupt the stored data of the large entry in the middle */
+    mz_stream_os_create(&file_stream);
+    if (err == MZ_OK)
+        err = mz_stream_os_open(file_stream, zip_path, MZ_OPEN_MODE_READWRITE | MZ_OPEN_MODE_APPEND);
+    if (err == MZ_OK)
+    {
+        mz_stream_os_seek(file_stream, 0, MZ_SEEK_END);
+        zip_size = mz_stream_os_tell(file_stream);
+        zip_buf = (uint8_t *)MZ_ALLOC((size_t)zip_size);
+        mz_stream_os_seek(file_stream, 0, MZ_SEEK_SET);
+        if (zip_buf == NULL || mz_stream_os_read(file_stream, zip_buf, (int32_t)zip_size) != zip_size)
+            err = MZ_READ_ERROR;
+    }
+    for (i = 0; err == MZ_OK && i < (int32_t)zip_size - 64; i += 1)
+    {
+        if (memcmp(zip_buf + i, data + 150000, 64) == 0)
+            break;
+    }
+    if (err == MZ_OK && i >= (int32_t)zip_size - 64)
+        err = MZ_EXIST_ERROR;
+    if (err == MZ_OK)
+    {
+        zip_buf[i] ^= 0xff;
+        mz_stream_os_seek(file_stream, i, MZ_SEEK_SET);
+        if (mz_stream_os_write(file_stream, zip_buf + i, 1) != 1)
+            err = MZ_WRITE_ERROR;
+    }
+    mz_stream_os_close(file_stream);
+    mz_stream_os_delete(&file_stream);
+    if (zip_buf != NULL)
+        MZ_FREE(zip_buf);
+
+    /* Crc must be verified unless explicitly skipped */
+    if (err == MZ_OK && test_zip_zero_copy_save(zip_path, 1, 1, data, sizes[2]) != MZ_CRC_ERROR)
+        err = MZ_INTERNAL_ERROR;
+    if (err == MZ_OK && test_zip_zero_copy_save(zip_path, 0, 1, data, sizes[2]) != MZ_CRC_ERROR)
+        err = MZ_INTERNAL_ERROR;
+#if !defined(_WIN32) && (defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_SENDFILE))
+    if (err == MZ_OK)
     {
-#if 1
-        mz_stream_mem_create(&mem_stream);
-        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+        data[150000] ^= 0xff;
+        err = test_zip_zero_copy_save(zip_path, 1, 0, data, sizes[2]);
+    }
+#endif
 
-        for (x = 0; x < find_size; x += 1)
-            mz_stream_write_uint8(mem_stream, find[x]);
-        for (x = 0; x < i; x += 1)
-            mz_stream_write_uint8(mem_stream, 0);
+    mz_os_unlink(zip_path);
+    MZ_FREE(data);
 
-        if (find_cb == mz_stream_find)
-            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
 
-        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size, &position);
-        last_pos = mz_stream_tell(mem_stream);
-        mz_stream_mem_delete(&mem_stream);
+    printf("OK\n");
+    return MZ_OK;
+}
 
-#ifdef TEST_VERBOSE
-        printf("Find postzero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
-            name, find_size, position, (position == 0));
-#endif
+static int32_t test_zip_copy_from_reader_run(const char *src_path, const char *dst_path, uint8_t zero_copy)
+{
+    void *reader = NULL;
+    void *writer = NULL;
+    int32_t err = MZ_OK;
+    int32_t err_close = MZ_OK;
 
-        if (position != 0 || last_pos != position)
-            break;
-#endif
-        mz_stream_mem_create(&mem_stream);
-        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_zero_copy(reader, zero_copy, 1);
+    mz_zip_writer_create(&writer);
 
-        for (x = 0; x < i; x += 1)
-            mz_stream_write_uint8(mem_stream, 0);
-        for (x = 0; x < find_size; x += 1)
-            mz_stream_write_uint8(mem_stream, find[x]);
+    err = mz_zip_reader_open_file(reader, src_path);
+    if (err == MZ_OK)
+        err = mz_zip_writer_open_file(writer, dst_path, 0, 0);
+    if (err == MZ_OK)
+        err = mz_zip_reader_goto_first_entry(reader);
+    while (err == MZ_OK)
+    {
+        err = mz_zip_writer_copy_from_reader(writer, reader);
+        if (err == MZ_OK)
+            err = mz_zip_reader_goto_next_entry(reader);
+    }
+    if (err == MZ_END_OF_LIST)
+        err = MZ_OK;
 
-        if (find_cb == mz_stream_find)
-            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+    err_close = mz_zip_writer_close(writer);
+    if (err == MZ_OK)
+        err = err_close;
+    mz_zip_writer_delete(&writer);
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+    return err;
+}
 
-        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size, &position);
-        last_pos = mz_stream_tell(mem_stream);
-        mz_stream_mem_delete(&mem_stream);
+int32_t test_zip_copy_from_reader(void)
+{
+    void *writer = NULL;
+    void *reader = NULL;
+    void *file_stream = NULL;
+    mz_zip_file file_info;
+    uint8_t *data = NULL;
+    uint8_t *buf = NULL;
+    uint8_t *zip_bufs[2] = { NULL, NULL };
+    const char *src_path = "test_copy_src.zip";
+    const char *dst_paths[] = { "test_copy_dst.zip", "test_copy_buf.zip" };
+    const char *filenames[] = { "stored.bin", "deflated.bin", "small.bin" };
+    uint16_t methods[] = { MZ_COMPRESS_METHOD_STORE, MZ_COMPRESS_METHOD_DEFLATE, MZ_COMPRESS_METHOD_STORE };
+    int32_t sizes[] = { 600000, 400000, 100 };
+    int64_t zip_sizes[2] = { 0, 0 };
+    uint32_t seed = 1;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
 
-#ifdef TEST_VERBOSE
-        printf("Find prezero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
-            name, find_size, position, (position == i));
-#endif
 
-        if (position != i || last_pos != position)
-            break;
+    printf("Zip copy from reader.. ");
 
-        mz_stream_mem_create(&mem_stream);
-        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+    data = (uint8_t *)MZ_ALLOC(sizes[0]);
+    buf = (uint8_t *)MZ_ALLOC(sizes[0]);
+    if (data == NULL || buf == NULL)
+    {
+        if (data != NULL)
+            MZ_FREE(data);
+        if (buf != NULL)
+            MZ_FREE(buf);
+        return MZ_MEM_ERROR;
+    }
+    for (i = 0; i < sizes[0]; i += 1)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)(seed >> 16);
+    }
 
-        for (x = 0; x < i; x += 1)
-            mz_stream_write_uint8(mem_stream, 0);
-        for (x = 0; x < find_size; x += 1)
-            mz_stream_write_uint8(mem_stream, find[x]);
-        for (x = 0; x < i; x += 1)
-            mz_stream_write_uint8(mem_stream, 0);
+    mz_zip_writer_create(&writer);
+    err = mz_zip_writer_open_file(writer, src_path, 0, 0);
+    for (i = 0; err == MZ_OK && i < 3; i += 1)
+    {
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = methods[i];
+        file_info.filename = filenames[i];
+        err = mz_zip_writer_add_buffer(writer, data, sizes[i], &file_info);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_writer_close(writer);
+    else
+        mz_zip_writer_close(writer);
+    mz_zip_writer_delete(&writer);
 
-        if (find_cb == mz_stream_find)
-            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+    /* Copying inside the kernel must produce the same zip as copying through the buffers */
+    if (err == MZ_OK)
+        err = test_zip_copy_from_reader_run(src_path, dst_paths[0], 1);
+    if (err == MZ_OK)
+        err = test_zip_copy_from_reader_run(src_path, dst_paths[1], 0);
 
-        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size + i, &position);
-        last_pos = mz_stream_tell(mem_stream);
-        mz_stream_mem_delete(&mem_stream);
+    for (i = 0; err == MZ_OK && i < 2; i += 1)
+    {
+        mz_stream_os_create(&file_stream);
+        err = mz_stream_os_open(file_stream, dst_paths[i], MZ_OPEN_MODE_READ);
+        if (err == MZ_OK)
+        {
+            mz_stream_os_seek(file_stream, 0, MZ_SEEK_END);
+            zip_sizes[i] = mz_stream_os_tell(file_stream);
+            mz_stream_os_seek(file_stream, 0, MZ_SEEK_SET);
+            zip_bufs[i] = (uint8_t *)MZ_ALLOC((size_t)zip_sizes[i]);
+            if (zip_bufs[i] == NULL ||
+                mz_stream_os_read(file_stream, zip_bufs[i], (int32_t)zip_sizes[i]) != zip_sizes[i])
+                err = MZ_READ_ERROR;
+        }
+        mz_stream_os_close(file_stream);
+        mz_stream_os_delete(&file_stream);
+    }
+    if (err == MZ_OK && (zip_sizes[0] != zip_sizes[1] || memcmp(zip_bufs[0], zip_bufs[1], (size_t)zip_sizes[0]) != 0))
+    {
+        printf("copies differ ");
+        err = MZ_DATA_ERROR;
+    }
+    for (i = 0; i < 2; i += 1)
+    {
+        if (zip_bufs[i] != NULL)
+            MZ_FREE(zip_bufs[i]);
+    }
 
-#ifdef TEST_VERBOSE
-        printf("Find equalzero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
-            name, find_size, position, (position == i));
-#endif
+    /* Every copied entry is extracted intact */
+    mz_zip_reader_create(&reader);
+    if (err == MZ_OK)
+        err = mz_zip_reader_open_file(reader, dst_paths[0]);
+    for (i = 0; err == MZ_OK && i < 3; i += 1)
+    {
+        err = mz_zip_reader_locate_entry(reader, filenames[i], 0);
+        if (err == MZ_OK && mz_zip_reader_entry_save_buffer_length(reader) != sizes[i])
+            err = MZ_DATA_ERROR;
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save_buffer(reader, buf, sizes[i]);
+        if (err == MZ_OK && memcmp(buf, data, sizes[i]) != 0)
+            err = MZ_DATA_ERROR;
+    }
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
 
-        if (position != i || last_pos != position)
-            break;
+    mz_os_unlink(src_path);
+    mz_os_unlink(dst_paths[0]);
+    mz_os_unlink(dst_paths[1]);
+    MZ_FREE(buf);
+    MZ_FREE(data);
 
-        mz_stream_mem_create(&mem_stream);
-        mz_stream_mem_open(mem_stream, NULL, MZ_OPEN_MODE_CREATE);
+    if (err != MZ_OK)
+    {
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
+    }
 
-        for (x = 0; x < i; x += 1)
-            mz_stream_write_uint8(mem_stream, 0);
-        for (x = 0; x < find_size; x += 1)
-            mz_stream_write_uint8(mem_stream, find[x]);
-        for (x = 0; x < i; x += 1)
-            mz_stream_write_uint8(mem_stream, 0);
-        mz_stream_write_uint8(mem_stream, 0);
+    printf("OK\n");
+    return MZ_OK;
+}
 
-        if (find_cb == mz_stream_find)
-            mz_stream_seek(mem_stream, 0, MZ_SEEK_SET);
+static int32_t test_zip_async_in_stack(void *zip_handle)
+{
+    mz_stream *stream = NULL;
 
-        err = find_cb(mem_stream, (const void *)find, find_size, (int64_t)i + find_size + i + 1, &position);
-        last_pos = mz_stream_tell(mem_stream);
-        mz_stream_mem_delete(&mem_stream);
+    /* Look for the async stream beneath the stream used by the zip */
+    if (mz_zip_get_stream(zip_handle, (void **)&stream) != MZ_OK)
+        return MZ_PARAM_ERROR;
+    for (; stream != NULL; stream = stream->base)
+    {
+        if (stream->vtbl == mz_stream_async_get_interface())
+            return MZ_OK;
+    }
+    return MZ_EXIST_ERROR;
+}
 
-#ifdef TEST_VERBOSE
-        printf("Find unequalzero - %s (len %" PRId32 " pos %" PRId64 " ok %" PRId32 ")\n",
-            name, find_size, position, (position == i));
-#endif
+static int32_t test_zip_async_write(const char *path, uint8_t append, const uint8_t *data,
+    int32_t first, int32_t count)
+{
+    mz_zip_file file_info;
+    void *writer = NULL;
+    void *zip_handle = NULL;
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+    char filename[32];
 
-        if (position != i || last_pos != position)
-            break;
+    mz_zip_writer_create(&writer);
+    mz_zip_writer_set_thread_count(writer, 2);
+    err = mz_zip_writer_open_file(writer, path, 0, append);
+    if (err == MZ_OK)
+    {
+        mz_zip_writer_get_zip_handle(writer, &zip_handle);
+        err = test_zip_async_in_stack(zip_handle);
     }
-
+    for (i = first; err == MZ_OK && i < first + count; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%" PRId32 ".bin", i);
+        memset(&file_info, 0, sizeof(file_info));
+        file_info.version_madeby = MZ_VERSION_MADEBY;
+        file_info.compression_method = (i % 2) ? MZ_COMPRESS_METHOD_STORE : MZ_COMPRESS_METHOD_DEFLATE;
+        file_info.filename = filename;
+        err = mz_zip_writer_add_buffer(writer, (void *)(data + i * 1000), 500000, &file_info);
+    }
+    if (err == MZ_OK)
+        err = mz_zip_writer_close(writer);
+    else
+        mz_zip_writer_close(writer);
+    mz_zip_writer_delete(&writer);
     return err;
 }
 
-int32_t test_stream_find(void)
+int32_t test_zip_async(void)
 {
-    int32_t c = 1;
+    void *reader = NULL;
+    void *zip_handle = NULL;
+    uint8_t *data = NULL;
+    uint8_t *buf = NULL;
+    const char *path = "test_async.zip";
+    int32_t size = 510000;
+    uint32_t seed = 1;
+    int32_t i = 0;
     int32_t err = MZ_OK;
-    char *find = "0123456789";
+    char filename[32];
 
-    printf("Find stream.. ");
-    for (c = 1; c < (int32_t)strlen(find); c += 1)
+
+    printf("Zip async.. ");
+
+    data = (uint8_t *)MZ_ALLOC(size);
+    buf = (uint8_t *)MZ_ALLOC(500000);
+    if (data == NULL || buf == NULL)
     {
-        err = test_stream_find_run("forward", 2096, (uint8_t *)find, c, mz_stream_find);
-        if (err != MZ_OK)
-            return err;
+        if (data != NULL)
+            MZ_FREE(data);
+        if (buf != NULL)
+            MZ_FREE(buf);
+        return MZ_MEM_ERROR;
+    }
+    for (i = 0; i < size; i += 1)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (i % 4) ? (uint8_t)('a' + (i / 7) % 26) : (uint8_t)(seed >> 16);
     }
 
-    printf("OK\n");
-    return MZ_OK;
-}
+    /* Zip files opened with more than one thread are written behind and read ahead */
+    err = test_zip_async_write(path, 0, data, 0, 6);
+    if (err == MZ_OK)
+        err = test_zip_async_write(path, 1, data, 6, 4);
 
-int32_t test_stream_find_reverse(void)
-{
-    int32_t c = 1;
-    int32_t err = MZ_OK;
-    char *find = "0123456789";
+    mz_zip_reader_create(&reader);
+    mz_zip_reader_set_thread_count(reader, 2);
+    if (err == MZ_OK)
+        err = mz_zip_reader_open_file(reader, path);
+    if (err == MZ_OK)
+    {
+        mz_zip_reader_get_zip_handle(reader, &zip_handle);
+        err = test_zip_async_in_stack(zip_handle);
+    }
+    for (i = 0; err == MZ_OK && i < 10; i += 1)
+    {
+        snprintf(filename, sizeof(filename), "entry%" PRId32 ".bin", i);
+        err = mz_zip_reader_locate_entry(reader, filename, 0);
+        if (err == MZ_OK)
+            err = mz_zip_reader_entry_save_buffer(reader, buf, 500000);
+        if (err == MZ_OK && memcmp(buf, data + i * 1000, 500000) != 0)
+            err = MZ_DATA_ERROR;
+    }
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
 
-    printf("Find reverse stream.. ");
-    for (c = 1; c < (int32_t)strlen(find); c += 1)
+    mz_os_unlink(path);
+    MZ_FREE(buf);
+    MZ_FREE(data);
+
+    if (err != MZ_OK)
     {
-        err = test_stream_find_run("backward", 2096, (uint8_t *)find, c, mz_stream_find_reverse);
-        if (err != MZ_OK)
-            return err;
+        printf("failed (%" PRId32 ")\n", err);
+        return err;
     }
 
     printf("OK\n");
     return MZ_OK;
 }
+#endif
 
 /***************************************************************************/
 
@@ -615,6 +3397,52 @@ int32_t convert_buffer_to_hex_string(uint8_t *buf, int32_t buf_size, char *hex_s
     return MZ_OK;
 }
 
+int32_t test_crypt_crc32(void)
+{
+    const char *check = "123456789";
+    uint8_t data[4096];
+    uint32_t expected = 0;
+    uint32_t crc1 = 0;
+    uint32_t crc2 = 0;
+    int32_t data_size = (int32_t)sizeof(data);
+    int32_t split = 0;
+    int32_t i = 0;
+
+    for (i = 0; i < data_size; i += 1)
+        data[i] = (uint8_t)((i * 31) ^ (i >> 7));
+
+    if (mz_crypt_crc32_update(0, (const uint8_t *)check, (int32_t)strlen(check)) != 0xcbf43926)
+    {
+        printf("Crc32.. failed (check value)\n");
+        return MZ_CRC_ERROR;
+    }
+
+    /* Compare against crc32 computed a byte at a time */
+    for (i = 0; i < data_size; i += 1)
+        expected = mz_crypt_crc32_update(expected, data + i, 1);
+
+    for (split = 0; split <= data_size; split += 257)
+    {
+        crc1 = mz_crypt_crc32_update(0, data, split);
+        crc2 = mz_crypt_crc32_update(crc1, data + split, data_size - split);
+        if (crc2 != expected)
+        {
+            printf("Crc32.. failed (update split %" PRId32 ")\n", split);
+            return MZ_CRC_ERROR;
+        }
+
+        crc2 = mz_crypt_crc32_update(0, data + split, data_size - split);
+        if (mz_crypt_crc32_combine(crc1, crc2, data_size - split) != expected)
+        {
+            printf("Crc32.. failed (combine split %" PRId32 ")\n", split);
+            return MZ_CRC_ERROR;
+        }
+    }
+
+    printf("Crc32.. OK\n");
+    return MZ_OK;
+}
+
 #ifndef MZ_ZIP_NO_CRYPTO
 int32_t test_crypt_sha(void)
 {
@@ -774,6 +3602,77 @@ int test_crypt_aes(void)
     return MZ_OK;
 }
 
+int32_t test_crypt_aes_ctr(void)
+{
+    void *aes = NULL;
+    uint8_t key[32];
+    uint8_t counter[MZ_AES_BLOCK_SIZE];
+    uint8_t block[MZ_AES_BLOCK_SIZE];
+    uint8_t buf[3000];
+    uint8_t expected[sizeof(buf)];
+    char computed_hash[320];
+    int32_t i = 0;
+    int32_t j = 0;
+    int32_t err = MZ_OK;
+
+    for (i = 0; i < (int32_t)sizeof(key); i += 1)
+        key[i] = (uint8_t)i;
+
+    mz_crypt_aes_create(&aes);
+    mz_crypt_aes_set_mode(aes, MZ_AES_ENCRYPTION_MODE_256);
+    mz_crypt_aes_set_encrypt_key(aes, key, sizeof(key));
+
+    /* Keystream for a counter that carries into the second byte */
+    memset(counter, 0, sizeof(counter));
+    counter[0] = 0xfe;
+    memset(buf, 0, 48);
+    if (mz_crypt_aes_encrypt_ctr(aes, counter, buf, 48) != 48)
+        err = MZ_CRYPT_ERROR;
+
+    convert_buffer_to_hex_string(buf, 48, computed_hash, sizeof(computed_hash));
+    printf("Aes ctr keystream\n%s\n", computed_hash);
+
+    if (err == MZ_OK && strcmp(computed_hash, "dd654db52e2f65a7e6905ee90734eb95d9a37331c9c2da94961737f7f7322bd605d9592cefc7834bf69776614868a151") != 0)
+        err = MZ_CRYPT_ERROR;
+    if (err == MZ_OK && (counter[0] != 0x01 || counter[1] != 0x01))
+        err = MZ_CRYPT_ERROR;
+
+    /* Compare bulk encryption against one block at a time */
+    for (i = 0; i < (int32_t)sizeof(buf); i += 1)
+        buf[i] = expected[i] = (uint8_t)(i * 7);
+
+    memset(counter, 0, sizeof(counter));
+    counter[0] = 1;
+    for (i = 0; err == MZ_OK && i < (int32_t)sizeof(expected); i += MZ_AES_BLOCK_SIZE)
+    {
+        memcpy(block, counter, sizeof(block));
+        mz_crypt_aes_encrypt(aes, block, sizeof(block));
+        for (j = 0; j < MZ_AES_BLOCK_SIZE && i + j < (int32_t)sizeof(expected); j += 1)
+            expected[i + j] ^= block[j];
+        j = 0;
+        while (j < 8 && !++counter[j])
+            j += 1;
+    }
+
+    memset(counter, 0, sizeof(counter));
+    counter[0] = 1;
+    if (err == MZ_OK && mz_crypt_aes_encrypt_ctr(aes, counter, buf, sizeof(buf)) != (int32_t)sizeof(buf))
+        err = MZ_CRYPT_ERROR;
+    if (err == MZ_OK && memcmp(buf, expected, sizeof(buf)) != 0)
+        err = MZ_CRYPT_ERROR;
+
+    mz_crypt_aes_delete(&aes);
+
+    if (err != MZ_OK)
+    {
+        printf("Aes ctr.. failed\n");
+        return err;
+    }
+
+    printf("Aes ctr.. OK\n");
+    return MZ_OK;
+}
+
 int32_t test_crypt_hmac(void)
 {
     void *hmac;
@@ -831,6 +3730,57 @@ int32_t test_crypt_hmac(void)
     printf("Hmac.. OK\n");
     return MZ_OK;
 }
+
+#ifdef HAVE_WZAES
+typedef struct test_pbkdf2_vector_s {
+    const char *password;
+    const char *salt;
+    int32_t     iteration_count;
+    int32_t     key_length;
+    const char *expected;
+} test_pbkdf2_vector;
+
+int32_t test_crypt_pbkdf2(void)
+{
+    /* RFC 6070 vectors followed by a password longer than the block size */
+    static const test_pbkdf2_vector vectors[] = {
+        { "password", "salt", 1, 20, "0c60c80f961f0e71f3a9b524af6012062fe037a6" },
+        { "password", "salt", 2, 20, "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957" },
+        { "password", "salt", 4096, 20, "4b007901b765489abead49d926f721d065a429c1" },
+        { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 25,
+          "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038" },
+        { "pppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppppp",
+          "8F3472E4EA57F56E36F30246DC22C173", 1000, 66,
+          "fed63b73d468efb9c84daff56b564680db828f1fe302fddea6c7902bc7845ace23bd28492bc3cabc9e857b3218c6aa2b54e4259f5dd6aeb0225563a8e76a4f9ffe04" }
+    };
+    uint8_t key[66];
+    char computed_hash[320];
+    int32_t i = 0;
+    int32_t err = MZ_OK;
+
+    for (i = 0; err == MZ_OK && i < (int32_t)(sizeof(vectors) / sizeof(vectors[0])); i += 1)
+    {
+        err = mz_crypt_pbkdf2((uint8_t *)vectors[i].password, (int32_t)strlen(vectors[i].password),
+            (uint8_t *)vectors[i].salt, (int32_t)strlen(vectors[i].salt), vectors[i].iteration_count,
+            key, vectors[i].key_length);
+
+        convert_buffer_to_hex_string(key, vectors[i].key_length, computed_hash, sizeof(computed_hash));
+        printf("Pbkdf2 key %" PRId32 "\n%s\n", i, computed_hash);
+
+        if (err == MZ_OK && strcmp(computed_hash, vectors[i].expected) != 0)
+            err = MZ_CRYPT_ERROR;
+    }
+
+    if (err != MZ_OK)
+    {
+        printf("Pbkdf2.. failed\n");
+        return err;
+    }
+
+    printf("Pbkdf2.. OK\n");
+    return MZ_OK;
+}
+#endif
 #endif
 
 #if defined(HAVE_COMPAT) && defined(HAVE_ZLIB)
@@ -1270,14 +4220,40 @@ int main(int argc, const char *argv[])
     err |= test_utf8();
     err |= test_stream_find();
     err |= test_stream_find_reverse();
+    err |= test_stream_mmap();
+#ifndef _WIN32
+    err |= test_stream_fd();
+#endif
+    err |= test_stream_buffered();
+    err |= test_stream_async();
+#if !defined(MZ_ZIP_NO_COMPRESSION) && !defined(MZ_ZIP_NO_DECOMPRESSION)
+    err |= test_zip_locate();
+    err |= test_zip_cursor();
+    err |= test_zip_codec_reuse();
+    err |= test_zip_codec_reuse_level();
+    err |= test_zip_buffer_size();
+    err |= test_zip_read_buffer();
+    err |= test_zip_write_buffer();
+    err |= test_zip_save_all_threads();
+    err |= test_zip_save_all_threads_error();
+    err |= test_zip_writer_threads();
+    err |= test_zip_zero_copy();
+    err |= test_zip_copy_from_reader();
+    err |= test_zip_async();
+#endif
 
 #if !defined(MZ_ZIP_NO_COMPRESSION) && !defined(MZ_ZIP_NO_DECOMPRESSION)
 #ifdef HAVE_BZIP2
     err |= test_stream_bzip();
 #endif
+#ifdef HAVE_LZMA
+    err |= test_stream_lzma_threads();
+#endif
 #ifdef HAVE_ZLIB
     err |= test_stream_zlib();
     err |= test_stream_zlib_mem();
+    err |= test_stream_zlib_threads();
+    err |= test_zip_method_registry();
 #ifdef HAVE_COMPAT
     err |= test_zip_compat();
     err |= test_unzip_compat();
@@ -1290,13 +4266,19 @@ int main(int argc, const char *argv[])
 #ifdef HAVE_PKCRYPT
     err |= test_stream_pkcrypt();
 #endif
+    err |= test_crypt_crc32();
 #if !defined(MZ_ZIP_NO_CRYPTO)
 #ifdef HAVE_WZAES
     err |= test_stream_wzaes();
+    err |= test_stream_wzaes_hmac_thread();
 #endif
     err |= test_crypt_sha();
     err |= test_crypt_aes();
+    err |= test_crypt_aes_ctr();
     err |= test_crypt_hmac();
+#ifdef HAVE_WZAES
+    err |= test_crypt_pbkdf2();
+#endif
 #endif
 
     return err;
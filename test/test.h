@@ -10,14 +10,39 @@ extern "C" {
 int32_t test_stream_bzip(void);
 int32_t test_stream_pkcrypt(void);
 int32_t test_stream_wzaes(void);
+int32_t test_stream_wzaes_hmac_thread(void);
 int32_t test_stream_zlib(void);
 int32_t test_stream_zlib_mem(void);
+int32_t test_stream_zlib_threads(void);
+int32_t test_zip_method_registry(void);
+int32_t test_stream_lzma_threads(void);
 int32_t test_stream_find(void);
 int32_t test_stream_find_reverse(void);
+int32_t test_stream_mmap(void);
+int32_t test_stream_fd(void);
+int32_t test_stream_buffered(void);
+int32_t test_stream_async(void);
 
+int32_t test_zip_locate(void);
+int32_t test_zip_cursor(void);
+int32_t test_zip_codec_reuse(void);
+int32_t test_zip_codec_reuse_level(void);
+int32_t test_zip_buffer_size(void);
+int32_t test_zip_read_buffer(void);
+int32_t test_zip_write_buffer(void);
+int32_t test_zip_save_all_threads(void);
+int32_t test_zip_save_all_threads_error(void);
+int32_t test_zip_writer_threads(void);
+int32_t test_zip_zero_copy(void);
+int32_t test_zip_copy_from_reader(void);
+int32_t test_zip_async(void);
+
+int32_t test_crypt_crc32(void);
 int32_t test_crypt_sha(void);
 int32_t test_crypt_aes(void);
+int32_t test_crypt_aes_ctr(void);
 int32_t test_crypt_hmac(void);
+int32_t test_crypt_pbkdf2(void);
 
 /***************************************************************************/
 